@@ -0,0 +1,183 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "SourceGenerator.h"
+
+#include <fmt/format.h>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    /**
+     * \brief A small linear congruential generator, so that the sources are identical on every platform.
+     */
+    class DeterministicRandom {
+        uint64_t m_state;
+    public:
+        explicit DeterministicRandom(uint64_t seed) : m_state{seed} {}
+
+        uint32_t next() {
+            m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+            return static_cast<uint32_t>(m_state >> 33);
+        }
+
+        uint32_t next(uint32_t bound) {
+            return next() % bound;
+        }
+    };
+
+    std::ofstream open_source(std::filesystem::path const& file) {
+        std::ofstream stream(file, std::ios::out | std::ios::trunc);
+        if (!stream) throw std::runtime_error("Cannot write benchmark source: " + file.string());
+        return stream;
+    }
+
+    constexpr const char header[] =
+            ".include cs8.cs8l\n"
+            ".include macros.cs8i\n"
+            "\n"
+            ".section code\n"
+            ".global start\n"
+            "start:\n";
+
+    constexpr const char footer[] = "finish:     halt\n";
+
+    constexpr size_t header_lines = 6;
+    constexpr size_t footer_lines = 1;
+}
+
+SourceGenerator::SourceGenerator(std::filesystem::path examples_directory, std::filesystem::path output_directory)
+: m_examples_directory{std::move(examples_directory)}, m_output_directory{std::move(output_directory)} {
+}
+
+SourceGenerator::GeneratedSource SourceGenerator::generate(Workload workload, size_t size) const {
+    auto directory = m_output_directory / fmt::format("{}_{}", workload_name(workload), size);
+    std::filesystem::create_directories(directory);
+
+    for (auto const* file : {"cs8.cs8l", "macros.cs8i"}) {
+        std::filesystem::copy_file(m_examples_directory / file, directory / file,
+                                   std::filesystem::copy_options::overwrite_existing);
+    }
+
+    switch (workload) {
+        case Workload::LabelDense:
+            return generate_label_dense(directory, size);
+        case Workload::MacroHeavy:
+            return generate_macro_heavy(directory, size);
+        case Workload::ByteTables:
+            return generate_byte_tables(directory, size);
+        case Workload::IncludeChain:
+            return generate_include_chain(directory, size);
+    }
+    throw std::logic_error("illegal state");
+}
+
+SourceGenerator::GeneratedSource
+SourceGenerator::generate_label_dense(std::filesystem::path const& directory, size_t size) const {
+    DeterministicRandom random(size);
+    auto const file = directory / "main.cs8s";
+    auto stream = open_source(file);
+
+    stream << header;
+    for (size_t i = 0; i < size; ++i) {
+        auto const target = random.next(static_cast<uint32_t>(size));
+        stream << fmt::format("l{}:     limm l{}\n", i, target);
+        stream << fmt::format("        lmem l{}+{}\n", (i + 1) % size, i % 3);
+    }
+    stream << footer;
+
+    return {file, header_lines + 2 * size + footer_lines};
+}
+
+SourceGenerator::GeneratedSource
+SourceGenerator::generate_macro_heavy(std::filesystem::path const& directory, size_t size) const {
+    DeterministicRandom random(size);
+    auto const file = directory / "main.cs8s";
+    auto stream = open_source(file);
+
+    stream << header;
+    for (size_t i = 0; i < size; ++i) {
+        switch (random.next(5)) {
+            case 0:
+                stream << "        inc %idx\n";
+                break;
+            case 1:
+                stream << "        dec %cnt\n";
+                break;
+            case 2:
+                stream << fmt::format("        li {}, %sc0\n", random.next(0x7FFF));
+                break;
+            case 3:
+                stream << "        sd %dst, 0x1000\n";
+                break;
+            default:
+                stream << "        be finish\n";
+                break;
+        }
+    }
+    stream << footer;
+
+    return {file, header_lines + size + footer_lines};
+}
+
+SourceGenerator::GeneratedSource
+SourceGenerator::generate_byte_tables(std::filesystem::path const& directory, size_t size) const {
+    constexpr size_t row_length = 64;
+    DeterministicRandom random(size);
+    auto const file = directory / "main.cs8s";
+    auto stream = open_source(file);
+
+    stream << header << footer << "\n.section data\n";
+    for (size_t i = 0; i < size; ++i) {
+        std::string row;
+        row.reserve(row_length);
+        for (size_t j = 0; j < row_length; ++j) {
+            row.push_back(static_cast<char>('A' + random.next(26)));
+        }
+        stream << fmt::format("t{}:     .bytes \"{}\", {}, {}\n", i, row, random.next(256), 0);
+    }
+
+    return {file, header_lines + footer_lines + 2 + size};
+}
+
+SourceGenerator::GeneratedSource
+SourceGenerator::generate_include_chain(std::filesystem::path const& directory, size_t size) const {
+    constexpr size_t lines_per_file = 8;
+    auto const file = directory / "main.cs8s";
+    {
+        auto stream = open_source(file);
+        stream << header;
+        if (size > 0) stream << ".include chain0.cs8i\n";
+        stream << footer;
+    }
+
+    for (size_t depth = 0; depth < size; ++depth) {
+        auto stream = open_source(directory / fmt::format("chain{}.cs8i", depth));
+        stream << fmt::format("c{}:\n", depth);
+        for (size_t i = 1; i < lines_per_file; ++i) {
+            stream << fmt::format("        li {}, %sc{}\n", depth * lines_per_file + i, i % 2);
+        }
+        if (depth + 1 < size) stream << fmt::format(".include chain{}.cs8i\n", depth + 1);
+    }
+
+    return {file, header_lines + 1 + footer_lines + size * (lines_per_file + 1)};
+}
+
+std::string SourceGenerator::workload_name(Workload workload) {
+    switch (workload) {
+        case Workload::LabelDense:
+            return "label_dense";
+        case Workload::MacroHeavy:
+            return "macro_heavy";
+        case Workload::ByteTables:
+            return "byte_tables";
+        case Workload::IncludeChain:
+            return "include_chain";
+    }
+    throw std::logic_error("illegal state");
+}
+
+std::vector<SourceGenerator::Workload> SourceGenerator::all_workloads() {
+    return {Workload::LabelDense, Workload::MacroHeavy, Workload::ByteTables, Workload::IncludeChain};
+}
@@ -0,0 +1,68 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_SOURCEGENERATOR_H
+#define CS8_SOURCEGENERATOR_H
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Generate deterministic synthetic assembler sources for benchmarking.
+ *
+ * Every workload is written into its own directory together with the linker file and the
+ * standard macros, so that the generated sources assemble like regular programs.
+ * \author Maximilian Kroboth
+ */
+class SourceGenerator final {
+public:
+    enum class Workload {
+        ///! Many labels, each referenced by a branch.
+        LabelDense,
+        ///! Invocations of the macros from macros.cs8i.
+        MacroHeavy,
+        ///! Large .bytes tables in the data section.
+        ByteTables,
+        ///! A chain of nested .include files.
+        IncludeChain
+    };
+
+    struct GeneratedSource {
+        ///! The file to pass to the assembler.
+        std::filesystem::path main_file;
+        ///! The number of generated source lines over all files.
+        size_t lines;
+    };
+
+private:
+    std::filesystem::path m_examples_directory;
+    std::filesystem::path m_output_directory;
+
+    GeneratedSource generate_label_dense(std::filesystem::path const& directory, size_t size) const;
+    GeneratedSource generate_macro_heavy(std::filesystem::path const& directory, size_t size) const;
+    GeneratedSource generate_byte_tables(std::filesystem::path const& directory, size_t size) const;
+    GeneratedSource generate_include_chain(std::filesystem::path const& directory, size_t size) const;
+
+public:
+    /**
+     * \param examples_directory the directory containing cs8.cs8l and macros.cs8i
+     * \param output_directory the directory to generate the workloads in
+     */
+    SourceGenerator(std::filesystem::path examples_directory, std::filesystem::path output_directory);
+
+    /**
+     * \brief Generate the given workload.
+     * \param size the number of work items, e.g. labels, macro invocations, table rows or include depth
+     */
+    [[nodiscard]] GeneratedSource generate(Workload workload, size_t size) const;
+
+    [[nodiscard]] static std::string workload_name(Workload workload);
+
+    [[nodiscard]] static std::vector<Workload> all_workloads();
+};
+
+
+#endif //CS8_SOURCEGENERATOR_H
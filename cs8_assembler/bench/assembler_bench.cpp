@@ -0,0 +1,246 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "SourceGenerator.h"
+#include "CS8_Assembler.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <streambuf>
+#include <string_view>
+#include <tuple>
+
+#ifndef CS8_EXAMPLES_DIR
+#define CS8_EXAMPLES_DIR "examples"
+#endif
+
+/**
+ * Benchmark the assembler library on synthetic workloads.
+ *
+ * Every workload is assembled at several sizes. The result is a tab separated table with one row per
+ * workload, size and pass, followed by the scaling exponent of every pass between the smallest and the
+ * largest size. An exponent near 1 means linear scaling, an exponent near 2 quadratic scaling.
+ *
+ * Usage: cs8_assembler_bench [--sizes 1000,4000,16000] [--repetitions 3] [--output file]
+ *                            [--baseline file] [--tolerance 0.25] [--max-exponent 1.3]
+ *
+ * The exit code is 1 if any pass scales worse than --max-exponent or, with a baseline, if the time
+ * per node of any row regressed by more than the tolerance.
+ */
+
+namespace {
+    struct Options {
+        std::vector<size_t> sizes {1000, 4000, 16000};
+        size_t repetitions {3};
+        std::optional<std::filesystem::path> output;
+        std::optional<std::filesystem::path> baseline;
+        double tolerance {0.25};
+        double max_exponent {1.3};
+    };
+
+    struct Row {
+        std::string workload;
+        size_t size;
+        std::string pass;
+        size_t nodes;
+        int64_t wall_ns;
+        uint64_t allocations;
+        long peak_rss_delta;
+
+        [[nodiscard]] double ns_per_node() const {
+            return static_cast<double>(wall_ns) / static_cast<double>(std::max<size_t>(nodes, 1));
+        }
+    };
+
+    using row_key = std::tuple<std::string, size_t, std::string>;
+
+    /// Discards the listing the assembler writes to std::cout.
+    class NullBuffer final : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+
+    std::vector<size_t> parse_sizes(std::string_view list) {
+        std::vector<size_t> sizes;
+        std::stringstream stream{std::string(list)};
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            sizes.push_back(std::stoull(item));
+        }
+        std::sort(sizes.begin(), sizes.end());
+        return sizes;
+    }
+
+    Options parse_options(int argc, const char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string_view argument = argv[i];
+            auto value = [&]() -> std::string_view {
+                if (i + 1 >= argc) throw std::runtime_error(fmt::format("Missing value for {}", argument));
+                return argv[++i];
+            };
+
+            if (argument == "--sizes") options.sizes = parse_sizes(value());
+            else if (argument == "--repetitions") options.repetitions = std::stoull(std::string(value()));
+            else if (argument == "--output") options.output = value();
+            else if (argument == "--baseline") options.baseline = value();
+            else if (argument == "--tolerance") options.tolerance = std::stod(std::string(value()));
+            else if (argument == "--max-exponent") options.max_exponent = std::stod(std::string(value()));
+            else throw std::runtime_error(fmt::format("Unknown argument: {}", argument));
+        }
+        if (options.sizes.empty() || options.repetitions == 0) throw std::runtime_error("Nothing to measure");
+        return options;
+    }
+
+    /**
+     * Assemble the source several times and keep the fastest run of every pass.
+     */
+    std::vector<Row> measure(SourceGenerator::Workload workload, size_t size,
+                             SourceGenerator::GeneratedSource const& source,
+                             std::filesystem::path const& output, size_t repetitions) {
+        std::map<std::string, Row> best;
+        std::vector<std::string> order;
+
+        auto record = [&](Row row) {
+            if (!best.contains(row.pass)) {
+                order.push_back(row.pass);
+                best.emplace(row.pass, row);
+            } else if (row.wall_ns < best.at(row.pass).wall_ns) {
+                best.at(row.pass) = row;
+            }
+        };
+
+        NullBuffer null_buffer;
+        for (size_t repetition = 0; repetition < repetitions; ++repetition) {
+            cs8_assembler assembler;
+            assembler.set_time_passes(true);
+
+            auto* listing = std::cout.rdbuf(&null_buffer);
+            auto const start = std::chrono::steady_clock::now();
+            assembler.assemble(output, source.main_file);
+            auto const end = std::chrono::steady_clock::now();
+            std::cout.rdbuf(listing);
+
+            auto const name = SourceGenerator::workload_name(workload);
+            for (auto const& pass : assembler.get_pass_statistics()) {
+                record({name, size, pass.name, pass.nodes, pass.wall_time.count(),
+                        pass.allocations, pass.peak_rss_delta});
+            }
+            record({name, size, "end_to_end", source.lines,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), 0, 0});
+        }
+
+        std::vector<Row> rows;
+        for (auto const& pass : order) rows.push_back(best.at(pass));
+        return rows;
+    }
+
+    std::map<row_key, double> read_baseline(std::filesystem::path const& file) {
+        std::ifstream stream(file);
+        if (!stream) throw std::runtime_error("Cannot read baseline: " + file.string());
+
+        std::map<row_key, double> baseline;
+        std::string line;
+        while (std::getline(stream, line)) {
+            if (line.empty() || line.starts_with('#') || line.starts_with("scaling")) continue;
+
+            std::stringstream fields(line);
+            std::string workload, pass;
+            size_t size, nodes;
+            int64_t wall_ns;
+            double ns_per_node;
+            if (fields >> workload >> size >> pass >> nodes >> wall_ns >> ns_per_node) {
+                baseline[{workload, size, pass}] = ns_per_node;
+            }
+        }
+        return baseline;
+    }
+}
+
+int main(int argc, const char* argv[]) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (std::exception const& ex) {
+        std::cerr << ex.what() << '\n';
+        return 2;
+    }
+
+    auto const work_directory = std::filesystem::temp_directory_path() / "cs8_assembler_bench";
+    std::filesystem::create_directories(work_directory);
+    SourceGenerator generator(CS8_EXAMPLES_DIR, work_directory);
+
+    std::vector<Row> rows;
+    for (auto workload : SourceGenerator::all_workloads()) {
+        for (auto size : options.sizes) {
+            auto source = generator.generate(workload, size);
+            auto measured = measure(workload, size, source, work_directory / "bench.elf", options.repetitions);
+            rows.insert(rows.end(), measured.begin(), measured.end());
+        }
+    }
+
+    std::ofstream output_file;
+    if (options.output.has_value()) output_file.open(*options.output);
+    std::ostream& out = options.output.has_value() ? output_file : std::cout;
+
+    out << "# workload\tsize\tpass\tnodes\twall_ns\tns_per_node\tallocations\tpeak_rss_delta_kib\n";
+    for (auto const& row : rows) {
+        out << fmt::format("{}\t{}\t{}\t{}\t{}\t{:.1f}\t{}\t{}\n", row.workload, row.size, row.pass, row.nodes,
+                           row.wall_ns, row.ns_per_node(), row.allocations, row.peak_rss_delta);
+    }
+
+    bool failed = false;
+
+    // Compare the smallest and the largest size of every workload and pass.
+    out << "# scaling\tworkload\tpass\texponent\n";
+    std::map<std::pair<std::string, std::string>, std::pair<Row const*, Row const*>> extremes;
+    for (auto const& row : rows) {
+        auto& [smallest, largest] = extremes[{row.workload, row.pass}];
+        if (!smallest || row.size < smallest->size) smallest = &row;
+        if (!largest || row.size > largest->size) largest = &row;
+    }
+    for (auto const& [key, range] : extremes) {
+        auto const& [smallest, largest] = range;
+        if (smallest->size == largest->size || smallest->nodes == 0 || largest->nodes == 0) continue;
+
+        // Passes too fast to be measured reliably say nothing about scaling.
+        if (largest->wall_ns < 100'000) continue;
+
+        auto const exponent = std::log(static_cast<double>(std::max<int64_t>(largest->wall_ns, 1)) /
+                                       static_cast<double>(std::max<int64_t>(smallest->wall_ns, 1))) /
+                              std::log(static_cast<double>(largest->nodes) / static_cast<double>(smallest->nodes));
+        out << fmt::format("scaling\t{}\t{}\t{:.2f}\n", key.first, key.second, exponent);
+
+        if (exponent > options.max_exponent) {
+            std::cerr << fmt::format("FAIL: {} {} scales with exponent {:.2f} (limit {:.2f})\n",
+                                     key.first, key.second, exponent, options.max_exponent);
+            failed = true;
+        }
+    }
+
+    if (options.baseline.has_value()) {
+        auto const baseline = read_baseline(*options.baseline);
+        for (auto const& row : rows) {
+            row_key key {row.workload, row.size, row.pass};
+            if (!baseline.contains(key)) continue;
+
+            auto const reference = baseline.at(key);
+            if (row.ns_per_node() > reference * (1.0 + options.tolerance) && row.wall_ns >= 100'000) {
+                std::cerr << fmt::format("FAIL: {} {} {}: {:.1f} ns/node, baseline {:.1f} ns/node\n",
+                                         row.workload, row.size, row.pass, row.ns_per_node(), reference);
+                failed = true;
+            }
+        }
+    }
+
+    return failed ? 1 : 0;
+}
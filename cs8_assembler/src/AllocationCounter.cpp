@@ -0,0 +1,25 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+
+namespace {
+    std::atomic<uint64_t> allocation_count {0};
+    std::atomic<uint64_t> allocation_bytes {0};
+}
+
+uint64_t AllocationCounter::allocations() {
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::allocated_bytes() {
+    return allocation_bytes.load(std::memory_order_relaxed);
+}
+
+void AllocationCounter::record(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+}
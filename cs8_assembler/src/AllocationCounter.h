@@ -0,0 +1,29 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_ALLOCATIONCOUNTER_H
+#define CS8_ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief Counters of the global operator new.
+ *
+ * Only programs which link AllocationHooks.cpp count, it replaces the global operator new and delete with versions
+ * calling record(). Everything else linking the assembler library keeps the allocator of the C++ runtime and reads 0.
+ * Counting costs two relaxed atomic increments per allocation.
+ */
+namespace AllocationCounter {
+    ///! The number of allocations since program start.
+    uint64_t allocations();
+
+    ///! The number of bytes requested since program start.
+    uint64_t allocated_bytes();
+
+    ///! Count an allocation of the given size.
+    void record(std::size_t size);
+}
+
+#endif //CS8_ALLOCATIONCOUNTER_H
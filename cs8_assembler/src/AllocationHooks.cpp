@@ -0,0 +1,93 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+// Replaces the global operator new and delete with versions which count every allocation, see AllocationCounter.h.
+// Only linked into the programs which report allocations, never into the assembler library.
+
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+    void* counted_allocate(std::size_t size) {
+        AllocationCounter::record(size);
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* counted_allocate(std::size_t size, std::align_val_t alignment) {
+        AllocationCounter::record(size);
+        auto const align = static_cast<std::size_t>(alignment);
+        // aligned_alloc wants a size which is a multiple of the alignment.
+        return std::aligned_alloc(align, size == 0 ? align : (size + align - 1) / align * align);
+    }
+}
+
+void* operator new(std::size_t size) {
+    if (void* ptr = counted_allocate(size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* ptr = counted_allocate(size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept {
+    return counted_allocate(size);
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept {
+    return counted_allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* ptr = counted_allocate(size, alignment)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void* ptr = counted_allocate(size, alignment)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept {
+    return counted_allocate(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept {
+    return counted_allocate(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
@@ -15,8 +15,40 @@
 #include <map>
 #include <memory>
 #include <unordered_map>
+#include <variant>
+#include <span>
+#include <ostream>
+#include <stdexcept>
+#include "Expression.h"
+#include "SourceLocation.h"
 
 namespace AsmTree {
+    /**
+     * \brief Thrown when a value does not fit the operand it is assembled into.
+     */
+    class OperandRangeError final : public std::out_of_range {
+    public:
+        OperandRangeError(SourceLocation const& location, std::string const& operand, int64_t value, unsigned bits)
+        : std::out_of_range{error_prefix(location) + "Value " + std::to_string(value) + " does not fit the " +
+                            std::to_string(bits) + " bit operand of " + operand} {}
+    };
+
+    /**
+     * \brief Narrow a value to an operand of type T.
+     * Operands are signed or unsigned, so for n bits every value from -2^(n-1) to 2^n - 1 fits.
+     * \param location the source line of the operand
+     * \param operand the directive or instruction the operand belongs to
+     * \throws OperandRangeError when the value does not fit.
+     */
+    template<typename T>
+    [[nodiscard]] T narrow_operand(int64_t value, SourceLocation const& location, std::string const& operand) {
+        constexpr unsigned bits = 8 * sizeof(T);
+        if (value < -(int64_t{1} << (bits - 1)) || value >= (int64_t{1} << bits)) {
+            throw OperandRangeError(location, operand, value, bits);
+        }
+        return static_cast<T>(value);
+    }
+
     enum class AsmTreeType {
         Label,
         Instruction,
@@ -41,19 +73,118 @@ namespace AsmTree {
         std::unordered_map<std::string, label> label_map;
     };
 
+    /**
+     * \brief A run of bytes referenced by a directive, e.g. a string literal or an included binary file.
+     *
+     * The payload is owned through a shared pointer, so copying the operand never copies the bytes.
+     */
+    class ByteSpan {
+        std::shared_ptr<void const> m_owner;
+        std::span<uint8_t const> m_bytes;
+    public:
+        ByteSpan(std::shared_ptr<void const> owner, std::span<uint8_t const> bytes)
+        : m_owner{std::move(owner)}, m_bytes{bytes} {}
+
+        static ByteSpan from_string(std::string_view string) {
+            auto storage = std::make_shared<std::vector<uint8_t>>(string.begin(), string.end());
+            std::span<uint8_t const> bytes{storage->data(), storage->size()};
+            return {std::move(storage), bytes};
+        }
+
+        [[nodiscard]] std::span<uint8_t const> bytes() const { return m_bytes; }
+        [[nodiscard]] size_t size() const { return m_bytes.size(); }
+    };
+
+    /// A symbolic directive operand, e.g. a section name, a flag or a label.
+    struct Symbol {
+        std::string name;
+    };
+
+    using DirectiveOperand = std::variant<int64_t, Symbol, ByteSpan, Expression::pointer>;
+
     class AsmTreeDirective final : public AsmTreeNode {
     public:
         std::string name;
-        std::vector<std::string> args;
+        std::vector<DirectiveOperand> args;
         std::map<std::string, std::any> data;
+        ///! The source line the directive was assembled from.
+        SourceLocation location;
+
         [[nodiscard]] AsmTreeType get_type() const final {
             return AsmTreeType::Directive;
         }
 
+        /**
+         * \brief Create the error for a misused directive, naming its source line.
+         * \param message what is wrong, following the directive name
+         */
+        [[nodiscard]] std::logic_error error(std::string const& message) const {
+            return std::logic_error(error_prefix(location) + "Directive '" + name + "' " + message);
+        }
+
+        /**
+         * \brief The number parameter i narrowed to an operand of type T.
+         * \throws OperandRangeError when the value does not fit.
+         */
+        template<typename T>
+        [[nodiscard]] T operand_arg(size_t i) const {
+            return narrow_operand<T>(integer_arg(i), location, "directive '" + name + "'");
+        }
+
+        [[nodiscard]] int64_t integer_arg(size_t i) const {
+            if (auto const* value = std::get_if<int64_t>(&args.at(i))) return *value;
+            throw error("expects a number as parameter " + std::to_string(i));
+        }
+
+        [[nodiscard]] std::string const& symbol_arg(size_t i) const {
+            if (auto const* value = std::get_if<Symbol>(&args.at(i))) return value->name;
+            throw error("expects a symbol as parameter " + std::to_string(i));
+        }
+
+        [[nodiscard]] ByteSpan const& bytes_arg(size_t i) const {
+            if (auto const* value = std::get_if<ByteSpan>(&args.at(i))) return *value;
+            throw error("expects a string as parameter " + std::to_string(i));
+        }
+
+        /**
+         * \brief Determine how many bytes this directive occupies in its section.
+         * \param position the section position the directive is placed at
+         * \return the number of bytes emitted by the directive
+         * \throws std::logic_error for a negative count or an alignment which is not positive.
+         */
+        [[nodiscard]] size_t get_length(size_t position) const {
+            if (name == "byte") {
+                return args.size();
+            } else if (name == "word") {
+                return 2 * args.size();
+            } else if (name == "bytes" || name == "incbin") {
+                size_t length = 0;
+                for (auto const& arg : args) {
+                    if (auto const* span = std::get_if<ByteSpan>(&arg)) length += span->size();
+                    else length += 1;
+                }
+                return length;
+            } else if (name == "skip" || name == "zero" || name == "fill") {
+                auto const count = integer_arg(0);
+                if (count < 0) throw error("expects a count which is not negative, got " + std::to_string(count));
+                return static_cast<size_t>(count);
+            } else if (name == "align") {
+                auto const value = integer_arg(0);
+                if (value <= 0) throw error("expects a positive alignment, got " + std::to_string(value));
+                auto const alignment = static_cast<size_t>(value);
+                return (alignment - position % alignment) % alignment;
+            }
+            return 0;
+        }
+
         void to_ostream(std::ostream &os) const override {
             os << "Directive\t" << name << " ";
             for(auto const& arg: args) {
-                os << arg << " ";
+                if (auto const* value = std::get_if<int64_t>(&arg)) os << *value;
+                else if (auto const* symbol = std::get_if<Symbol>(&arg)) os << symbol->name;
+                else if (auto const* expression = std::get_if<Expression::pointer>(&arg)) os << **expression;
+                else os << "<" << std::get<ByteSpan>(arg).size() << " bytes>";
+                os << " ";
             }
 
             os << '\n';
@@ -97,11 +228,15 @@ namespace AsmTree {
             Multiply,
             DivideModulo,
             Nand,
-            JumpIfLessOrEqual, RestoreTMP, Jump, RotateRight, And, Or, ShiftRight, Invert, ShiftLeft, RotateLeft
+            JumpIfLessOrEqual, RestoreTMP, Jump, WaitForInterrupt, ReturnFromInterrupt,
+            RotateRight, And, Or, ShiftRight, Invert, ShiftLeft, RotateLeft
         };
 
         class AsmTreeInstructionNode : public AsmTreeNode {
         public:
+            ///! The source line the instruction was assembled from.
+            SourceLocation location;
+
             [[nodiscard]] AsmTreeType get_type() const final { return AsmTreeType::Instruction; }
             [[nodiscard]] virtual AsmTreeInstructionType get_instruction_type() const = 0;
 
@@ -186,6 +321,10 @@ namespace AsmTree {
                     return "Jump";
                 case AsmTreeInstructionType::RestoreTMP:
                     return "RestoreTMP";
+                case AsmTreeInstructionType::WaitForInterrupt:
+                    return "Wait for Interrupt";
+                case AsmTreeInstructionType::ReturnFromInterrupt:
+                    return "Return from Interrupt";
                 case AsmTreeInstructionType::RotateRight:
                     return "Rotate Right";
                 case AsmTreeInstructionType::And:
@@ -207,14 +346,14 @@ namespace AsmTree {
         class AsmTreeLoadImmediateInstruction final : public AsmTreeInstruction3BNode {
         public:
             std::optional<uint16_t> immediate{0};
-            std::optional<std::string> label;
+            Expression::pointer expression;
 
             void to_ostream(std::ostream &os) const override {
                 os << "Instruction\t" << instruction_type_to_string(get_instruction_type()) << "\t";
 
-                if(label.has_value()) {
-                    os << *label << "(" << std::hex;
-                    if(immediate.has_value()) os << "0x" <<  *immediate;
+                if(expression) {
+                    os << *expression << "(" << std::hex;
+                    if(immediate.has_value()) os << "0x" << *immediate;
                     else os << "?";
                     os <<std::dec << ")\n";
                 } else {
@@ -240,14 +379,14 @@ namespace AsmTree {
         class AsmTreeLoadDirectInstruction final : public AsmTreeInstruction3BNode {
         public:
             std::optional<uint16_t> address;
-            std::optional<std::string> label;
+            Expression::pointer expression;
 
             void to_ostream(std::ostream &os) const override {
                 os << "Instruction\t" << instruction_type_to_string(get_instruction_type()) << "\t";
 
-                if(label.has_value()) {
-                    os << *label << "(" << std::hex;
-                    if(address.has_value())  os << "0x" << *address;
+                if(expression) {
+                    os << *expression << "(" << std::hex;
+                    if(address.has_value()) os << "0x" << *address;
                     else os << "?";
                     os << std::dec << ")\n";
                 } else {
@@ -273,13 +412,13 @@ namespace AsmTree {
         class AsmTreeStoreDirectInstruction final : public AsmTreeInstruction3BNode {
         public:
             std::optional<int16_t> address{};
-            std::optional<std::string> label;
+            Expression::pointer expression;
 
             void to_ostream(std::ostream &os) const final {
                 os << "Instruction\t" << instruction_type_to_string(get_instruction_type()) << "\t";
 
-                if(label.has_value()) {
-                    os << *label << "(" << std::hex ;
+                if(expression) {
+                    os << *expression << "(" << std::hex;
                     if(address.has_value()) os << "0x" << *address;
                     else os << "?";
                     os << std::dec << ")\n";
@@ -669,6 +808,30 @@ namespace AsmTree {
             return{0x2F};
         }
         };
+        class AsmTreeWaitForInterruptInstruction final : public AsmTreeInstruction1BNode {
+        public:void to_ostream(std::ostream &os) const override {
+            os << "Instruction\t" << instruction_type_to_string(get_instruction_type()) << "\n";
+        }
+        [[nodiscard]] AsmTreeInstructionType get_instruction_type() const override {
+            return AsmTreeInstructionType::WaitForInterrupt;
+        }
+
+        [[nodiscard]] std::array<uint8_t, 1> emit() const final {
+            return{0x3F};
+        }
+        };
+        class AsmTreeReturnFromInterruptInstruction final : public AsmTreeInstruction1BNode {
+        public:void to_ostream(std::ostream &os) const override {
+            os << "Instruction\t" << instruction_type_to_string(get_instruction_type()) << "\n";
+        }
+        [[nodiscard]] AsmTreeInstructionType get_instruction_type() const override {
+            return AsmTreeInstructionType::ReturnFromInterrupt;
+        }
+
+        [[nodiscard]] std::array<uint8_t, 1> emit() const final {
+            return{0x4F};
+        }
+        };
     }
 
 
@@ -3,15 +3,30 @@
 //
 
 #include "AsmTreeTransformer.h"
+#include "MappedFile.h"
 #include <limits>
 #include <ranges>
 
 AsmTree::AsmTree AsmTreeTransformer::transform(const AstRootNode &ast) {
+    PassTimer disabled_timer(false);
+    return transform(ast, disabled_timer);
+}
+
+AsmTree::AsmTree AsmTreeTransformer::transform(const AstRootNode &ast, PassTimer &timer) {
     AsmTree::AsmTree result;
 
+    auto scan = timer.start("label_scan");
     label_scan(ast.get_lines());
+    scan.finish(m_labels.size());
+
+    auto translation = timer.start("translation");
+    result.nodes.reserve(ast.get_lines().size());
     translate_lines(result.nodes, ast.get_lines());
+    translation.finish(result.nodes.size());
+
+    auto numbering = timer.start("label_numbering");
     number_labels(result.nodes);
+    numbering.finish(m_label_map.size());
 
     result.label_map = this->m_label_map;
     return result;
@@ -109,36 +124,50 @@ namespace translate_instruction {
     }
 
 
-    instruction_node *limm(labels const& labels, AstInstruction const &instruction) {
-        auto ptr = new AsmTree::Instruction::AsmTreeLoadImmediateInstruction;
-
-        require_instruction_parameter_size(instruction, "limm", 1);
-
-        auto const &parameter0 = instruction.get_parameter(0);
-
-        switch (parameter0->get_type()) {
-            case AstNodeType::SymbolParameter: {
-                auto const &parameter = dynamic_cast<AstSymbolParameter const &>(*parameter0);
-
-                if (labels.contains(parameter.get_name())) {
-                    ptr->label = std::make_optional(
-                            parameter.get_name());
-                } else
-                    throw std::logic_error(
-                            "given symbol is not a label");
-
+    /**
+     * \brief Translate the address or immediate operand of an instruction.
+     * Numbers are stored directly, symbols and expressions are kept for evaluation during label numbering.
+     * \param labels all labels of the program
+     * \param instruction the instruction the operand belongs to
+     * \param value the numeric value of the operand
+     * \param expression the deferred expression of the operand
+     * \throws std::logic_error when the operand references a symbol that is not a label.
+     * \throws AsmTree::OperandRangeError when a number does not fit 16 bits.
+     */
+    template<typename T>
+    void translate_value_operand(labels const& labels, AstInstruction const &instruction,
+                                 std::optional<T> &value, Expression::pointer &expression) {
+        auto const &parameter = *instruction.get_parameter(0);
+        switch (parameter.get_type()) {
+            case AstNodeType::SymbolParameter:
+            case AstNodeType::ExpressionParameter: {
+                expression = to_expression(parameter);
+                expression->for_each_symbol([&](std::string const& name) {
+                    if (!labels.contains(name))
+                        throw std::logic_error(
+                                "given symbol is not a label: " + name);
+                });
+                value = std::nullopt;
             }
                 break;
 
             case AstNodeType::NumberParameter: {
-                auto const &parameter = dynamic_cast<AstNumberParameter const &>(*parameter0);
-                ptr->immediate = std::bit_cast<int16_t>(
-                        static_cast<uint16_t>(parameter.get_value()));
+                auto const &number = dynamic_cast<AstNumberParameter const &>(parameter);
+                value = std::bit_cast<int16_t>(AsmTree::narrow_operand<uint16_t>(
+                        number.get_value(), instruction.get_location(), "instruction '" + instruction.get_name() + "'"));
             }
                 break;
             default:
                 throw std::logic_error("Invalid parameter");
         }
+    }
+
+    instruction_node *limm(labels const& labels, AstInstruction const &instruction) {
+        auto ptr = new AsmTree::Instruction::AsmTreeLoadImmediateInstruction;
+
+        require_instruction_parameter_size(instruction, "limm", 1);
+
+        translate_value_operand(labels, instruction, ptr->immediate, ptr->expression);
         return ptr;
     }
 
@@ -147,31 +176,7 @@ namespace translate_instruction {
 
         require_instruction_parameter_size(instruction, "lmem", 1);
 
-        auto const &parameter0 = instruction.get_parameter(0);
-
-        switch (parameter0->get_type()) {
-            case AstNodeType::SymbolParameter: {
-                auto const &parameter = dynamic_cast<AstSymbolParameter const &>(*parameter0);
-
-                if (labels.contains(parameter.get_name())) {
-                    ptr->label = std::make_optional(
-                            parameter.get_name());
-                } else
-                    throw std::logic_error(
-                            "given symbol is not a label");
-
-            }
-                break;
-
-            case AstNodeType::NumberParameter: {
-                auto const &parameter = dynamic_cast<AstNumberParameter const &>(*parameter0);
-                ptr->address = std::bit_cast<int16_t>(
-                        static_cast<uint16_t>(parameter.get_value()));
-            }
-                break;
-            default:
-                throw std::logic_error("Invalid parameter");
-        }
+        translate_value_operand(labels, instruction, ptr->address, ptr->expression);
         return ptr;
     }
 
@@ -180,31 +185,7 @@ namespace translate_instruction {
 
         require_instruction_parameter_size(instruction, "smem", 1);
 
-        auto const &parameter0 = instruction.get_parameter(0);
-
-        switch (parameter0->get_type()) {
-            case AstNodeType::SymbolParameter: {
-                auto const &parameter = dynamic_cast<AstSymbolParameter const &>(*parameter0);
-
-                if (labels.contains(parameter.get_name())) {
-                    ptr->label = std::make_optional(
-                            parameter.get_name());
-                } else
-                    throw std::logic_error(
-                            "given symbol is not a label");
-
-            }
-                break;
-
-            case AstNodeType::NumberParameter: {
-                auto const &parameter = dynamic_cast<AstNumberParameter const &>(*parameter0);
-                ptr->address = std::bit_cast<int16_t>(
-                        static_cast<uint16_t>(parameter.get_value()));
-            }
-                break;
-            default:
-                throw std::logic_error("Invalid parameter");
-        }
+        translate_value_operand(labels, instruction, ptr->address, ptr->expression);
         return ptr;
     }
 
@@ -365,6 +346,22 @@ namespace translate_instruction {
         return ptr;
     }
 
+    instruction_node *wfi(labels const& labels, AstInstruction const &instruction) {
+        auto ptr = new AsmTree::Instruction::AsmTreeWaitForInterruptInstruction;
+
+        require_instruction_parameter_size(instruction, "wfi", 0);
+
+        return ptr;
+    }
+
+    instruction_node *rti(labels const& labels, AstInstruction const &instruction) {
+        auto ptr = new AsmTree::Instruction::AsmTreeReturnFromInterruptInstruction;
+
+        require_instruction_parameter_size(instruction, "rti", 0);
+
+        return ptr;
+    }
+
     instruction_node *tr(labels const& labels, AstInstruction const &instruction) {
         auto ptr = new AsmTree::Instruction::AsmTreeTransferRegisterInstruction;
 
@@ -425,6 +422,8 @@ AsmTreeTransformer::decode_instruction(AstInstruction const &instruction) const
             {"jle",    translate_instruction::jle},
             {"jmp",    translate_instruction::jmp},
             {"rtm",    translate_instruction::rtm},
+            {"wfi",    translate_instruction::wfi},
+            {"rti",    translate_instruction::rti},
             {"tr",     translate_instruction::tr},
     };
 
@@ -463,36 +462,38 @@ void AsmTreeTransformer::number_labels(
                 auto const &directive = dynamic_cast<AsmTree::AsmTreeDirective const &>(*node);
 
                 if (directive.name == "section") {
-                    auto section_name = directive.args.at(0);
+                    auto section_name = directive.symbol_arg(0);
 
                     if (!sections.contains(section_name)) {
-                        sections[section_name] = std::stoull(
-                                directive.args.at(1));
+                        sections[section_name] = static_cast<size_t>(directive.integer_arg(1));
                     }
 
                     current_section = section_name;
                     position = &sections.at(current_section);
 
-                } else if (directive.name == "skip") {
-                    *position += std::stoull(directive.args.at(0));
-                } else if (directive.name == "byte") {
-                    *position += 1;
-                } else if (directive.name == "word") {
-                    *position += 2;
-                } else if (directive.name == "bytes") {
-                    *position += directive.args.size();
+                } else {
+                    *position += directive.get_length(*position);
                 }
             }
                 break;
         }
+    }
 
+    this->m_label_map.clear();
+    std::transform(positions.begin(), positions.end(), std::inserter(this->m_label_map, this->m_label_map.end()),
+                   [&](std::pair<std::string, std::pair<size_t, std::string>> const& p) {
+        return std::pair { p.first, AsmTree::AsmTree::label {p.second.first, p.second.second }};
+    });
 
-        this->m_label_map.clear();
-        std::transform(positions.begin(), positions.end(), std::inserter(this->m_label_map, this->m_label_map.end()),
-                       [&](std::pair<std::string, std::pair<size_t, std::string>> const& p) {
-            return std::pair { p.first, AsmTree::AsmTree::label {p.second.first, p.second.second }};
-        });
-    }
+    auto resolve_symbol = [&](std::string const& name) -> std::optional<int64_t> {
+        if (positions.contains(name)) return static_cast<int64_t>(positions.at(name).first);
+        return std::nullopt;
+    };
+    auto evaluate_operand = [&](AsmTree::Instruction::AsmTreeInstructionNode const& instruction,
+                                Expression const& expression) {
+        return AsmTree::narrow_operand<uint16_t>(expression.evaluate(resolve_symbol), instruction.location,
+                "instruction '" + AsmTree::Instruction::instruction_type_to_string(instruction.get_instruction_type()) + "'");
+    };
 
     for (auto &node : nodes) {
         switch (node->get_type()) {
@@ -504,36 +505,24 @@ void AsmTreeTransformer::number_labels(
                     case AsmTree::Instruction::AsmTreeInstructionType::LoadImmediate: {
                         auto &instr = dynamic_cast<AsmTree::Instruction::AsmTreeLoadImmediateInstruction &>(instruction);
 
-                        if (instr.label.has_value()) {
-                            if (positions.contains(*instr.label)) {
-                                auto v = std::bit_cast<int16_t>(
-                                        (uint16_t) positions.at(*instr.label).first);
-                                instr.immediate = v;
-                            }
+                        if (instr.expression) {
+                            instr.immediate = evaluate_operand(instr, *instr.expression);
                         }
                     }
                         break;
                     case AsmTree::Instruction::AsmTreeInstructionType::LoadDirect: {
-                        {
-                            auto &instr = dynamic_cast<AsmTree::Instruction::AsmTreeLoadDirectInstruction &>(instruction);
-
-                            if (instr.label.has_value()) {
-                                if (positions.contains(*instr.label)) {
-                                    instr.address = positions.at(*instr.label).first;
-                                }
-                            }
+                        auto &instr = dynamic_cast<AsmTree::Instruction::AsmTreeLoadDirectInstruction &>(instruction);
+
+                        if (instr.expression) {
+                            instr.address = evaluate_operand(instr, *instr.expression);
                         }
                     }
                         break;
                     case AsmTree::Instruction::AsmTreeInstructionType::StoreDirect: {
-                        {
-                            auto &instr = dynamic_cast<AsmTree::Instruction::AsmTreeStoreDirectInstruction &>(instruction);
-
-                            if (instr.label.has_value()) {
-                                if (positions.contains(*instr.label)) {
-                                    instr.address = positions.at(*instr.label).first;
-                                }
-                            }
+                        auto &instr = dynamic_cast<AsmTree::Instruction::AsmTreeStoreDirectInstruction &>(instruction);
+
+                        if (instr.expression) {
+                            instr.address = std::bit_cast<int16_t>(evaluate_operand(instr, *instr.expression));
                         }
                     }
                         break;
@@ -541,6 +530,22 @@ void AsmTreeTransformer::number_labels(
                         break;
                 }
 
+            }
+                break;
+            case AsmTree::AsmTreeType::Directive: {
+                auto &directive = dynamic_cast<AsmTree::AsmTreeDirective &>(*node);
+
+                // Data directives may contain label arithmetic, e.g. jump tables or precomputed offsets.
+                if (directive.name == "byte" || directive.name == "word" || directive.name == "bytes" ||
+                    directive.name == "vector") {
+                    for (auto &arg : directive.args) {
+                        if (auto const *symbol = std::get_if<AsmTree::Symbol>(&arg)) {
+                            arg = Expression::symbol(symbol->name)->evaluate(resolve_symbol);
+                        } else if (auto const *expression = std::get_if<Expression::pointer>(&arg)) {
+                            arg = (*expression)->evaluate(resolve_symbol);
+                        }
+                    }
+                }
             }
                 break;
             default:
@@ -553,38 +558,77 @@ void AsmTreeTransformer::number_labels(
 AsmTree::AsmTreeNode *AsmTreeTransformer::translate_directive_node(AstDirective const& input) {
     auto *directive = new AsmTree::AsmTreeDirective;
     directive->name = input.get_name();
+    directive->location = input.get_location();
 
+    if (directive->name == "incbin") {
+        directive->args.emplace_back(translate_incbin_operand(input));
+        return directive;
+    }
+
+    directive->args.reserve(input.get_parameters().size());
     for (auto const &x: input.get_parameters()) {
         switch (x->get_type()) {
             default:
                 throw std::runtime_error("Invalid node type");
 
             case AstNodeType::SymbolParameter:
-                directive->args.push_back(
-                        dynamic_cast<AstSymbolParameter const &>(*x).get_name());
+                directive->args.emplace_back(AsmTree::Symbol{
+                        dynamic_cast<AstSymbolParameter const &>(*x).get_name()});
                 break;
 
             case AstNodeType::RegisterParameter:
-                directive->args.push_back(
-                        dynamic_cast<AstRegisterParameter const &>(*x).get_name());
+                directive->args.emplace_back(AsmTree::Symbol{
+                        dynamic_cast<AstRegisterParameter const &>(*x).get_name()});
                 break;
 
             case AstNodeType::NumberParameter:
-                directive->args.push_back(std::to_string(
+                directive->args.emplace_back(static_cast<int64_t>(
                         dynamic_cast<AstNumberParameter const &>(*x).get_value()));
                 break;
-            case AstNodeType::StringParameter: {
-                auto const &string = dynamic_cast<AstStringParameter const &>(*x).get_name();
-                for (char c : string) {
-                    directive->args.push_back(std::to_string((int) c));
-                }
+            case AstNodeType::ExpressionParameter:
+                directive->args.emplace_back(
+                        dynamic_cast<AstExpressionParameter const &>(*x).get_expression());
+                break;
+            case AstNodeType::StringParameter:
+                directive->args.emplace_back(AsmTree::ByteSpan::from_string(
+                        dynamic_cast<AstStringParameter const &>(*x).get_name()));
                 break;
-            }
         }
     }
     return directive;
 }
 
+AsmTree::ByteSpan AsmTreeTransformer::translate_incbin_operand(AstDirective const& input) {
+    auto const& parameters = input.get_parameters();
+    if (parameters.empty() || parameters.size() > 3) {
+        throw std::logic_error("Directive 'incbin' expects a file name and an optional offset and length");
+    }
+
+    auto const& file_parameter = input.get_parameter(0);
+    if (file_parameter->get_type() != AstNodeType::StringParameter) {
+        throw std::logic_error("Directive 'incbin' expects a file name as first parameter");
+    }
+
+    auto file = std::make_shared<MappedFile const>(
+            dynamic_cast<AstStringParameter const &>(*file_parameter).get_name());
+    auto bytes = file->bytes();
+
+    auto number_parameter = [&](size_t i) {
+        auto const& parameter = input.get_parameter(i);
+        if (parameter->get_type() != AstNodeType::NumberParameter) {
+            throw std::logic_error("Directive 'incbin' expects numbers as offset and length");
+        }
+        return static_cast<size_t>(dynamic_cast<AstNumberParameter const &>(*parameter).get_value());
+    };
+
+    size_t const offset = parameters.size() > 1 ? number_parameter(1) : 0;
+    if (offset > bytes.size()) throw std::logic_error("Directive 'incbin' offset exceeds the file size");
+    size_t const length = parameters.size() > 2 ? number_parameter(2) : bytes.size() - offset;
+    if (length > bytes.size() - offset) throw std::logic_error("Directive 'incbin' length exceeds the file size");
+
+    return {std::move(file), bytes.subspan(offset, length)};
+}
+
 AsmTree::AsmTreeNode *AsmTreeTransformer::translate_label_node(AstLabel const& input) {
     auto *label = new AsmTree::AsmTreeLabel;
     label->name = input.get_name();
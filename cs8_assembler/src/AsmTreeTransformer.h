@@ -9,6 +9,7 @@
 #include <unordered_set>
 #include "AsmTree.h"
 #include "Ast.h"
+#include "PassTimer.h"
 #include <fmt/format.h>
 
 using namespace std::literals;
@@ -110,7 +111,9 @@ private:
      * \return a new pointer to the created instruction node.
      */
     [[nodiscard]] inline AsmTree::AsmTreeNode* translate_instruction_node(AstInstruction const& node) const {
-        return decode_instruction(node);
+        auto* instruction = decode_instruction(node);
+        instruction->location = node.get_location();
+        return instruction;
     }
 
     /**
@@ -120,6 +123,13 @@ private:
      */
     [[nodiscard]] static AsmTree::AsmTreeNode* translate_directive_node(AstDirective const& node);
 
+    /**
+     * \brief Map the file named by an incbin directive and select the requested byte range.
+     * \param node the ast line node representing an incbin directive
+     * \return a byte span over the mapped file.
+     */
+    [[nodiscard]] static AsmTree::ByteSpan translate_incbin_operand(AstDirective const& node);
+
     /**
      * \brief Translate the given ast line node to an asmtree node
      * \param node the ast line node representing a label
@@ -135,6 +145,13 @@ public:
     [[nodiscard]]
     AsmTree::AsmTree transform(AstRootNode const&);
 
+    /**
+     * \brief Transform the given Ast into an AsmTree and measure the label scan, translation and label numbering passes.
+     * \return the resulting AsmTree
+     */
+    [[nodiscard]]
+    AsmTree::AsmTree transform(AstRootNode const&, PassTimer& timer);
+
 };
 
 
@@ -11,13 +11,16 @@
 #include <cstring>
 #include <functional>
 #include <cassert>
+#include <stdexcept>
+#include "Expression.h"
+#include "SourceLocation.h"
 
 enum class AstNodeType {
     Root,
     Instruction,
     Directive,
     Redact, SymbolParameter, RegisterParameter, NumberParameter, ReplaceSymbolParameter, Label,
-    StringParameter
+    StringParameter, ExpressionParameter
 };
 
 class AstNode {
@@ -40,8 +43,12 @@ public:
 
 
 class AstLineNode : public AstNode {
+    SourceLocation location;
 public:
     virtual AstLineNode* duplicate() const = 0;
+
+    [[nodiscard]] SourceLocation const& get_location() const { return location; }
+    void set_location(SourceLocation const& value) { location = value; }
 };
 class Macro {
     std::string name;
@@ -174,7 +181,7 @@ public:
     }
 
     explicit AstInstruction(std::string_view name): name{name} {}
-    AstInstruction(AstInstruction const& other): name{other.name} {
+    AstInstruction(AstInstruction const& other): AstLineNode(other), name{other.name} {
         for (auto const& param : other.parameters) {
             this->parameters.push_back(std::unique_ptr<AstParameterNode>(param->duplicate()));
         }
@@ -267,7 +274,7 @@ public:
     }
 
     explicit AstDirective(std::string_view name): name{name} {}
-    AstDirective(AstDirective const& other): name{other.name} {
+    AstDirective(AstDirective const& other): AstLineNode(other), name{other.name} {
         for (auto const& param : other.parameters) {
             this->parameters.push_back(std::unique_ptr<AstParameterNode>(param->duplicate()));
         }
@@ -328,7 +335,7 @@ public:
 };
 
 class AstNumberParameter final : public AstParameterNode {
-    int value;
+    int64_t value;
 public:
     void print_repr(std::ostream &ostream) override {
         if(value > 30) {
@@ -344,7 +351,7 @@ public:
         return AstNodeType::NumberParameter;
     }
 
-    explicit AstNumberParameter(int value): value{value} {}
+    explicit AstNumberParameter(int64_t value): value{value} {}
     AstNumberParameter(AstNumberParameter const& other): value{other.value} {}
 
     [[nodiscard]] AstParameterNode* duplicate() const override {
@@ -352,7 +359,7 @@ public:
         return result;
     }
 
-    int get_value() const {
+    int64_t get_value() const {
         return value;
     }
 
@@ -440,6 +447,51 @@ public:
         ostream << "StringParameter[content=\"" << name << "\"]";
     }
 };
+class AstExpressionParameter final : public AstParameterNode {
+    Expression::pointer expression;
+public:
+    void print_repr(std::ostream &ostream) override {
+        ostream << *expression;
+    }
+
+    [[nodiscard]] Expression::pointer const& get_expression() const { return expression; }
+
+    [[nodiscard]] AstNodeType get_type() const noexcept override {
+        return AstNodeType::ExpressionParameter;
+    }
+
+    explicit AstExpressionParameter(Expression::pointer expression): expression{std::move(expression)} {}
+    AstExpressionParameter(AstExpressionParameter const& other): expression{other.expression} {}
+
+    [[nodiscard]] AstParameterNode* duplicate() const override {
+        auto* result = new AstExpressionParameter(*this);
+        return result;
+    }
+
+    void write_to_ostream(std::ostream &ostream, const AstNode &node) const override {
+        ostream << "ExpressionParameter[" << *expression << "]";
+    }
+};
+
+/**
+ * \brief Convert a parameter that may take part in an expression to its expression.
+ * \throws std::logic_error when the parameter cannot be used in an expression, e.g. a register.
+ */
+inline Expression::pointer to_expression(AstParameterNode const& parameter) {
+    switch (parameter.get_type()) {
+        case AstNodeType::NumberParameter:
+            return Expression::number(dynamic_cast<AstNumberParameter const&>(parameter).get_value());
+        case AstNodeType::SymbolParameter:
+            return Expression::symbol(dynamic_cast<AstSymbolParameter const&>(parameter).get_name());
+        case AstNodeType::ReplaceSymbolParameter:
+            return Expression::replace_symbol(dynamic_cast<AstReplaceSymbolParameter const&>(parameter).get_name());
+        case AstNodeType::ExpressionParameter:
+            return dynamic_cast<AstExpressionParameter const&>(parameter).get_expression();
+        default:
+            throw std::logic_error("Parameter cannot be used in an expression");
+    }
+}
+
 class AstLabel final : public AstLineNode {
     std::string name;
 public:
@@ -457,7 +509,7 @@ public:
     }
 
     explicit AstLabel(std::string_view name): name{name} {}
-    AstLabel(AstLabel const& other): name{other.name} {}
+    AstLabel(AstLabel const& other): AstLineNode(other), name{other.name} {}
 
     [[nodiscard]] AstLineNode* duplicate() const override {
         auto* result = new AstLabel(*this);
@@ -499,7 +551,7 @@ public:
         return list;
     }
 
-    AstNumberParameter* new_number_parameter(int value) {
+    AstNumberParameter* new_number_parameter(int64_t value) {
         auto* param = new AstNumberParameter(value);
         allocated_nodes.push_front(param);
         return param;
@@ -528,6 +580,26 @@ public:
         return param;
     }
 
+    /**
+     * \brief Create the parameter node for an expression.
+     * Constant expressions become number parameters, bare symbols become symbol parameters.
+     */
+    AstParameterNode* new_expression_parameter(Expression::pointer const& expression) {
+        switch (expression->get_operator()) {
+            case Expression::Operator::Number:
+                return new_number_parameter(expression->get_value());
+            case Expression::Operator::Symbol:
+                return new_symbol_parameter(expression->get_name());
+            case Expression::Operator::ReplaceSymbol:
+                return new_replace_symbol_parameter(expression->get_name());
+            default: {
+                auto* param = new AstExpressionParameter(expression);
+                allocated_nodes.push_front(param);
+                return param;
+            }
+        }
+    }
+
     AstRedactLine* new_redact_line() {
         auto* ptr = new AstRedactLine();
         allocated_nodes.push_front(ptr);
@@ -6,13 +6,40 @@
 #define CS8_CS8_ASSEMBLER_HXX
 #include <filesystem>
 #include <iostream>
+#include <vector>
+#include "PassTimer.h"
+#include "asm_tree_emitter.hxx"
 
 class cs8_assembler {
+    bool m_time_passes {false};
+    AsmTreeEmitter::OutputFormat m_output_format {AsmTreeEmitter::OutputFormat::Elf64};
+    std::vector<PassStatistics> m_pass_statistics;
+
 public:
     void assemble(std::filesystem::path const &output,
                   std::filesystem::path const &input);
 
     void assemble(std::ostream &output, std::istream &input); //<!TODO
+
+    /**
+     * \brief Enable or disable measuring the assembler passes of following assemble calls.
+     */
+    void set_time_passes(bool enabled) { m_time_passes = enabled; }
+
+    /**
+     * \brief Choose the file format of following assemble calls, ELF64 by default.
+     */
+    void set_output_format(AsmTreeEmitter::OutputFormat format) { m_output_format = format; }
+
+    /**
+     * \brief Get the statistics of the passes of the last assemble call, empty unless time passes is enabled.
+     */
+    [[nodiscard]] std::vector<PassStatistics> const& get_pass_statistics() const { return m_pass_statistics; }
+
+    /**
+     * \brief Write the statistics of the last assemble call as a JSON document.
+     */
+    void write_pass_report(std::ostream &output) const;
 };
 
 
@@ -0,0 +1,123 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "Expression.h"
+
+#include <stdexcept>
+
+Expression::pointer Expression::number(int64_t value) {
+    return std::make_shared<Expression const>(Operator::Number, value, "", nullptr, nullptr);
+}
+
+Expression::pointer Expression::symbol(std::string_view name) {
+    return std::make_shared<Expression const>(Operator::Symbol, 0, name, nullptr, nullptr);
+}
+
+Expression::pointer Expression::replace_symbol(std::string_view name) {
+    return std::make_shared<Expression const>(Operator::ReplaceSymbol, 0, name, nullptr, nullptr);
+}
+
+Expression::pointer Expression::binary(Operator op, pointer lhs, pointer rhs) {
+    auto result = std::make_shared<Expression const>(op, 0, "", std::move(lhs), std::move(rhs));
+    if (result->is_constant()) {
+        return number(result->evaluate([](auto const&) { return std::nullopt; }));
+    }
+    return result;
+}
+
+Expression::pointer Expression::unary(Operator op, pointer operand) {
+    return binary(op, std::move(operand), nullptr);
+}
+
+Expression::pointer Expression::function(std::string_view name, pointer operand) {
+    if (name == "hi") return unary(Operator::High, std::move(operand));
+    if (name == "lo") return unary(Operator::Low, std::move(operand));
+    throw std::logic_error("Unknown function: " + std::string(name));
+}
+
+bool Expression::is_constant() const {
+    switch (m_operator) {
+        case Operator::Number:
+            return true;
+        case Operator::Symbol:
+        case Operator::ReplaceSymbol:
+            return false;
+        default:
+            return m_lhs->is_constant() && (!m_rhs || m_rhs->is_constant());
+    }
+}
+
+void Expression::for_each_symbol(std::function<void(std::string const&)> const& f) const {
+    if (m_operator == Operator::Symbol) f(m_name);
+    if (m_lhs) m_lhs->for_each_symbol(f);
+    if (m_rhs) m_rhs->for_each_symbol(f);
+}
+
+int64_t Expression::evaluate(symbol_resolver const& resolver) const {
+    switch (m_operator) {
+        case Operator::Number:
+            return m_value;
+        case Operator::Symbol:
+            if (auto value = resolver(m_name); value.has_value()) return *value;
+            throw std::logic_error("Unknown symbol: " + m_name);
+        case Operator::ReplaceSymbol:
+            throw std::logic_error("Unexpanded macro parameter: \\" + m_name);
+        case Operator::Add:
+            return m_lhs->evaluate(resolver) + m_rhs->evaluate(resolver);
+        case Operator::Subtract:
+            return m_lhs->evaluate(resolver) - m_rhs->evaluate(resolver);
+        case Operator::Multiply:
+            return m_lhs->evaluate(resolver) * m_rhs->evaluate(resolver);
+        case Operator::Divide: {
+            auto const divisor = m_rhs->evaluate(resolver);
+            if (divisor == 0) throw std::logic_error("Division by zero in expression");
+            return m_lhs->evaluate(resolver) / divisor;
+        }
+        case Operator::Negate:
+            return -m_lhs->evaluate(resolver);
+        case Operator::High:
+            return (m_lhs->evaluate(resolver) >> 8) & 0xFF;
+        case Operator::Low:
+            return m_lhs->evaluate(resolver) & 0xFF;
+    }
+    throw std::logic_error("illegal state");
+}
+
+Expression::pointer Expression::substitute(replacement_provider const& provider) const {
+    switch (m_operator) {
+        case Operator::Number:
+        case Operator::Symbol:
+            return shared_from_this();
+        case Operator::ReplaceSymbol:
+            return provider(m_name);
+        default:
+            return binary(m_operator, m_lhs->substitute(provider), m_rhs ? m_rhs->substitute(provider) : nullptr);
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, Expression const& expression) {
+    switch (expression.m_operator) {
+        case Expression::Operator::Number:
+            return os << expression.m_value;
+        case Expression::Operator::Symbol:
+            return os << expression.m_name;
+        case Expression::Operator::ReplaceSymbol:
+            return os << "\\" << expression.m_name;
+        case Expression::Operator::Add:
+            return os << "(" << *expression.m_lhs << " + " << *expression.m_rhs << ")";
+        case Expression::Operator::Subtract:
+            return os << "(" << *expression.m_lhs << " - " << *expression.m_rhs << ")";
+        case Expression::Operator::Multiply:
+            return os << "(" << *expression.m_lhs << " * " << *expression.m_rhs << ")";
+        case Expression::Operator::Divide:
+            return os << "(" << *expression.m_lhs << " / " << *expression.m_rhs << ")";
+        case Expression::Operator::Negate:
+            return os << "-" << *expression.m_lhs;
+        case Expression::Operator::High:
+            return os << "hi(" << *expression.m_lhs << ")";
+        case Expression::Operator::Low:
+            return os << "lo(" << *expression.m_lhs << ")";
+    }
+    return os;
+}
@@ -0,0 +1,102 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_EXPRESSION_H
+#define CS8_EXPRESSION_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/**
+ * \brief An immutable arithmetic expression over numbers and symbols.
+ *
+ * Expressions are built by the parser and evaluated once all label addresses are known,
+ * which allows operands like <tt>label+4</tt>, <tt>end-start</tt> or <tt>hi(label)</tt>.
+ * Subtrees are shared, so duplicating an expression is cheap.
+ * \author Maximilian Kroboth
+ */
+class Expression final : public std::enable_shared_from_this<Expression> {
+public:
+    enum class Operator {
+        Number, Symbol, ReplaceSymbol,
+        Add, Subtract, Multiply, Divide,
+        Negate, High, Low
+    };
+
+    using pointer = std::shared_ptr<Expression const>;
+
+    ///! Look up the value of a symbol, std::nullopt if the symbol is unknown.
+    using symbol_resolver = std::function<std::optional<int64_t>(std::string const&)>;
+
+    ///! Provide the replacement for a macro parameter.
+    using replacement_provider = std::function<pointer(std::string const&)>;
+
+private:
+    Operator m_operator;
+    int64_t m_value {0};
+    std::string m_name;
+    pointer m_lhs;
+    pointer m_rhs;
+
+public:
+    Expression(Operator op, int64_t value, std::string_view name, pointer lhs, pointer rhs)
+    : m_operator{op}, m_value{value}, m_name{name}, m_lhs{std::move(lhs)}, m_rhs{std::move(rhs)} {}
+
+    static pointer number(int64_t value);
+    static pointer symbol(std::string_view name);
+    static pointer replace_symbol(std::string_view name);
+
+    /**
+     * \brief Combine two expressions, folding them if both are constant.
+     */
+    static pointer binary(Operator op, pointer lhs, pointer rhs);
+
+    /**
+     * \brief Apply an unary operator, folding the result if the operand is constant.
+     */
+    static pointer unary(Operator op, pointer operand);
+
+    /**
+     * \brief Apply a named function like hi or lo.
+     * \throws std::logic_error when the function is unknown.
+     */
+    static pointer function(std::string_view name, pointer operand);
+
+    [[nodiscard]] Operator get_operator() const { return m_operator; }
+    [[nodiscard]] int64_t get_value() const { return m_value; }
+    [[nodiscard]] std::string const& get_name() const { return m_name; }
+
+    /**
+     * \brief Check whether the expression references neither symbols nor macro parameters.
+     */
+    [[nodiscard]] bool is_constant() const;
+
+    /**
+     * \brief Call the given function for every symbol referenced by the expression.
+     */
+    void for_each_symbol(std::function<void(std::string const&)> const& f) const;
+
+    /**
+     * \brief Evaluate the expression.
+     * \param resolver provides the values of symbols
+     * \throws std::logic_error on unknown symbols, macro parameters or division by zero.
+     */
+    [[nodiscard]] int64_t evaluate(symbol_resolver const& resolver) const;
+
+    /**
+     * \brief Replace macro parameters with the expressions given at the macro invocation.
+     * \return the new expression, folded where possible.
+     */
+    [[nodiscard]] pointer substitute(replacement_provider const& provider) const;
+
+    friend std::ostream& operator<<(std::ostream& os, Expression const& expression);
+};
+
+
+#endif //CS8_EXPRESSION_H
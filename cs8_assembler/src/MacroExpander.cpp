@@ -21,15 +21,44 @@ void MacroExpander::scan_macros(std::list<Macro> const &t_macros) {
                    macro_to_name_value_pair);
 }
 
+void MacroExpander::replace_parameters(std::list<std::unique_ptr<AstParameterNode>> &t_parameters,
+                                       std::map<std::string, AstParameterNode *> const &t_macro_params) {
+    auto lookup = [&](std::string const &name) -> AstParameterNode const & {
+        if (!t_macro_params.contains(name)) throw std::logic_error("Unknown macro parameter: \\" + name);
+        return *t_macro_params.at(name);
+    };
+
+    for (auto &param : t_parameters) {
+        if (param->get_type() == AstNodeType::ReplaceSymbolParameter) {
+            auto const &rsp = dynamic_cast<AstReplaceSymbolParameter const &>(*param);
+
+            param.reset(lookup(rsp.get_name()).duplicate());
+        } else if (param->get_type() == AstNodeType::ExpressionParameter) {
+            // Expressions may reference macro parameters in any subexpression.
+            auto const &expression = dynamic_cast<AstExpressionParameter const &>(*param).get_expression();
+            auto replaced = expression->substitute([&](std::string const &name) {
+                return to_expression(lookup(name));
+            });
+
+            if (replaced->get_operator() == Expression::Operator::Number) {
+                param = std::make_unique<AstNumberParameter>(replaced->get_value());
+            } else {
+                param = std::make_unique<AstExpressionParameter>(std::move(replaced));
+            }
+        }
+    }
+}
+
 size_t MacroExpander::replace_macro_lines(std::list<std::unique_ptr<AstLineNode>> &t_lines) {
     size_t replaced_macros = 0;
     for (auto iter = t_lines.begin(); iter != t_lines.end(); ++iter) {
         if ((*iter)->get_type() == AstNodeType::Instruction) {
-            AstInstruction instruction(*dynamic_cast<AstInstruction *>((*iter).get()));
-            auto const &name = instruction.get_name();
+            auto const &invocation = dynamic_cast<AstInstruction const &>(**iter);
 
-            if (this->m_macros.contains(name)) {
-                Macro const &macro = *this->m_macros.at(name);
+            if (this->m_macros.contains(invocation.get_name())) {
+                // Keep a copy, the invocation itself is redacted below while its parameters are still needed.
+                AstInstruction instruction(invocation);
+                Macro const &macro = *this->m_macros.at(instruction.get_name());
 
                 // The macro usage must have the same number of parameters as the macro definition.
                 assert(macro.get_args().size() == instruction.get_parameters().size());
@@ -54,18 +83,13 @@ size_t MacroExpander::replace_macro_lines(std::list<std::unique_ptr<AstLineNode>
 
                 for (auto const &macro_line: macro_lines) {
                     std::unique_ptr<AstLineNode> elem(macro_line->duplicate());
+                    // Nested invocations inherit the position, so every line ends up at the outermost invocation.
+                    elem->set_location(instruction.get_location());
 
                     if (auto *target = dynamic_cast<AstInstruction *>(elem.get())) {
-                        // If the current target contains ReplaceSymbol parameters, replace them.
-                        for (auto &param : target->get_parameters()) {
-                            if (param->get_type() == AstNodeType::ReplaceSymbolParameter) {
-                                auto const &rsp = dynamic_cast<AstReplaceSymbolParameter const &>(*param);
-
-                                param.reset(macro_params[rsp.get_name()]->duplicate());
-                            }
-                        }
-
-
+                        replace_parameters(target->get_parameters(), macro_params);
+                    } else if (auto *directive = dynamic_cast<AstDirective *>(elem.get())) {
+                        replace_parameters(directive->get_parameters(), macro_params);
                     }
 
                     t_lines.insert(iter++, std::move(elem));
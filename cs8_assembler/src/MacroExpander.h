@@ -6,6 +6,7 @@
 #define CS8_MACROEXPANDER_H
 #include "Ast.h"
 #include <unordered_map>
+#include <map>
 #include <concepts>
 
 /**
@@ -22,6 +23,14 @@ class MacroExpander final {
      */
     void scan_macros(std::list<Macro> const& t_macros);
 
+    /**
+     * \brief Replace the macro parameters used in the given parameter list with the invocations parameters.
+     * @param t_parameters the parameters of a line in the macro body
+     * @param t_macro_params the lookup from macro parameter name to invocation parameter
+     */
+    static void replace_parameters(std::list<std::unique_ptr<AstParameterNode>>& t_parameters,
+                                   std::map<std::string, AstParameterNode*> const& t_macro_params);
+
     /**
      * \brief Replace macro invocations with the macros content.
      * @param t_lines all lines of the program
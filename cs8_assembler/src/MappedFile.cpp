@@ -0,0 +1,42 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(std::filesystem::path const& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open file: " + path.string());
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot stat file: " + path.string());
+    }
+
+    m_size = static_cast<size_t>(info.st_size);
+    if (m_size > 0) {
+        void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map file: " + path.string());
+        }
+        m_data = static_cast<uint8_t const*>(mapping);
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+}
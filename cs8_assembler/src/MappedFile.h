@@ -0,0 +1,43 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_MAPPEDFILE_H
+#define CS8_MAPPEDFILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+/**
+ * \brief A read-only memory mapping of a whole file.
+ * \author Maximilian Kroboth
+ */
+class MappedFile final {
+    ///! The start of the mapping, nullptr for empty files.
+    uint8_t const* m_data {nullptr};
+
+    ///! The size of the mapping in bytes.
+    size_t m_size {0};
+
+public:
+    /**
+     * \brief Map the given file into memory.
+     * \param path the file to map
+     * \throws std::runtime_error when the file cannot be opened or mapped.
+     */
+    explicit MappedFile(std::filesystem::path const& path);
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    ~MappedFile();
+
+    [[nodiscard]] std::span<uint8_t const> bytes() const {
+        return {m_data, m_size};
+    }
+};
+
+
+#endif //CS8_MAPPEDFILE_H
@@ -0,0 +1,53 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "PassTimer.h"
+#include "AllocationCounter.h"
+
+#include <fmt/format.h>
+#include <sys/resource.h>
+
+PassTimer::Measurement::Measurement(PassTimer* timer, std::string_view name)
+: m_timer{timer}, m_statistics{std::string(name)} {
+    if (!m_timer) return;
+
+    m_peak_rss = peak_rss();
+    m_allocations = AllocationCounter::allocations();
+    m_allocated_bytes = AllocationCounter::allocated_bytes();
+    m_start = std::chrono::steady_clock::now();
+}
+
+void PassTimer::Measurement::finish(size_t nodes) {
+    if (!m_timer) return;
+
+    m_statistics.wall_time = std::chrono::steady_clock::now() - m_start;
+    m_statistics.peak_rss_delta = peak_rss() - m_peak_rss;
+    m_statistics.allocations = AllocationCounter::allocations() - m_allocations;
+    m_statistics.allocated_bytes = AllocationCounter::allocated_bytes() - m_allocated_bytes;
+    m_statistics.nodes = nodes;
+
+    m_timer->m_passes.push_back(std::move(m_statistics));
+    m_timer = nullptr;
+}
+
+void PassTimer::write_json(std::ostream& os, std::vector<PassStatistics> const& passes) {
+    std::chrono::nanoseconds total {0};
+
+    os << "{\"version\": 1, \"passes\": [";
+    for (size_t i = 0; i < passes.size(); ++i) {
+        auto const& pass = passes[i];
+        total += pass.wall_time;
+        os << fmt::format("{}\n  {{\"name\": \"{}\", \"wall_ns\": {}, \"peak_rss_delta_kib\": {}, "
+                          "\"allocations\": {}, \"allocated_bytes\": {}, \"nodes\": {}}}",
+                          i == 0 ? "" : ",", pass.name, pass.wall_time.count(), pass.peak_rss_delta,
+                          pass.allocations, pass.allocated_bytes, pass.nodes);
+    }
+    os << fmt::format("\n], \"total_wall_ns\": {}, \"peak_rss_kib\": {}}}\n", total.count(), peak_rss());
+}
+
+long PassTimer::peak_rss() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
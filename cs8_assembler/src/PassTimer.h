@@ -0,0 +1,91 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_PASSTIMER_H
+#define CS8_PASSTIMER_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * \brief The resources used by a single assembler pass.
+ */
+struct PassStatistics {
+    std::string name;
+    std::chrono::nanoseconds wall_time {0};
+    ///! The growth of the peak resident set size in KiB.
+    long peak_rss_delta {0};
+    ///! The allocations of the pass, 0 in programs without AllocationHooks.cpp.
+    uint64_t allocations {0};
+    uint64_t allocated_bytes {0};
+    ///! The number of nodes (lines, labels or tree nodes) produced or processed by the pass.
+    size_t nodes {0};
+};
+
+/**
+ * \brief Measure wall time, memory and allocations of the assembler passes.
+ * A disabled timer records nothing.
+ * \author Maximilian Kroboth
+ */
+class PassTimer final {
+public:
+    class Measurement final {
+        PassTimer* m_timer;
+        PassStatistics m_statistics;
+        std::chrono::steady_clock::time_point m_start {};
+        long m_peak_rss {0};
+        uint64_t m_allocations {0};
+        uint64_t m_allocated_bytes {0};
+
+    public:
+        Measurement(PassTimer* timer, std::string_view name);
+
+        /**
+         * \brief Stop the measurement and record it in the timer.
+         * \param nodes the number of nodes handled by the pass
+         */
+        void finish(size_t nodes);
+    };
+
+private:
+    bool m_enabled;
+    std::vector<PassStatistics> m_passes;
+
+public:
+    explicit PassTimer(bool enabled = true) : m_enabled{enabled} {}
+
+    /**
+     * \brief Start measuring the pass with the given name.
+     */
+    [[nodiscard]] Measurement start(std::string_view name) {
+        return {m_enabled ? this : nullptr, name};
+    }
+
+    [[nodiscard]] std::vector<PassStatistics> const& get_passes() const { return m_passes; }
+
+    /**
+     * \brief Write the recorded passes as a JSON document.
+     */
+    void write_json(std::ostream& os) const { write_json(os, m_passes); }
+
+    /**
+     * \brief Write the given passes as a JSON document.
+     *
+     * The document has the form <tt>{"version": 1, "passes": [{"name", "wall_ns", "peak_rss_delta_kib",
+     * "allocations", "allocated_bytes", "nodes"}, ...], "total_wall_ns", "peak_rss_kib"}</tt>.
+     */
+    static void write_json(std::ostream& os, std::vector<PassStatistics> const& passes);
+
+    /**
+     * \brief Get the peak resident set size of this process in KiB.
+     */
+    static long peak_rss();
+};
+
+
+#endif //CS8_PASSTIMER_H
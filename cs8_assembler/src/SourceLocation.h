@@ -0,0 +1,29 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_SOURCELOCATION_H
+#define CS8_SOURCELOCATION_H
+
+#include <string>
+#include <string_view>
+
+/**
+ * \brief The position of a line in the sources.
+ * Lines expanded from a macro are at the position of the macro invocation.
+ */
+struct SourceLocation {
+    ///! The absolute path of the file, interned by the scanner, so it stays valid until the program ends.
+    std::string_view file;
+    int line {0};
+};
+
+/**
+ * \brief The location as "file:line: " to start an error message with, empty for lines without a location.
+ */
+inline std::string error_prefix(SourceLocation const& location) {
+    if (location.line == 0) return {};
+    return std::string(location.file) + ":" + std::to_string(location.line) + ": ";
+}
+
+#endif //CS8_SOURCELOCATION_H
@@ -8,6 +8,8 @@
 #include <elfio/elfio.hpp>
 #include <filesystem>
 #include <cassert>
+#include <algorithm>
+#include <span>
 
 void AsmTreeEmitter::emit_binary(const AsmTree::AsmTree &asm_tree) {
     std::map<std::string, section> sections;
@@ -27,6 +29,10 @@ void AsmTreeEmitter::emit_binary(const AsmTree::AsmTree &asm_tree) {
                 auto const &instruction = dynamic_cast<AsmTree::Instruction::AsmTreeInstructionNode const &>(*node);
 
                 auto &current_section_data = sections.at(current_section).data;
+                if (instruction.location.line != 0) {
+                    lines.push_back({static_cast<uint16_t>(sections.at(current_section).addr + current_section_data.size()),
+                                     instruction.location});
+                }
 
                 if (auto const *b = dynamic_cast<AsmTree::Instruction::AsmTreeInstruction1BNode const *>(&instruction)) {
                     auto binary = b->emit();
@@ -48,14 +54,14 @@ void AsmTreeEmitter::emit_binary(const AsmTree::AsmTree &asm_tree) {
                 auto const &directive = dynamic_cast<AsmTree::AsmTreeDirective const &>(*node);
 
                 if (directive.name == "entrypoint") {
-                    entry = std::stoull(directive.args.at(0));
+                    entry = static_cast<size_t>(directive.integer_arg(0));
                 } else if (directive.name == "section") {
-                    current_section = directive.args.at(0);
+                    current_section = directive.symbol_arg(0);
                     if (!sections.contains(current_section)) {
-                        sections[current_section] = section{current_section, std::stoull(directive.args.at(1)), std::vector<uint8_t>()};
+                        sections[current_section] = section{current_section, static_cast<size_t>(directive.integer_arg(1)), std::vector<uint8_t>()};
                     }
                 } else if (directive.name == "global") {
-                    auto symbol_name = directive.args.at(0);
+                    auto symbol_name = directive.symbol_arg(0);
                     auto address = asm_tree.label_map.at(symbol_name);
 
                     if(exported_symbols.contains(symbol_name)) {
@@ -65,7 +71,7 @@ void AsmTreeEmitter::emit_binary(const AsmTree::AsmTree &asm_tree) {
                                 {symbol_name, symbol{symbol_name, sections.at(address.section), symbol_type::Global, std::make_optional(address.address)}});
                     }
                 } else if (directive.name == "weak") {
-                    auto symbol_name = directive.args.at(0);
+                    auto symbol_name = directive.symbol_arg(0);
                     auto address = asm_tree.label_map.at(symbol_name);
 
                     if(exported_symbols.contains(symbol_name)) {
@@ -75,7 +81,7 @@ void AsmTreeEmitter::emit_binary(const AsmTree::AsmTree &asm_tree) {
                                 {symbol_name, symbol{symbol_name, sections.at(address.section), symbol_type::Weak, std::make_optional(address.address)}});
                     }
                 }  else if (directive.name == "extern") {
-                    auto symbol_name = directive.args.at(0);
+                    auto symbol_name = directive.symbol_arg(0);
 
                     if(exported_symbols.contains(symbol_name)) {
                         exported_symbols.at(symbol_name).type = symbol_type::Extern;
@@ -84,15 +90,16 @@ void AsmTreeEmitter::emit_binary(const AsmTree::AsmTree &asm_tree) {
                                 {symbol_name, symbol{symbol_name, sections.at(current_section), symbol_type::Extern, std::nullopt }});
                     }
                 } else if (directive.name == "secinfo") {
-                    if (!sections.contains(directive.args.at(0))) {
-                        sections[directive.args.at(0)] = section{};
+                    auto const &section_name = directive.symbol_arg(0);
+                    if (!sections.contains(section_name)) {
+                        sections[section_name] = section{};
                     }
 
-                    auto &edited_section = sections[directive.args.at(0)];
+                    auto &edited_section = sections[section_name];
                     edited_section.flags.clear();
 
-                    for (auto iter = ++std::begin(directive.args); iter != std::end(directive.args); ++iter) {
-                        auto value = *iter;
+                    for (size_t i = 1; i < directive.args.size(); ++i) {
+                        auto const &value = directive.symbol_arg(i);
                         if (value == "execute") {
                             edited_section.flags.insert(section_flags::X);
                         } else if (value == "read") {
@@ -103,17 +110,38 @@ void AsmTreeEmitter::emit_binary(const AsmTree::AsmTree &asm_tree) {
                     }
                 } else if (directive.name == "byte") {
                     auto &current_section_data = sections.at(current_section).data;
-                    current_section_data.push_back(std::stoi(directive.args.at(0)));
+                    for (size_t i = 0; i < directive.args.size(); ++i) {
+                        current_section_data.push_back(directive.operand_arg<uint8_t>(i));
+                    }
                 } else if (directive.name == "word") {
                     auto &current_section_data = sections.at(current_section).data;
-                    int16_t num = std::stoi(directive.args.at(0));
-                    current_section_data.push_back(num >> 8);
-                    current_section_data.push_back(num);
-                } else if (directive.name == "bytes") {
+                    for (size_t i = 0; i < directive.args.size(); ++i) {
+                        auto const num = directive.operand_arg<uint16_t>(i);
+                        current_section_data.push_back(num >> 8);
+                        current_section_data.push_back(num);
+                    }
+                } else if (directive.name == "bytes" || directive.name == "incbin") {
                     auto &current_section_data = sections.at(current_section).data;
-                    for (auto const &b : directive.args) {
-                        current_section_data.push_back(std::stoi(b));
+                    current_section_data.reserve(current_section_data.size() + directive.get_length(current_section_data.size()));
+                    for (size_t i = 0; i < directive.args.size(); ++i) {
+                        if (auto const *span = std::get_if<AsmTree::ByteSpan>(&directive.args[i])) {
+                            auto const bytes = span->bytes();
+                            current_section_data.insert(current_section_data.end(), bytes.begin(), bytes.end());
+                        } else {
+                            current_section_data.push_back(directive.operand_arg<uint8_t>(i));
+                        }
                     }
+                } else if (directive.name == "skip" || directive.name == "zero" || directive.name == "align") {
+                    auto &target_section = sections.at(current_section);
+                    auto const padding = directive.get_length(target_section.addr + target_section.data.size());
+                    target_section.data.resize(target_section.data.size() + padding, 0);
+                } else if (directive.name == "vector") {
+                    if (directive.args.size() != 2) throw directive.error("expects a source and a handler");
+                    interrupt_vectors[directive.operand_arg<uint16_t>(0)] = directive.operand_arg<uint16_t>(1);
+                } else if (directive.name == "fill") {
+                    auto &current_section_data = sections.at(current_section).data;
+                    auto const value = directive.args.size() > 1 ? directive.operand_arg<uint8_t>(1) : uint8_t{0};
+                    current_section_data.insert(current_section_data.end(), directive.get_length(current_section_data.size()), value);
                 }
             }
                 break;
@@ -128,12 +156,22 @@ void AsmTreeEmitter::emit_binary(const AsmTree::AsmTree &asm_tree) {
                    });
 
 
-    emit_elf_file(entry, sections);
+    switch (output_format) {
+        case OutputFormat::Elf64:
+            emit_elf_file(entry, sections, ELFCLASS64);
+            break;
+        case OutputFormat::Elf32:
+            emit_elf_file(entry, sections, ELFCLASS32);
+            break;
+        case OutputFormat::Flat:
+            emit_flat_file(entry, sections);
+            break;
+    }
 }
 
-void AsmTreeEmitter::emit_elf_file(size_t entrypoint, std::map<std::string, section> const &sections) {
+void AsmTreeEmitter::emit_elf_file(size_t entrypoint, std::map<std::string, section> const &sections, unsigned char elf_class) {
     ELFIO::elfio emitter;
-    emitter.create(ELFCLASS64, ELFDATA2MSB);
+    emitter.create(elf_class, ELFDATA2MSB);
     emitter.set_os_abi(ELFOSABI_NONE);
     emitter.set_type(ET_EXEC);
     emitter.set_machine(EM_NONE);
@@ -187,6 +225,8 @@ void AsmTreeEmitter::emit_elf_file(size_t entrypoint, std::map<std::string, sect
         current_segment->add_section(current_section, current_section->get_addr_align());
     }
 
+    create_vector_section(emitter);
+    create_line_section(emitter);
     create_elf_symtab(emitter, exported_symbols);
 
     emitter.set_entry(entrypoint);
@@ -201,7 +241,127 @@ void AsmTreeEmitter::emit_elf_file(size_t entrypoint, std::map<std::string, sect
     if (!emitter.save(output_stream)) throw std::runtime_error("Unknown Error");
 }
 
-AsmTreeEmitter::AsmTreeEmitter(std::ostream &output_stream) : output_stream{output_stream} {
+void AsmTreeEmitter::create_vector_section(ELFIO::elfio &elfio) const {
+    if (interrupt_vectors.empty()) return;
+
+    // Not loaded into memory, the loader writes the handler addresses to the interrupt controller.
+    std::vector<uint8_t> data;
+    for (auto const &[source, handler] : interrupt_vectors) {
+        data.push_back(source >> 8);
+        data.push_back(source);
+        data.push_back(handler >> 8);
+        data.push_back(handler);
+    }
+
+    ELFIO::section *vectors = elfio.sections.add("cs8.vectors");
+    vectors->set_type(SHT_PROGBITS);
+    vectors->set_flags(0);
+    vectors->set_data(std::bit_cast<const char *>(data.data()), static_cast<ELFIO::Elf_Word>(data.size()));
+}
+
+void AsmTreeEmitter::create_line_section(ELFIO::elfio &elfio) const {
+    if (lines.empty()) return;
+
+    // Not loaded into memory, big endian: file count (u16), the zero terminated file names,
+    // then per instruction: address (u16), file index (u16), line (u32).
+    std::vector<std::string_view> files;
+    for (auto const &entry : lines) {
+        if (std::find(files.begin(), files.end(), entry.location.file) == files.end()) files.push_back(entry.location.file);
+    }
+
+    std::vector<uint8_t> data;
+    data.push_back(files.size() >> 8);
+    data.push_back(files.size());
+    for (auto const &file : files) {
+        data.insert(data.end(), file.begin(), file.end());
+        data.push_back(0);
+    }
+    for (auto const &entry : lines) {
+        auto const file = std::find(files.begin(), files.end(), entry.location.file) - files.begin();
+        auto const line = static_cast<uint32_t>(entry.location.line);
+        data.push_back(entry.address >> 8);
+        data.push_back(entry.address);
+        data.push_back(file >> 8);
+        data.push_back(file);
+        data.push_back(line >> 24);
+        data.push_back(line >> 16);
+        data.push_back(line >> 8);
+        data.push_back(line);
+    }
+
+    ELFIO::section *line_table = elfio.sections.add("cs8.lines");
+    line_table->set_type(SHT_PROGBITS);
+    line_table->set_flags(0);
+    line_table->set_data(std::bit_cast<const char *>(data.data()), static_cast<ELFIO::Elf_Word>(data.size()));
+}
+
+void AsmTreeEmitter::emit_flat_file(size_t entrypoint, std::map<std::string, section> const &sections) const {
+    // See ProgramImage in the emulator for the layout.
+    constexpr size_t header_size = 12;
+    constexpr size_t segment_size = 16;
+    constexpr uint16_t version = 1;
+
+    std::vector<uint8_t> header;
+    auto put16 = [&](uint32_t value) {
+        header.push_back(value >> 8);
+        header.push_back(value);
+    };
+    auto put32 = [&](uint32_t value) {
+        put16(value >> 16);
+        put16(value & 0xFFFF);
+    };
+
+    header.insert(header.end(), {'C', 'S', '8', 'F'});
+    put16(version);
+    put16(static_cast<uint16_t>(entrypoint));
+    put16(static_cast<uint16_t>(sections.size()));
+    put16(static_cast<uint16_t>(interrupt_vectors.size()));
+
+    size_t offset = header_size + sections.size() * segment_size + interrupt_vectors.size() * 4;
+    std::vector<std::span<uint8_t const>> contents;
+    for (auto const &[name, section_data] : sections) {
+        // Trailing zeroes are not stored, the loader fills them in.
+        auto const last = std::find_if(section_data.data.rbegin(), section_data.data.rend(), [](uint8_t b) { return b != 0; });
+        auto const stored = static_cast<size_t>(section_data.data.rend() - last);
+
+        uint16_t flags = 0;
+        for (auto flag: section_data.flags) {
+            switch (flag) {
+                case section_flags::R:
+                    flags |= PF_R;
+                    break;
+                case section_flags::W:
+                    flags |= PF_W;
+                    break;
+                case section_flags::X:
+                    flags |= PF_X;
+                    break;
+            }
+        }
+
+        put16(static_cast<uint16_t>(section_data.addr));
+        put16(flags);
+        put32(static_cast<uint32_t>(stored));
+        put32(static_cast<uint32_t>(section_data.data.size()));
+        put32(static_cast<uint32_t>(offset));
+        contents.emplace_back(section_data.data.data(), stored);
+        offset += stored;
+    }
+    for (auto const &[source, handler] : interrupt_vectors) {
+        put16(source);
+        put16(handler);
+    }
+
+    if (!output_stream) throw std::runtime_error("Invalid output stream");
+    output_stream.write(std::bit_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+    for (auto const &content : contents) {
+        output_stream.write(std::bit_cast<const char *>(content.data()), static_cast<std::streamsize>(content.size()));
+    }
+    if (!output_stream) throw std::runtime_error("Unknown Error");
+}
+
+AsmTreeEmitter::AsmTreeEmitter(std::ostream &output_stream, OutputFormat format)
+        : output_stream{output_stream}, output_format{format} {
 
 }
 
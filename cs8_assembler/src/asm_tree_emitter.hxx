@@ -5,15 +5,28 @@
 #ifndef CS8_ASM_TREE_EMITTER_HXX
 #define CS8_ASM_TREE_EMITTER_HXX
 #include "AsmTree.h"
+#include "SourceLocation.h"
 #include "../../cs8_emulator/dependencies/ELFIO/elfio/elfio.hpp"
 #include <ostream>
 #include <cstdint>
 #include <vector>
+#include <map>
 #include <set>
-#include <vector>
 
 class AsmTreeEmitter {
+public:
+    enum class OutputFormat {
+        ///! ELFCLASS64, big endian, with symbols.
+        Elf64,
+        ///! ELFCLASS32, big endian, with symbols.
+        Elf32,
+        ///! A flat image without symbols, the smallest and fastest to load.
+        Flat
+    };
+
+private:
     std::ostream& output_stream;
+    OutputFormat output_format;
 
     enum class section_flags {
         R, W, X
@@ -40,11 +53,24 @@ class AsmTreeEmitter {
 
     std::map<std::string, symbol> exported_symbols;
 
-    void emit_elf_file(size_t entrypoint, std::map<std::string, section> const &sections);
+    ///! The interrupt vectors: source -> handler address
+    std::map<uint16_t, uint16_t> interrupt_vectors;
+
+    struct line {
+        uint16_t address;
+        SourceLocation location;
+    };
+    ///! The source line of every instruction, in the order they were emitted.
+    std::vector<line> lines;
+
+    void emit_elf_file(size_t entrypoint, std::map<std::string, section> const &sections, unsigned char elf_class);
+    void emit_flat_file(size_t entrypoint, std::map<std::string, section> const &sections) const;
+    void create_vector_section(ELFIO::elfio &elfio) const;
+    void create_line_section(ELFIO::elfio &elfio) const;
     static void create_elf_symtab(ELFIO::elfio &elfio, std::map<std::string, symbol> const &symbols);
 
 public:
-    explicit AsmTreeEmitter(std::ostream& output_stream);
+    explicit AsmTreeEmitter(std::ostream& output_stream, OutputFormat format = OutputFormat::Elf64);
 
     void emit_binary(AsmTree::AsmTree const&);
 
@@ -8,11 +8,24 @@
 %code requires{
 #include <src/Ast.h>
 #include <string>
+
+/* Bison's location with the file the token was read from. */
+struct SourceSpan {
+    int first_line;
+    int first_column;
+    int last_line;
+    int last_column;
+    char const* file;
+};
+#define SSLTYPE SourceSpan
+#define SSLTYPE_IS_DECLARED 1
+#define SSLTYPE_IS_TRIVIAL 1
 }
 %{
 #include <src/Ast.h>
 #include <cstring>
 #include <map>
+#include <filesystem>
 
 
 
@@ -23,8 +36,45 @@ extern void yyerror(AstRootNode** root, AstMemoryManager& ast, const char*);
 
 
 std::map<std::string, std::string> defined_constants;
+
+#define YYLLOC_DEFAULT(Current, Rhs, N)                                         \
+    do {                                                                        \
+        if (N) {                                                                \
+            (Current).first_line = YYRHSLOC(Rhs, 1).first_line;                 \
+            (Current).first_column = YYRHSLOC(Rhs, 1).first_column;             \
+            (Current).file = YYRHSLOC(Rhs, 1).file;                             \
+            (Current).last_line = YYRHSLOC(Rhs, N).last_line;                   \
+            (Current).last_column = YYRHSLOC(Rhs, N).last_column;               \
+        } else {                                                                \
+            (Current).first_line = (Current).last_line = YYRHSLOC(Rhs, 0).last_line;         \
+            (Current).first_column = (Current).last_column = YYRHSLOC(Rhs, 0).last_column;   \
+            (Current).file = YYRHSLOC(Rhs, 0).file;                             \
+        }                                                                       \
+    } while (0)
+
+/**
+ * Make file names of directives that read files absolute, as they are relative to the file being parsed.
+ */
+static void resolve_directive_paths(AstDirective& directive) {
+    if (directive.get_name() != "incbin" || directive.get_parameters().empty()) return;
+
+    auto& file_parameter = directive.get_parameter(0);
+    if (file_parameter->get_type() == AstNodeType::StringParameter) {
+        auto const& name = dynamic_cast<AstStringParameter const&>(*file_parameter).get_name();
+        file_parameter = std::make_unique<AstStringParameter>(std::filesystem::absolute(name).string());
+    }
+}
 %}
+%code {
+/**
+ * The position of a line, from the location of its first token.
+ */
+static SourceLocation to_location(SourceSpan const& span) {
+    return SourceLocation{span.file ? span.file : "", span.first_line};
+}
+}
 %glr-parser
+%locations
 %define api.prefix ss
 %define parse.trace
 %define parse.error detailed
@@ -33,11 +83,11 @@ std::map<std::string, std::string> defined_constants;
 
 %union
 {
-    int ival;
+    int64_t ival;
     char* sval;
 
     char* str;
-    int number;
+    int64_t number;
     AstRootNode* root_node;
     AstLineNode* line_node;
     AstParameterNode* parameter_node;
@@ -76,15 +126,15 @@ std::map<std::string, std::string> defined_constants;
 
 
 %left TOK_MINUS TOK_PLUS
-%left TOK_TIMES TOK_DIV
+%left TOK_TIMES TOK_DIVIDE
+%precedence UNARY_MINUS
 
 %token TOK_NEWLINE
 
 %type <line_nodes> lines nm_lines
 %type <line_node> line nm_line instruction_0 instruction_n directive macro label instruction directive_n directive_0
-%type <number> numeric
 %type <number> substitution
-%type <number> math_expr
+%type <parameter_node> expr
 %type <parameter_node> instruction_arg
 %type <parameter_nodes> instruction_args
 %type <parameter_node> directive_arg
@@ -111,7 +161,7 @@ name: TOK_IDENTIFIER { $$ = ast.copy_string($1); } ;
 colon: TOK_COLON ;
 
 label:
-    name colon { $$ = ast.new_label($1); };
+    name colon { $$ = ast.new_label($1); $$->set_location(to_location(@1)); };
 
 lines:
     line { $$ = ast.new_list<AstLineNode*>(); $$->push_back($1); }
@@ -149,12 +199,6 @@ register:
     TOK_PERCENT TOK_IDENTIFIER { $$ = ast.copy_string($2); }
     ;
 
-numeric:
-    TOK_NUMBER { $$ = $1; }
-    | substitution { $$ = $1; }
-    | math_expr { $$ = $1; }
-    ;
-
 macro_arg:
     TOK_IDENTIFIER { $$ = ast.copy_string($1); }
     ;
@@ -171,7 +215,7 @@ start_macro_0: TOK_START_MACRO name {  $$ = new Macro($2); } ;
 start_macro: start_macro_n | start_macro_0 ;
 
 substitution:
-    TOK_OPEN_BRA name TOK_CLOSE_BRA { $$ = stoi(defined_constants.at($2)); }
+    TOK_OPEN_BRA name TOK_CLOSE_BRA { $$ = std::stoll(defined_constants.at($2)); }
 ;
 
 register_substitution:
@@ -186,19 +230,24 @@ symbol:
 
 string_param: TOK_STRING { $$ = ast.new_string_parameter($1); } ;
 
-math_expr:
-  numeric TOK_PLUS numeric { $$ = $1 + $3; }
-  | numeric TOK_MINUS numeric { $$ = $1 - $3; }
-  | numeric TOK_TIMES numeric { $$ = $1 * $3; }
-  | numeric TOK_DIVIDE numeric { $$ = $1 / $3; }
+expr:
+    TOK_NUMBER { $$ = ast.new_number_parameter($1); }
+    | substitution { $$ = ast.new_number_parameter($1); }
+    | symbol { $$ = $1; }
+    | replace_symbol { $$ = $1; }
+    | TOK_OPEN_PAR expr TOK_CLOSE_PAR { $$ = $2; }
+    | name TOK_OPEN_PAR expr TOK_CLOSE_PAR { $$ = ast.new_expression_parameter(Expression::function($1, to_expression(*$3))); }
+    | expr TOK_PLUS expr { $$ = ast.new_expression_parameter(Expression::binary(Expression::Operator::Add, to_expression(*$1), to_expression(*$3))); }
+    | expr TOK_MINUS expr { $$ = ast.new_expression_parameter(Expression::binary(Expression::Operator::Subtract, to_expression(*$1), to_expression(*$3))); }
+    | expr TOK_TIMES expr { $$ = ast.new_expression_parameter(Expression::binary(Expression::Operator::Multiply, to_expression(*$1), to_expression(*$3))); }
+    | expr TOK_DIVIDE expr { $$ = ast.new_expression_parameter(Expression::binary(Expression::Operator::Divide, to_expression(*$1), to_expression(*$3))); }
+    | TOK_MINUS expr %prec UNARY_MINUS { $$ = ast.new_expression_parameter(Expression::unary(Expression::Operator::Negate, to_expression(*$2))); }
   ;
 
 instruction_arg:
     register { $$ = ast.new_register_parameter($1); }
-    | numeric { $$ = ast.new_number_parameter($1); }
+    | expr { $$ = $1; }
     | register_substitution { $$ = ast.new_register_parameter($1); }
-    | replace_symbol { $$ = $1; }
-    | symbol { $$ = $1; }
     ;
 
 instruction_args:
@@ -208,15 +257,13 @@ instruction_args:
 
 directive_name: TOK_DOT TOK_IDENTIFIER { $$ = ast.copy_string($2); } ;
 
-instruction_n: name instruction_args  { auto* result = ast.new_instruction($1); for(auto* param: *$2) result->add_parameter(param); $$ = result; } ;
-instruction_0: name { $$ = ast.new_instruction($1); } ;
+instruction_n: name instruction_args  { auto* result = ast.new_instruction($1); for(auto* param: *$2) result->add_parameter(param); result->set_location(to_location(@1)); $$ = result; } ;
+instruction_0: name { $$ = ast.new_instruction($1); $$->set_location(to_location(@1)); } ;
 
 directive_arg:
      register { $$ = ast.new_register_parameter($1); }
-        | numeric { $$ = ast.new_number_parameter($1); }
+        | expr { $$ = $1; }
         | register_substitution { $$ = ast.new_register_parameter($1); }
-        | replace_symbol { $$ = $1; }
-        | symbol { $$ = $1; }
         | string_param { $$ = $1; }
         ;
 
@@ -226,8 +273,8 @@ directive_args:
     ;
 
 
-directive_n: directive_name directive_args { auto* result = ast.new_directive($1); for(auto* param: *$2) result->add_parameter(param); $$ = result; } ;
-directive_0: directive_name { $$ = ast.new_directive($1); } ;
+directive_n: directive_name directive_args { auto* result = ast.new_directive($1); for(auto* param: *$2) result->add_parameter(param); resolve_directive_paths(*result); result->set_location(to_location(@1)); $$ = result; } ;
+directive_0: directive_name { $$ = ast.new_directive($1); $$->set_location(to_location(@1)); } ;
 
 directive: directive_n | directive_0 ;
 
@@ -236,6 +283,9 @@ directive: directive_n | directive_0 ;
 #include <cstdio>
 #include <iostream>
 
+/* Defined by the scanner, the following tokens are located in the file. */
+extern void begin_source_file(std::filesystem::path const& path);
+
 void yyerror(AstRootNode** root, AstMemoryManager& ast, const char *s)
 {
    printf("Error. %s\n", s);
@@ -247,6 +297,7 @@ AstRootNode parse(std::string filename, FILE* pt) {
 
     }
     yyin = pt;
+    begin_source_file(filename);
 
     AstRootNode root(filename);
     AstRootNode* rootptr = &root;
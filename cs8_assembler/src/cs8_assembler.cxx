@@ -41,12 +41,20 @@ std::optional<AstRootNode> invoke_parse(std::filesystem::path const& filename) {
 }
 void cs8_assembler::assemble(const std::filesystem::path &output,
                              const std::filesystem::path &input) {
-    if(auto ast = invoke_parse(input); ast.has_value()) {
+    PassTimer timer(m_time_passes);
+
+    auto parsing = timer.start("parse");
+    auto ast = invoke_parse(input);
+    parsing.finish(ast.has_value() ? ast->get_lines().size() : 0);
+
+    if(ast.has_value()) {
+        auto expansion = timer.start("macro_expansion");
         MacroExpander macro_expander;
         macro_expander.expand_macros(*ast);
+        expansion.finish(ast->get_lines().size());
 
         AsmTreeTransformer trans;
-        auto asm_tree = trans.transform(*ast);
+        auto asm_tree = trans.transform(*ast, timer);
         for(auto const& entry : asm_tree.label_map) {
             std::cout << entry.first << std::hex << ": " << entry.second.address << std::dec << '\n';
         }
@@ -55,15 +63,21 @@ void cs8_assembler::assemble(const std::filesystem::path &output,
             node->to_ostream(std::cout);
         }
 
+        auto emission = timer.start("elf_emission");
         std::ofstream output_stream(output, std::ios::out | std::ios::binary);
 
         if(!output_stream) throw std::runtime_error("Bad output stream");
-        AsmTreeEmitter emitter(output_stream);
+        AsmTreeEmitter emitter(output_stream, m_output_format);
         emitter.emit_binary(asm_tree);
+        emission.finish(asm_tree.nodes.size());
     }
-}
 
+    m_pass_statistics = timer.get_passes();
+}
 
+void cs8_assembler::write_pass_report(std::ostream &output) const {
+    PassTimer::write_json(output, m_pass_statistics);
+}
 
 void cs8_assembler::assemble(std::ostream &output, std::istream &input) {
     // TODO
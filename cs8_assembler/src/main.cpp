@@ -8,14 +8,40 @@
 #include "CS8_Assembler.hxx"
 #include <optional>
 #include <filesystem>
+#include <string_view>
 
 
 
 int main(int argc, const char* argv[]) {
-   if(argc < 2) return -1;
-   auto infile = argv[1];
+   std::optional<std::filesystem::path> infile;
    std::filesystem::path outfile = "out.elf";
+   bool time_passes = false;
+   auto format = AsmTreeEmitter::OutputFormat::Elf64;
+
+   for (int i = 1; i < argc; ++i) {
+       std::string_view argument = argv[i];
+       if (argument == "--time-passes") {
+           time_passes = true;
+       } else if (argument == "--format" && i + 1 < argc) {
+           std::string_view name = argv[++i];
+           if (name == "elf64") format = AsmTreeEmitter::OutputFormat::Elf64;
+           else if (name == "elf32") format = AsmTreeEmitter::OutputFormat::Elf32;
+           else if (name == "flat") format = AsmTreeEmitter::OutputFormat::Flat;
+           else return -1;
+       } else if (argument == "-o" && i + 1 < argc) {
+           outfile = argv[++i];
+       } else {
+           infile = argument;
+       }
+   }
+   if(!infile.has_value()) return -1;
 
    cs8_assembler assembler;
-   assembler.assemble(outfile, infile);
-}
\ No newline at end of file
+   assembler.set_time_passes(time_passes);
+   assembler.set_output_format(format);
+   assembler.assemble(outfile, *infile);
+
+   if (time_passes) {
+       assembler.write_pass_report(std::cerr);
+   }
+}
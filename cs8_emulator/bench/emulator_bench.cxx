@@ -0,0 +1,129 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "machine.hxx"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Read the host cycle counter.
+ * Uses the time stamp counter where available, nanoseconds of the steady clock otherwise.
+ */
+static uint64_t host_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct BenchResult {
+    std::string program;
+    size_t runs {0};
+    uint64_t instructions {0};
+    uint64_t cycles {0};
+    uint64_t host_cycles {0};
+    uint64_t serial_bytes {0};
+    std::chrono::nanoseconds wall_time {0};
+};
+
+/**
+ * Run the program the given number of times, only the simulation itself is measured.
+ */
+static BenchResult run_program(std::filesystem::path const& program, size_t runs, FILE* serial_output) {
+    BenchResult result;
+    result.program = program.stem().string();
+    result.runs = runs;
+
+    for (size_t run = 0; run < runs; ++run) {
+        Machine machine(program);
+        machine.serial_port->output = serial_output;
+
+        auto const start = std::chrono::steady_clock::now();
+        auto const start_cycles = host_cycles();
+        machine.run();
+        auto const end_cycles = host_cycles();
+        auto const end = std::chrono::steady_clock::now();
+
+        result.wall_time += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+        result.host_cycles += end_cycles - start_cycles;
+        result.instructions += machine.cpu->get_retired_instructions();
+        result.cycles += machine.cpu->get_cycles();
+        result.serial_bytes += machine.serial_port->bytes_written;
+    }
+    return result;
+}
+
+static void usage(std::ostream& os) {
+    os << "usage: cs8_emulator_bench [--runs N] [--programs DIR] [program.elf...]\n";
+}
+
+int main(int argc, const char* argv[]) {
+    size_t runs = 10;
+    std::filesystem::path programs_dir = CS8_BENCH_PROGRAMS_DIR;
+    std::vector<std::filesystem::path> programs;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view argument = argv[i];
+        if (argument == "--runs" && i + 1 < argc) {
+            runs = std::stoul(argv[++i]);
+        } else if (argument == "--programs" && i + 1 < argc) {
+            programs_dir = argv[++i];
+        } else if (argument == "--help") {
+            usage(std::cout);
+            return 0;
+        } else if (argument.starts_with("--")) {
+            usage(std::cerr);
+            return 2;
+        } else {
+            programs.emplace_back(argument);
+        }
+    }
+
+    if (programs.empty()) {
+        for (auto const& entry : std::filesystem::directory_iterator(programs_dir)) {
+            if (entry.path().extension() == ".elf") programs.push_back(entry.path());
+        }
+        std::sort(programs.begin(), programs.end());
+    }
+    if (programs.empty()) {
+        std::cerr << "No programs found in " << programs_dir << '\n';
+        return 1;
+    }
+
+    FILE* serial_output = std::fopen("/dev/null", "w");
+    if (!serial_output) throw std::runtime_error("Cannot open /dev/null");
+
+    std::cout << "program\truns\tinstructions\tcycles\tseconds\tguest_ips\thost_cycles_per_instruction\tserial_bytes_per_second\n";
+    std::cout << std::fixed;
+    for (auto const& program : programs) {
+        auto const result = run_program(program, runs, serial_output);
+        double const seconds = std::chrono::duration<double>(result.wall_time).count();
+        double const instructions = static_cast<double>(result.instructions);
+
+        std::cout << result.program << '\t'
+                  << result.runs << '\t'
+                  << result.instructions << '\t'
+                  << result.cycles << '\t'
+                  << std::setprecision(6) << seconds << '\t'
+                  << std::setprecision(0) << (seconds > 0 ? instructions / seconds : 0) << '\t'
+                  << std::setprecision(2) << (instructions > 0 ? result.host_cycles / instructions : 0) << '\t'
+                  << std::setprecision(0) << (seconds > 0 ? result.serial_bytes / seconds : 0) << '\n';
+    }
+
+    std::fclose(serial_output);
+}
@@ -0,0 +1,253 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_BLOCK_DEVICE_HXX
+#define CS8_BLOCK_DEVICE_HXX
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include "bus.hxx"
+#include "device.hxx"
+#include "dirty_pages.hxx"
+#include "mapped_file.hxx"
+
+/**
+ * A block device exposing a host file in sectors, the file is mapped instead of loaded so datasets of any size
+ * stream in without being part of the program.
+ *
+ * Registers, relative to Begin:
+ *  - 0 SECTOR_HIGH, 1 SECTOR_LOW  the current sector, changing it seeks to the start of the new sector, writing the
+ *                                 current value keeps the offset
+ *  - 2 OFFSET      the current byte within the sector
+ *  - 3 DATA        reading returns the byte at the current position and advances it, writes are ignored
+ *  - 4 WRITE       writing stores a byte at the current position and advances it, reads as -1 and writing -1 is ignored
+ *  - 5 ADDRESS     the memory address of transfers
+ *  - 6 LENGTH      the number of bytes to transfer
+ *  - 7 COMMAND     writing a command performs it, reads as 0
+ *  - 8 STATUS      0 on success, see Status, read only
+ *  - 9 SIZE_HIGH, 10 SIZE_LOW  the number of sectors, read only
+ *
+ * Commands:
+ *  - 1 READ   copy LENGTH bytes from the current position to ADDRESS and advance the position
+ *  - 2 WRITE  copy LENGTH bytes from ADDRESS to the current position and advance the position
+ *  - 3 FLUSH  sync written bytes to the file, which also happens when the machine halts
+ *
+ * The position moves on to the next sector at the end of a sector. Bytes past the end of the file read as 0.
+ * Transfers complete within the write of COMMAND.
+ * The CPU writes the value back after every read, so every register tolerates writing the value it just returned.
+ */
+template<size_t Size, typename AllocUnit, typename Address, Address Begin, Address End, size_t ID, BusLike<AllocUnit, Address> Bus>
+class BlockDevice : public Device, public BusDevice<AllocUnit, Address, ID, Bus> {
+public:
+    using AllocationUnit = AllocUnit;
+    static constexpr Address AddressBegin = Begin;
+    static constexpr Address AddressEnd = End;
+    static constexpr size_t DeviceID = ID;
+
+    static constexpr size_t sector_size = 512;
+
+    enum Register : Address {
+        SectorHigh = 0, SectorLow = 1, Offset = 2, Data = 3, Write = 4, TransferAddress = 5, Length = 6,
+        Command = 7, StatusRegister = 8, SizeHigh = 9, SizeLow = 10
+    };
+
+    enum class Cmd : uint16_t {
+        None = 0, Read = 1, Write = 2, Flush = 3
+    };
+
+    enum class Status : uint16_t {
+        Ok = 0, NoMedium = 1, OutOfRange = 2, ReadOnly = 3, InvalidCommand = 4, InvalidAddress = 5
+    };
+
+private:
+    std::unique_ptr<MappedFile> medium;
+    std::span<AllocUnit> memory;
+    Address memory_begin {0};
+    ///! Marks the pages of memory written, nullptr if nothing tracks them.
+    DirtyPages* dirty {nullptr};
+
+    uint64_t position {0};
+    uint16_t transfer_address {0};
+    uint16_t length {0};
+    Status status {Status::Ok};
+
+    [[nodiscard]] uint32_t sectors() const {
+        return medium ? static_cast<uint32_t>((medium->bytes().size() + sector_size - 1) / sector_size) : 0;
+    }
+
+    [[nodiscard]] uint16_t read_byte() {
+        if (!medium) {
+            status = Status::NoMedium;
+            return 0;
+        }
+        auto const bytes = medium->bytes();
+        auto const value = position < bytes.size() ? bytes[position] : 0;
+        ++position;
+        return value;
+    }
+
+    void write_bytes(std::span<AllocUnit const> values) {
+        if (!medium) {
+            status = Status::NoMedium;
+        } else if (medium->get_mode() == MappedFile::Mode::ReadOnly) {
+            status = Status::ReadOnly;
+        } else if (position + values.size() > medium->bytes().size()) {
+            status = Status::OutOfRange;
+        } else {
+            auto const target = medium->writable(position, values.size());
+            std::transform(values.begin(), values.end(), target.begin(), [](auto value) { return static_cast<uint8_t>(value); });
+            position += values.size();
+        }
+    }
+
+    /// The memory at [ADDRESS, ADDRESS + LENGTH), an empty span with status set if it is not within memory.
+    std::span<AllocUnit> transfer_range() {
+        if (transfer_address < memory_begin || transfer_address - memory_begin + length > memory.size()) {
+            status = Status::InvalidAddress;
+            return {};
+        }
+        return memory.subspan(transfer_address - memory_begin, length);
+    }
+
+    void perform(Cmd command) {
+        // Reading COMMAND writes 0 back, which must not reset the status.
+        if (command == Cmd::None) return;
+        status = Status::Ok;
+        switch (command) {
+            case Cmd::Read: {
+                auto const destination = transfer_range();
+                if (status != Status::Ok) break;
+                if (!medium) {
+                    status = Status::NoMedium;
+                    break;
+                }
+                auto const bytes = medium->bytes();
+                auto const available = position < bytes.size() ? std::min<uint64_t>(length, bytes.size() - position) : 0;
+                if (available > 0) std::copy_n(bytes.begin() + position, available, destination.begin());
+                std::fill(destination.begin() + available, destination.end(), 0);
+                if (dirty) dirty->mark(destination);
+                position += length;
+            } break;
+            case Cmd::Write: {
+                auto const source = transfer_range();
+                if (status != Status::Ok) break;
+                write_bytes(source);
+            } break;
+            case Cmd::Flush:
+                flush();
+                break;
+            default:
+                status = Status::InvalidCommand;
+                break;
+        }
+    }
+
+public:
+    /**
+     * Map a host file as the medium, replacing the previous one
+     */
+    void open(std::filesystem::path const& path, MappedFile::Mode mode) {
+        flush();
+        medium = std::make_unique<MappedFile>(path, mode);
+        position = 0;
+    }
+
+    /**
+     * Sync what the guest wrote to the file
+     */
+    void flush() {
+        if (medium) medium->flush();
+    }
+
+    /**
+     * Let transfers access plain memory mapped at the given address
+     */
+    void attach_memory(std::span<AllocUnit> buffer, Address begin) {
+        memory = buffer;
+        memory_begin = begin;
+    }
+
+    /// Mark the pages of memory written from now on in the tracker, nullptr stops marking.
+    void set_dirty_pages(DirtyPages* pages) {
+        dirty = pages;
+    }
+
+    /// The registers, what the guest wrote to the medium stays written.
+    struct State {
+        uint64_t position;
+        uint16_t transfer_address;
+        uint16_t length;
+        Status status;
+    };
+
+    [[nodiscard]] State save_state() const {
+        return {position, transfer_address, length, status};
+    }
+
+    void restore_state(State const& state) {
+        position = state.position;
+        transfer_address = state.transfer_address;
+        length = state.length;
+        status = state.status;
+    }
+
+    void simulate() override {
+        if (this->get_bus_mode() == RW::Read ||
+            this->get_bus_mode() == RW::Write) {
+            if (this->get_bus_address() >= Begin &&
+                this->get_bus_address() <= End) {
+                auto const offset = static_cast<Address>(this->get_bus_address() - Begin);
+
+                if (this->get_bus_mode() == RW::Read) {
+                    switch (offset) {
+                        case SectorHigh: this->set_bus_data(static_cast<uint16_t>(position / sector_size >> 16)); break;
+                        case SectorLow: this->set_bus_data(static_cast<uint16_t>(position / sector_size)); break;
+                        case Offset: this->set_bus_data(static_cast<uint16_t>(position % sector_size)); break;
+                        case Data: this->set_bus_data(read_byte()); break;
+                        case Write: this->set_bus_data(static_cast<uint16_t>(-1)); break;
+                        case TransferAddress: this->set_bus_data(transfer_address); break;
+                        case Length: this->set_bus_data(length); break;
+                        case StatusRegister: this->set_bus_data(static_cast<uint16_t>(status)); break;
+                        case SizeHigh: this->set_bus_data(static_cast<uint16_t>(sectors() >> 16)); break;
+                        case SizeLow: this->set_bus_data(static_cast<uint16_t>(sectors())); break;
+                        default: this->set_bus_data(0); break;
+                    }
+                } else {
+                    auto const value = this->get_bus_data();
+                    switch (offset) {
+                        // Writing the current half of the sector number keeps the offset, so the write back of
+                        // a read does not rewind to the start of the sector.
+                        case SectorHigh:
+                            if (value == static_cast<uint16_t>(position / sector_size >> 16)) break;
+                            position = (uint64_t{value} << 16 | (position / sector_size & 0xFFFF)) * sector_size;
+                            break;
+                        case SectorLow:
+                            if (value == static_cast<uint16_t>(position / sector_size)) break;
+                            position = ((position / sector_size & ~uint64_t{0xFFFF}) | value) * sector_size;
+                            break;
+                        case Offset:
+                            position = position / sector_size * sector_size + value % sector_size;
+                            break;
+                        case Write:
+                            if (static_cast<int16_t>(value) != -1) {
+                                AllocUnit const unit = value;
+                                write_bytes({&unit, 1});
+                            }
+                            break;
+                        case TransferAddress: transfer_address = value; break;
+                        case Length: length = value; break;
+                        case Command: perform(static_cast<Cmd>(value)); break;
+                        default: break;
+                    }
+                }
+            }
+        }
+    }
+};
+
+
+#endif //CS8_BLOCK_DEVICE_HXX
@@ -0,0 +1,42 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "coverage_map.hxx"
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+    constexpr std::string_view magic = "CS8C";
+}
+
+CoverageMap::CoverageMap(std::filesystem::path const& file) {
+    std::ifstream input(file, std::ios::binary);
+    std::array<char, magic.size()> header {};
+    std::array<uint8_t, sizeof(bits)> bytes {};
+    input.read(header.data(), header.size());
+    input.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+    if (!input) throw std::runtime_error("Cannot read coverage file " + file.string());
+    if (std::string_view(header.data(), header.size()) != magic) {
+        throw std::runtime_error(file.string() + " is no coverage file");
+    }
+
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bits[i / 8] |= uint64_t{bytes[i]} << (i % 8 * 8);
+    }
+}
+
+void CoverageMap::write(std::filesystem::path const& file) const {
+    // Byte by byte, so the file does not depend on the byte order of the host.
+    std::array<uint8_t, sizeof(bits)> bytes {};
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(bits[i / 8] >> (i % 8 * 8));
+    }
+
+    std::ofstream output(file, std::ios::binary);
+    output.write(magic.data(), magic.size());
+    output.write(reinterpret_cast<char const*>(bytes.data()), bytes.size());
+    if (!output) throw std::runtime_error("Cannot write coverage file " + file.string());
+}
@@ -0,0 +1,48 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_COVERAGE_MAP_HXX
+#define CS8_COVERAGE_MAP_HXX
+
+#include "cpu_observer.hxx"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * Records which addresses the guest executed an instruction at, one bit per address.
+ *
+ * Retiring an instruction only sets its bit, the map is written to a file once the run is over.
+ * A coverage file is "CS8C" followed by the 65536 bits, address 0 in the lowest bit of the first byte.
+ */
+class CoverageMap : public CPUObserver {
+    std::array<uint64_t, 65536 / 64> bits {};
+
+public:
+    CoverageMap() = default;
+
+    /**
+     * Read a coverage file
+     * @throws std::runtime_error if the file cannot be read or is no coverage file
+     */
+    explicit CoverageMap(std::filesystem::path const& file);
+
+    [[nodiscard]] bool wants_registers() const override { return false; }
+
+    void on_retire_address(uint16_t address) override {
+        bits[address >> 6] |= uint64_t{1} << (address & 63);
+    }
+
+    [[nodiscard]] bool executed(uint16_t address) const {
+        return bits[address >> 6] >> (address & 63) & 1;
+    }
+
+    /**
+     * Write the map to a coverage file
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void write(std::filesystem::path const& file) const;
+};
+
+#endif //CS8_COVERAGE_MAP_HXX
@@ -5,14 +5,22 @@
 #ifndef CS8_CPU_HXX
 #define CS8_CPU_HXX
 
+#include <array>
 #include <bitset>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
 #include "bus.hxx"
+#include "cpu_observer.hxx"
 #include "device.hxx"
+#include "interrupt_line.hxx"
+#include "trap_map.hxx"
 
 constexpr size_t CPU_ID = 1;
 template<typename Data, typename Address, BusLike<Data, Address> Bus>
-class CPU : public BusDevice<Data, Address, CPU_ID, Bus>, public Device {
+class CPU final : public BusDevice<Data, Address, CPU_ID, Bus>, public Device, public InterruptLine {
     using register_type = int16_t;
 
     register_type
@@ -55,10 +63,103 @@ class CPU : public BusDevice<Data, Address, CPU_ID, Bus>, public Device {
     };
 
     uint8_t rOP;
-    uint8_t rR1, rR0;
+    ///! rR1 keeps the low nibble of the last operand byte between instructions, sidx addresses with it.
+    uint8_t rR1 {0}, rR0;
     uint16_t rAddress;
     uint16_t rValue;
 
+    uint64_t cycles {0};
+    uint64_t retired_instructions {0};
+
+    uint16_t instruction_address {0};
+    uint64_t instruction_start {0};
+    CPUObserver* observer {nullptr};
+    ///! Whether the observer takes the registers of retired instructions, see CPUObserver::wants_registers.
+    bool observe_registers {false};
+
+    ///! The handler address requested by the interrupt controller.
+    std::optional<uint16_t> interrupt_request;
+    ///! Set from the interrupt entry until rti, interrupts do not nest.
+    bool in_service {false};
+    ///! rln of the interrupted code, rln itself holds the return address while in service.
+    register_type interrupted_ln {0};
+    ///! Set by wfi, the CPU waits after the instruction retired.
+    bool wait_requested {false};
+
+    ///! Backward branches over at most this many bytes may close an idle loop.
+    static constexpr uint16_t idle_loop_length = 64;
+    ///! The target of the last short backward branch, -1 if the last taken branch was not one.
+    int32_t loop_target {-1};
+    ///! The registers at the last short backward branch.
+    CPURegisters loop_registers;
+    ///! Whether a store instruction ran since the last taken branch.
+    bool stored {false};
+    ///! Set when a loop iteration ended in the same state as the one before.
+    bool idle_loop {false};
+    ///! Set when the CPU stopped because a budget ran out.
+    bool budget_exhausted {false};
+
+    ///! The breakpoints and watchpoints, nullptr while there are none.
+    TrapMap const* traps {nullptr};
+    ///! The trap the CPU stops at before its next instruction, or stopped at.
+    std::optional<Trap> trap;
+    ///! Set when continuing from a breakpoint, the instruction at it executes once.
+    bool step_over_breakpoint {false};
+
+    /**
+     * Stop before the instruction at rip if it has a breakpoint or the last instruction hit a watchpoint
+     * @return whether the CPU stopped
+     */
+    bool stop_at_trap() {
+        if (!trap && !step_over_breakpoint && traps->contains(TrapKind::Breakpoint, rip)) {
+            trap = Trap{TrapKind::Breakpoint, static_cast<uint16_t>(rip), static_cast<uint16_t>(rip), 0};
+        }
+        step_over_breakpoint = false;
+        if (!trap) return false;
+        cpu_phase = Phase::Trapped;
+        return true;
+    }
+
+    [[nodiscard]] bool is_store() const {
+        return opcode == Opcode::StoreDirect || opcode == Opcode::StoreIndexed ||
+               opcode == Opcode::Push0 || opcode == Opcode::Push1;
+    }
+
+    /// Note a watchpoint hit by the current instruction, the CPU stops once the instruction retired.
+    void check_watchpoint(TrapKind kind) {
+        auto const address = this->get_bus_address();
+        if (!trap && traps->contains(kind, address)) {
+            trap = Trap{kind, address, instruction_address, this->get_bus_data()};
+        }
+    }
+
+    /**
+     * A loop iteration which stores nothing and ends with the registers of the previous iteration only depends on
+     * what it reads from devices. It repeats forever unless a device changes, so the CPU is idle.
+     */
+    void check_idle_loop(uint16_t address, uint16_t target) {
+        if (target > address || address - target > idle_loop_length) {
+            loop_target = -1;
+        } else {
+            auto const snapshot = get_registers();
+            idle_loop = loop_target == target && !stored && snapshot == loop_registers;
+            loop_target = target;
+            loop_registers = snapshot;
+        }
+        stored = false;
+    }
+
+    void retire() {
+        ++retired_instructions;
+        if (!observer) return;
+        if (observe_registers) observer->on_retire(instruction_address, rOP, cycles - instruction_start + 1, get_registers());
+        else observer->on_retire_address(instruction_address);
+    }
+
+    void notify_bus(RW mode) {
+        if (observer) observer->on_bus(mode, this->get_bus_address(), this->get_bus_data());
+    }
+
     enum class Opcode {
         Unknown = -1,
         LoadImm = 0,
@@ -83,7 +184,7 @@ class CPU : public BusDevice<Data, Address, CPU_ID, Bus>, public Device {
         Init, Fetch0, Fetch1,
         Decode, GetData0, GetData1, GetData2, GetData3,
         Prepare, Load0, Load1, Execute, Store0, Store1,
-        Halted
+        Waiting, Trapped, Halted
     } cpu_phase = Phase::Init;
 
     static constexpr const char* to_string(Phase phase) {
@@ -102,6 +203,9 @@ class CPU : public BusDevice<Data, Address, CPU_ID, Bus>, public Device {
             case Phase::Execute: return "Execute";
             case Phase::Store0: return "Store0";
             case Phase::Store1: return "Store1";
+            case Phase::Waiting: return "Waiting";
+            case Phase::Trapped: return "Trapped";
+            case Phase::Halted: return "Halted";
         }
 
         return "";//throw std::runtime_error("Invalid state");
@@ -109,18 +213,40 @@ class CPU : public BusDevice<Data, Address, CPU_ID, Bus>, public Device {
 
 public:
     void simulate() override {
+       ++cycles;
        switch (cpu_phase) {
            case Phase::Init: {
                rip = 0;
                cpu_phase = Phase::Fetch0;
            } break;
            case Phase::Fetch0: {
+               if (retired_instructions >= instruction_budget) {
+                   exhaust_budget();
+                   break;
+               }
+               if (interrupt_request && !in_service) {
+                   // Enter the handler like a call, rti returns to the interrupted instruction.
+                   interrupted_ln = rln;
+                   rln = rip;
+                   rip = *interrupt_request;
+                   in_service = true;
+                   loop_target = -1;
+                   if (observer) observer->on_interrupt(rip);
+               }
+               if (traps && stop_at_trap()) [[unlikely]] {
+                   // Stopping takes no cycle, the instruction is fetched when the CPU continues.
+                   --cycles;
+                   break;
+               }
+               instruction_address = rip;
+               instruction_start = cycles;
                this->own_bus();
                this->set_bus_mode(RW::Read);
                this->set_bus_address(rip++);
                cpu_phase = Phase::Fetch1;
            } break;
            case Phase::Fetch1: {
+               notify_bus(RW::Read);
                rOP = this->get_bus_data();
                this->set_bus_mode(RW::Off);
                this->disown_bus();
@@ -149,6 +275,7 @@ public:
                cpu_phase = Phase::GetData1;
            } break;
            case Phase::GetData1: {
+               notify_bus(RW::Read);
                rR0 = 0xFF & this->get_bus_data();
                this->set_bus_mode(RW::Off);
                cpu_phase = Phase::GetData2;
@@ -161,6 +288,7 @@ public:
                cpu_phase = Phase::GetData3;
            } break;
            case Phase::GetData3: {
+               notify_bus(RW::Read);
                rR1 = 0xFF & this->get_bus_data();
                this->set_bus_mode(RW::Off);
                this->disown_bus();
@@ -203,6 +331,8 @@ public:
            } break;
                case Phase::Load1: {
 
+                   notify_bus(RW::Read);
+                   if (traps) [[unlikely]] check_watchpoint(TrapKind::Read);
                    rValue = this->get_bus_data();
                    this->set_bus_mode(RW::Off);
 
@@ -227,6 +357,7 @@ public:
                        rR0 = 4;
                    }
                    case Opcode::StoreIndexed: {
+                       stored = true;
                        cpu_phase = Phase::Store0;
                    } return;
                    case Opcode::TransferRegister:
@@ -252,15 +383,20 @@ public:
                                if(rCNT <= 0) {
                                    rln = rip;
                                    rip = rtmp;
+                                   check_idle_loop(instruction_address, rip);
+                                   if (observer) observer->on_branch(instruction_address, rip, rln);
                                }
                                break;
                            case 0x01:
                                if(rtmp == -1) {
                                    cpu_phase = Phase::Halted;
+                                   retire();
                                    return;
                                } else {
                                    rln = rip;
                                    rip = rtmp;
+                                   check_idle_loop(instruction_address, rip);
+                                   if (observer) observer->on_branch(instruction_address, rip, rln);
                                }
                                break;
                            case 0x02:
@@ -269,6 +405,15 @@ public:
                                rtmp = rtmp2;
                                rtmp2 = back;
                            } break;
+                           case 0x03:
+                               wait_requested = true;
+                               break;
+                           case 0x04:
+                               rip = rln;
+                               rln = interrupted_ln;
+                               in_service = false;
+                               if (observer) observer->on_branch(instruction_address, rip, rln);
+                               break;
                        }
                        break;
                }
@@ -299,14 +444,24 @@ public:
                        this->set_bus_data(*registers[rR0]);
                        break;
                }
+               notify_bus(RW::Write);
+               // Every instruction writes back here, only the stores write a value of their own.
+               if (traps && is_store()) [[unlikely]] check_watchpoint(TrapKind::Write);
                cpu_phase = Phase::Store1;
            }break;
            case Phase::Store1: {
                this->set_bus_mode(RW::Off);
                this->set_bus_address(0);
                this->set_bus_data(0);
-               cpu_phase = Phase::Fetch0;
-           }
+               retire();
+               cpu_phase = wait_requested ? Phase::Waiting : Phase::Fetch0;
+               wait_requested = false;
+           } break;
+           case Phase::Waiting: {
+               // Any request wakes the CPU, even one which is not taken because a handler is running.
+               if (interrupt_request) cpu_phase = Phase::Fetch0;
+           } break;
+           case Phase::Trapped:
            case Phase::Halted: break;
        }
    }
@@ -314,6 +469,182 @@ public:
    bool is_running() {
         return cpu_phase != Phase::Halted;
     }
+
+    /// Whether the CPU stopped at a breakpoint or watchpoint, it only continues after continue_from_trap.
+    [[nodiscard]] bool is_trapped() const {
+        return cpu_phase == Phase::Trapped;
+    }
+
+    /// The breakpoint or watchpoint the CPU stopped at.
+    [[nodiscard]] std::optional<Trap> const& get_trap() const {
+        return trap;
+    }
+
+    /**
+     * Continue after a trap. The CPU stopped before the instruction at a breakpoint, it executes once now.
+     * A watchpoint stops after the instruction hitting it, a breakpoint at the next instruction still stops the CPU.
+     */
+    void continue_from_trap() {
+        if (cpu_phase != Phase::Trapped) return;
+        step_over_breakpoint = trap && trap->kind == TrapKind::Breakpoint;
+        trap.reset();
+        cpu_phase = Phase::Fetch0;
+    }
+
+    /// Set the breakpoints and watchpoints, nullptr removes all of them. Only instructions started later are checked.
+    void set_traps(TrapMap const* value) {
+        traps = value;
+        if (!traps && cpu_phase != Phase::Trapped) trap.reset();
+    }
+
+    /// Whether the CPU executed wfi and no interrupt request arrived yet.
+    [[nodiscard]] bool is_waiting() const {
+        return cpu_phase == Phase::Waiting && !interrupt_request;
+    }
+
+    /// Whether the CPU waits or spins in an idle loop, only a change of a device can make it continue.
+    [[nodiscard]] bool is_idle() const {
+        return is_waiting() || (idle_loop && !(interrupt_request && !in_service));
+    }
+
+    /// Continue after devices changed, an idle loop has to repeat twice to be detected again.
+    void wake() {
+        idle_loop = false;
+        loop_target = -1;
+    }
+
+    /// Let the given number of cycles pass without simulating them, only valid while idle.
+    void skip_cycles(uint64_t count) {
+        cycles += count;
+    }
+
+    /// Stop the CPU as if it executed a halt.
+    void halt() {
+        cpu_phase = Phase::Halted;
+    }
+
+    ///! The CPU stops instead of starting another instruction once it retired this many.
+    uint64_t instruction_budget = std::numeric_limits<uint64_t>::max();
+
+    /// Stop the CPU because it ran out of a budget.
+    void exhaust_budget() {
+        budget_exhausted = true;
+        halt();
+    }
+
+    /// Whether the CPU stopped because it ran out of a budget rather than halting.
+    [[nodiscard]] bool is_out_of_budget() const {
+        return budget_exhausted;
+    }
+
+    void set_interrupt_request(std::optional<uint16_t> vector) override {
+        interrupt_request = vector;
+    }
+
+    /// The name of the current phase.
+    [[nodiscard]] const char* get_phase_name() const {
+        return to_string(cpu_phase);
+    }
+
+    /// Set the observer notified about retired instructions and branches, nullptr disables notifications.
+    void set_observer(CPUObserver* value) {
+        observer = value;
+        observe_registers = observer && observer->wants_registers();
+    }
+
+    /// A snapshot of all registers.
+    [[nodiscard]] CPURegisters get_registers() const {
+        CPURegisters snapshot;
+        for (size_t i = 0; i < registers.size(); ++i) snapshot.values[i] = *registers[i];
+        snapshot.values[CPURegisters::ip] = rip;
+        snapshot.values[CPURegisters::tmp2] = rtmp2;
+        return snapshot;
+    }
+
+    /// Whether the CPU is between two instructions, the only time its registers may be replaced.
+    [[nodiscard]] bool between_instructions() const {
+        return cpu_phase == Phase::Init || cpu_phase == Phase::Fetch0 ||
+               cpu_phase == Phase::Waiting || cpu_phase == Phase::Trapped || cpu_phase == Phase::Halted;
+    }
+
+    /// Replace the registers between two instructions, a CPU which did not start yet continues at the new rip.
+    void set_registers(CPURegisters const& snapshot) {
+        if (!between_instructions()) throw std::logic_error("Registers can only be set between instructions");
+        for (size_t i = 0; i < registers.size(); ++i) *registers[i] = snapshot.values[i];
+        rip = snapshot.values[CPURegisters::ip];
+        rtmp2 = snapshot.values[CPURegisters::tmp2];
+        if (cpu_phase == Phase::Init) cpu_phase = Phase::Fetch0;
+        wake();
+    }
+
+    /**
+     * Everything the CPU keeps from one instruction to the next, to continue from the same point later.
+     */
+    struct State {
+        CPURegisters registers;
+        uint8_t rR1;
+        Phase phase;
+        uint64_t cycles;
+        uint64_t retired_instructions;
+        uint16_t instruction_address;
+        uint64_t instruction_start;
+        std::optional<uint16_t> interrupt_request;
+        bool in_service;
+        register_type interrupted_ln;
+        bool wait_requested;
+        int32_t loop_target;
+        CPURegisters loop_registers;
+        bool stored;
+        bool idle_loop;
+        bool budget_exhausted;
+        std::optional<Trap> trap;
+        bool step_over_breakpoint;
+    };
+
+    /**
+     * Save the state between two instructions
+     * @throw std::logic_error if the CPU is in the middle of an instruction
+     */
+    [[nodiscard]] State save_state() const {
+        if (!between_instructions()) throw std::logic_error("The state can only be saved between instructions");
+        return {get_registers(), rR1, cpu_phase, cycles, retired_instructions, instruction_address, instruction_start,
+                interrupt_request, in_service, interrupted_ln, wait_requested, loop_target, loop_registers, stored,
+                idle_loop, budget_exhausted, trap, step_over_breakpoint};
+    }
+
+    /// Continue from a saved state, the traps and the budget stay as they are.
+    void restore_state(State const& state) {
+        for (size_t i = 0; i < registers.size(); ++i) *registers[i] = state.registers.values[i];
+        rip = state.registers.values[CPURegisters::ip];
+        rtmp2 = state.registers.values[CPURegisters::tmp2];
+        rR1 = state.rR1;
+        cpu_phase = state.phase;
+        cycles = state.cycles;
+        retired_instructions = state.retired_instructions;
+        instruction_address = state.instruction_address;
+        instruction_start = state.instruction_start;
+        interrupt_request = state.interrupt_request;
+        in_service = state.in_service;
+        interrupted_ln = state.interrupted_ln;
+        wait_requested = state.wait_requested;
+        loop_target = state.loop_target;
+        loop_registers = state.loop_registers;
+        stored = state.stored;
+        idle_loop = state.idle_loop;
+        budget_exhausted = state.budget_exhausted;
+        trap = state.trap;
+        step_over_breakpoint = state.step_over_breakpoint;
+    }
+
+    /// The number of simulated phases, one per call of simulate.
+    [[nodiscard]] uint64_t get_cycles() const {
+        return cycles;
+    }
+
+    /// The number of completed instructions, every instruction ends in Store1.
+    [[nodiscard]] uint64_t get_retired_instructions() const {
+        return retired_instructions;
+    }
 };
 
 
@@ -0,0 +1,121 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_CPU_OBSERVER_HXX
+#define CS8_CPU_OBSERVER_HXX
+
+#include "bus.hxx"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * A snapshot of the CPU registers.
+ */
+struct CPURegisters {
+    ///! The number of registers in a snapshot, the register file followed by rip and rtmp2.
+    static constexpr size_t count = 0x12;
+    static constexpr size_t ip = 0x10;
+    static constexpr size_t tmp2 = 0x11;
+
+    ///! Indexed like the register operands of the instructions, then rip and rtmp2.
+    std::array<int16_t, count> values {};
+
+    static constexpr const char* name(size_t index) {
+        constexpr std::array<const char*, count> names {
+                "dst", "sc0", "sc1", "idx", "tmp", "sp0", "sp1",
+                "dt0", "dt1", "dt2", "dt3", "dt4", "dt5",
+                "lnk", "cnt", "bse", "ip", "tmp2"
+        };
+        return index < count ? names[index] : "";
+    }
+
+    bool operator==(CPURegisters const&) const = default;
+};
+
+/**
+ * Receives notifications about the execution of the CPU.
+ * The CPU calls the observer only if one is set, so an unobserved CPU pays a single branch.
+ */
+struct CPUObserver {
+    virtual ~CPUObserver() = default;
+
+    /**
+     * Whether the observer needs the registers of on_retire. Taking the snapshot costs more than recording an
+     * address, the CPU calls on_retire_address instead for observers which return false. Read when the observer is set.
+     */
+    [[nodiscard]] virtual bool wants_registers() const { return true; }
+
+    /**
+     * An instruction was completed
+     * @param address the address of the instruction
+     * @param opcode the first byte of the instruction
+     * @param cycles the number of cycles spent on the instruction
+     * @param registers the registers after the instruction
+     */
+    virtual void on_retire(uint16_t address, uint8_t opcode, uint64_t cycles, CPURegisters const& registers) {}
+
+    /**
+     * An instruction was completed, called instead of on_retire if the observer does not want the registers
+     * @param address the address of the instruction
+     */
+    virtual void on_retire_address(uint16_t address) {}
+
+    /**
+     * A jle or jmp instruction transferred control, rln was set to the address after the instruction
+     * @param address the address of the branch instruction
+     * @param target the new instruction pointer
+     * @param link the new value of rln
+     */
+    virtual void on_branch(uint16_t address, uint16_t target, uint16_t link) {}
+
+    /**
+     * The CPU entered an interrupt handler before fetching its next instruction
+     * @param handler the address of the handler
+     */
+    virtual void on_interrupt(uint16_t handler) {}
+
+    /**
+     * The CPU read from or wrote to the bus
+     */
+    virtual void on_bus(RW mode, uint16_t address, uint16_t data) {}
+};
+
+/**
+ * Forwards every notification to several observers.
+ */
+struct CPUObserverGroup : CPUObserver {
+    std::vector<CPUObserver*> observers;
+
+    [[nodiscard]] bool wants_registers() const override {
+        return std::ranges::any_of(observers, [](auto* observer) { return observer->wants_registers(); });
+    }
+
+    void on_retire(uint16_t address, uint8_t opcode, uint64_t cycles, CPURegisters const& registers) override {
+        for (auto* observer : observers) {
+            if (observer->wants_registers()) observer->on_retire(address, opcode, cycles, registers);
+            else observer->on_retire_address(address);
+        }
+    }
+
+    void on_retire_address(uint16_t address) override {
+        for (auto* observer : observers) observer->on_retire_address(address);
+    }
+
+    void on_branch(uint16_t address, uint16_t target, uint16_t link) override {
+        for (auto* observer : observers) observer->on_branch(address, target, link);
+    }
+
+    void on_interrupt(uint16_t handler) override {
+        for (auto* observer : observers) observer->on_interrupt(handler);
+    }
+
+    void on_bus(RW mode, uint16_t address, uint16_t data) override {
+        for (auto* observer : observers) observer->on_bus(mode, address, data);
+    }
+};
+
+
+#endif //CS8_CPU_OBSERVER_HXX
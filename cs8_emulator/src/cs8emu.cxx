@@ -0,0 +1,283 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "cs8emu.hxx"
+#include <algorithm>
+#include <stdexcept>
+
+Emulator::Emulator(std::filesystem::path const& program_file) : Emulator(ProgramImage(program_file)) {}
+
+Emulator::Emulator(ProgramImage const& program) : owned_machine{std::make_unique<Machine>(program)} {
+    owned_machine->serial_port->buffers = &serial_buffers;
+    owned_machine->scheduler.block_when_idle = false;
+}
+
+Emulator::Emulator(ProgramImage const& program, std::shared_ptr<PageImage const> memory_image)
+: owned_machine{std::make_unique<Machine>(program, std::move(memory_image))} {
+    owned_machine->serial_port->buffers = &serial_buffers;
+    owned_machine->scheduler.block_when_idle = false;
+}
+
+void Emulator::reset(Machine::State const& state, std::shared_ptr<PageImage const> memory_image) {
+    owned_machine->memory->load(std::move(memory_image));
+    owned_machine->mmu->resize(owned_machine->mmu->bank_count());
+    owned_machine->restore_state(state);
+    owned_machine->serial_port->forget_later_output();
+    serial_buffers = {};
+    finished = false;
+    restart_history();
+}
+
+void Emulator::resume() {
+    owned_machine->cpu->continue_from_trap();
+    if (history) {
+        // While the log lasts the CPU wakes at the logged times, as it did before.
+        if (history->replaying()) return;
+        history->log_wake(owned_machine->scheduler.now());
+    }
+    owned_machine->cpu->wake();
+}
+
+void Emulator::advance(uint64_t time) {
+    auto& cpu = *owned_machine->cpu;
+    auto& scheduler = owned_machine->scheduler;
+    if (!history) {
+        scheduler.run_until(time);
+        return;
+    }
+    while (cpu.is_running() && !cpu.is_trapped() && scheduler.now() < time) {
+        auto const due = history->next_checkpoint();
+        if (instructions() >= due && cpu.between_instructions()) {
+            history->take_checkpoint();
+            continue;
+        }
+        auto const wake = history->next_wake();
+        if (wake <= scheduler.now()) {
+            history->consume_wake();
+            cpu.wake();
+            continue;
+        }
+        if (cpu.is_idle() && !scheduler.has_pending_events() && !scheduler.has_bus_masters() &&
+            wake == EventCalendar::never) {
+            // Nothing changes until the host adds input, the time passes as without history.
+            scheduler.run_until(time);
+            return;
+        }
+        // Every instruction takes at least one cycle, so this never runs past the checkpoint.
+        auto const to_checkpoint = due > instructions() ? due - instructions() : 1;
+        scheduler.run_until(std::min({time, wake, scheduler.now() + to_checkpoint}));
+    }
+}
+
+Emulator::StopReason Emulator::stopped() {
+    if (owned_machine->cpu->is_trapped()) return StopReason::Trap;
+    if (owned_machine->cpu->is_running()) return StopReason::Idle;
+    if (!finished) {
+        finished = true;
+        owned_machine->halted();
+    }
+    return StopReason::Halted;
+}
+
+Emulator::StopReason Emulator::run() {
+    resume();
+    // Without blocking an idle CPU without events returns from the run instead of sleeping.
+    advance(EventCalendar::never);
+    return stopped();
+}
+
+Emulator::StopReason Emulator::run_instructions(uint64_t count) {
+    resume();
+    auto const target = instructions() + count;
+    while (owned_machine->cpu->is_running() && !owned_machine->cpu->is_trapped() && instructions() < target) {
+        auto const before = instructions();
+        // Every instruction takes at least one cycle, so this never runs past the target.
+        advance(owned_machine->scheduler.now() + (target - before));
+        if (instructions() == before && owned_machine->cpu->is_idle() && !owned_machine->scheduler.has_pending_events() &&
+            !owned_machine->scheduler.has_bus_masters()) {
+            return StopReason::Idle;
+        }
+    }
+    return owned_machine->cpu->is_running() && !owned_machine->cpu->is_trapped() ? StopReason::InstructionLimit : stopped();
+}
+
+Emulator::StopReason Emulator::run_cycles(uint64_t count) {
+    resume();
+    advance(owned_machine->scheduler.now() + count);
+    return owned_machine->cpu->is_running() && !owned_machine->cpu->is_trapped() ? StopReason::CycleLimit : stopped();
+}
+
+bool Emulator::is_running() const {
+    return owned_machine->cpu->is_running();
+}
+
+uint64_t Emulator::cycles() const {
+    return owned_machine->cpu->get_cycles();
+}
+
+uint64_t Emulator::instructions() const {
+    return owned_machine->cpu->get_retired_instructions();
+}
+
+CPURegisters Emulator::registers() const {
+    return owned_machine->cpu->get_registers();
+}
+
+void Emulator::set_registers(CPURegisters const& registers) {
+    owned_machine->cpu->set_registers(registers);
+    restart_history();
+}
+
+std::span<Emulator::Word> Emulator::memory() {
+    return owned_machine->memory->contents();
+}
+
+std::span<Emulator::Word const> Emulator::memory() const {
+    return owned_machine->memory->contents();
+}
+
+void Emulator::read_memory(Address address, std::span<Word> destination) const {
+    auto const source = memory();
+    if (address > source.size() || destination.size() > source.size() - address) {
+        throw std::out_of_range("Memory range out of range");
+    }
+    std::copy_n(source.begin() + address, destination.size(), destination.begin());
+}
+
+void Emulator::write_memory(Address address, std::span<Word const> source) {
+    auto const destination = memory();
+    if (address > destination.size() || source.size() > destination.size() - address) {
+        throw std::out_of_range("Memory range out of range");
+    }
+    owned_machine->memory->write(address, source);
+    // An idle loop may poll the changed memory.
+    owned_machine->cpu->wake();
+    restart_history();
+}
+
+void Emulator::update_trap(TrapKind kind, Address address, bool set) {
+    if (!trap_map) {
+        if (!set) return;
+        trap_map = std::make_unique<TrapMap>();
+    }
+    if (set) trap_map->set(kind, address);
+    else trap_map->clear(kind, address);
+    owned_machine->cpu->set_traps(trap_map->empty() ? nullptr : trap_map.get());
+}
+
+void Emulator::set_breakpoint(Address address) {
+    update_trap(TrapKind::Breakpoint, address, true);
+}
+
+void Emulator::clear_breakpoint(Address address) {
+    update_trap(TrapKind::Breakpoint, address, false);
+}
+
+void Emulator::set_watchpoint(Address address, TrapKind access) {
+    if (access == TrapKind::Breakpoint) throw std::invalid_argument("A watchpoint watches reads or writes");
+    update_trap(access, address, true);
+}
+
+void Emulator::clear_watchpoint(Address address, TrapKind access) {
+    if (access == TrapKind::Breakpoint) throw std::invalid_argument("A watchpoint watches reads or writes");
+    update_trap(access, address, false);
+}
+
+std::optional<Trap> Emulator::trap() const {
+    if (!owned_machine->cpu->is_trapped()) return std::nullopt;
+    return owned_machine->cpu->get_trap();
+}
+
+SerialBuffers& Emulator::serial() {
+    return serial_buffers;
+}
+
+Machine& Emulator::machine() {
+    return *owned_machine;
+}
+
+void Emulator::record_history(uint64_t interval, size_t budget) {
+    if (interval == 0) throw std::invalid_argument("The checkpoint interval has to be at least one instruction");
+    // The old history detaches from the serial port first.
+    history.reset();
+    history = std::make_unique<History>(*owned_machine, interval, budget);
+    history_interval = interval;
+    history_budget = budget;
+}
+
+void Emulator::restart_history() {
+    if (history) record_history(history_interval, history_budget);
+}
+
+void Emulator::stop_history() {
+    history.reset();
+}
+
+History const* Emulator::get_history() const {
+    return history.get();
+}
+
+void Emulator::replay(size_t checkpoint, uint64_t target, bool traps, std::vector<uint64_t>* stops) {
+    auto& cpu = *owned_machine->cpu;
+    auto& scheduler = owned_machine->scheduler;
+    history->restore(checkpoint);
+    finished = false;
+    cpu.set_traps(traps && trap_map && !trap_map->empty() ? trap_map.get() : nullptr);
+    while (cpu.is_running() && instructions() < target) {
+        auto const before = instructions();
+        advance(scheduler.now() + (target - before));
+        if (cpu.is_trapped()) {
+            if (stops) stops->push_back(instructions());
+            cpu.continue_from_trap();
+        } else if (instructions() == before && cpu.is_idle() && !scheduler.has_pending_events() &&
+                   !scheduler.has_bus_masters() && !history->replaying()) {
+            // The logs end here, the run never got further.
+            break;
+        }
+    }
+    cpu.set_traps(trap_map && !trap_map->empty() ? trap_map.get() : nullptr);
+}
+
+Emulator::StopReason Emulator::reverse_step(uint64_t count) {
+    if (!history) throw std::logic_error("No history is recorded");
+    auto const& checkpoints = history->get_checkpoints();
+    if (checkpoints.empty()) return StopReason::HistoryStart;
+
+    auto const oldest = checkpoints.front().instructions;
+    if (instructions() < oldest || instructions() - oldest < count) {
+        replay(0, oldest, false, nullptr);
+        return StopReason::HistoryStart;
+    }
+    auto const target = instructions() - count;
+    replay(history->find(target), target, false, nullptr);
+    return StopReason::InstructionLimit;
+}
+
+Emulator::StopReason Emulator::reverse_continue() {
+    if (!history) throw std::logic_error("No history is recorded");
+    auto const& checkpoints = history->get_checkpoints();
+    if (checkpoints.empty()) return StopReason::HistoryStart;
+
+    auto const now = instructions();
+    if (trap_map && !trap_map->empty()) {
+        std::vector<uint64_t> stops;
+        // Search back one checkpoint at a time. A checkpoint taken when continuing from a breakpoint steps over it,
+        // so the run from the checkpoint before also looks at the stops right at it.
+        for (auto checkpoint = history->find(now) + 1; checkpoint-- > 0;) {
+            auto const end = checkpoint + 1 < checkpoints.size()
+                             ? std::min(now, checkpoints[checkpoint + 1].instructions + 1) : now;
+            stops.clear();
+            replay(checkpoint, end, true, &stops);
+            if (stops.empty()) continue;
+
+            // Run to the last stop again, with its watchpoint hit or breakpoint still ahead.
+            auto const last = stops.back();
+            replay(checkpoint, last, true, nullptr);
+            advance(owned_machine->scheduler.now() + 1);
+            return stopped();
+        }
+    }
+    replay(0, checkpoints.front().instructions, false, nullptr);
+    return StopReason::HistoryStart;
+}
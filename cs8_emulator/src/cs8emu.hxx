@@ -0,0 +1,218 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_CS8EMU_HXX
+#define CS8_CS8EMU_HXX
+
+#include "cpu_observer.hxx"
+#include "history.hxx"
+#include "machine.hxx"
+#include "program_image.hxx"
+#include "serial_port.hxx"
+#include "trap_map.hxx"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+/**
+ * The machine as a library, driven by the host in steps.
+ *
+ * The host decides how long the machine runs, reads and writes registers and memory between the steps and exchanges
+ * serial data through SerialBuffers instead of stdin and stdout. Running never blocks: a machine which can only
+ * continue after more serial input stops with StopReason::Idle, the host appends input and runs it again.
+ *
+ * Breakpoints stop a run before the instruction at their address, watchpoints after the instruction which read or
+ * wrote their address. The next run continues from there.
+ *
+ * With history recorded the machine also runs backwards: it returns to a checkpoint and runs forward to the point
+ * wanted, replaying the serial input and the wakes by the host the machine saw before. Running forward after going
+ * back repeats what happened before until the logs end. Output repeated this way does not reach the serial buffers
+ * again.
+ */
+class Emulator {
+public:
+    using Word = BusType::DataType;
+    using Address = BusType::AddressType;
+
+    enum class StopReason {
+        ///! The CPU halted, running it again does nothing.
+        Halted,
+        ///! The requested number of instructions retired.
+        InstructionLimit,
+        ///! The requested number of cycles passed.
+        CycleLimit,
+        ///! The CPU is idle and no device has an event pending, only new serial input can change that.
+        Idle,
+        ///! The CPU stopped at a breakpoint or watchpoint, see trap.
+        Trap,
+        ///! Running backwards reached the oldest checkpoint.
+        HistoryStart
+    };
+
+private:
+    std::unique_ptr<Machine> owned_machine;
+    SerialBuffers serial_buffers;
+    bool finished {false};
+    ///! Allocated with the first trap, the CPU only checks traps while there are any.
+    std::unique_ptr<TrapMap> trap_map;
+    ///! Set while history is recorded.
+    std::unique_ptr<History> history;
+    uint64_t history_interval {0};
+    size_t history_budget {0};
+
+    /// Prepare a run, the host may have changed what an idle loop reads.
+    void resume();
+    /// Run the scheduler up to the time, taking the checkpoints due and waking the CPU at the logged times.
+    void advance(uint64_t time);
+    /// Drop the history after the host changed the machine, a replay would not repeat the run any more.
+    void restart_history();
+    /**
+     * Restore a checkpoint and run forward until the given number of instructions retired
+     * @param traps whether to stop at the traps on the way, the stops go to stops and the run continues
+     */
+    void replay(size_t checkpoint, uint64_t target, bool traps, std::vector<uint64_t>* stops);
+    /// The reason a run ended before its limit, the devices are flushed once the CPU halted.
+    StopReason stopped();
+    /// Change a trap and let the CPU check the traps only while there are any.
+    void update_trap(TrapKind kind, Address address, bool set);
+
+public:
+    /**
+     * Build the machine and load the program into memory
+     * @param program_file a path to an elf file or flat image
+     */
+    explicit Emulator(std::filesystem::path const& program_file);
+
+    /**
+     * Build the machine and load the program into memory
+     * @param program a mapped elf file or flat image
+     */
+    explicit Emulator(ProgramImage const& program);
+
+    /**
+     * Build the machine with memory sharing the pages of an image of the program, cheap for many machines
+     * @param program the program, for the parts of it not in memory
+     * @param memory_image the memory of the program, see load_memory_image
+     */
+    Emulator(ProgramImage const& program, std::shared_ptr<PageImage const> memory_image);
+
+    Emulator(Emulator const&) = delete;
+    Emulator& operator=(Emulator const&) = delete;
+
+    /**
+     * Start over from a state saved before, cheaper than building a new machine for every run.
+     * Memory shares the pages of the image again, the banks of the MMU and the serial buffers are emptied and a
+     * recorded history starts anew.
+     * @param state the state to continue from, see Machine::save_state
+     * @param memory_image the memory to continue with, see load_memory_image
+     */
+    void reset(Machine::State const& state, std::shared_ptr<PageImage const> memory_image);
+
+    /**
+     * Run until the CPU halts or idles
+     */
+    StopReason run();
+
+    /**
+     * Run until the given number of instructions retired, the CPU halts or idles.
+     * An instruction limit always stops between two instructions.
+     */
+    StopReason run_instructions(uint64_t count);
+
+    /**
+     * Run for the given number of cycles unless the CPU halts before, idle cycles pass without simulating them.
+     * A cycle limit may stop in the middle of an instruction.
+     */
+    StopReason run_cycles(uint64_t count);
+
+    /// Whether the CPU did not halt yet.
+    [[nodiscard]] bool is_running() const;
+
+    /// The number of cycles since the start.
+    [[nodiscard]] uint64_t cycles() const;
+
+    /// The number of instructions retired since the start.
+    [[nodiscard]] uint64_t instructions() const;
+
+    /// The registers of the CPU.
+    [[nodiscard]] CPURegisters registers() const;
+
+    /**
+     * Replace the registers of the CPU
+     * @throw std::logic_error if the CPU is in the middle of an instruction, which only a cycle limit can leave it in
+     */
+    void set_registers(CPURegisters const& registers);
+
+    /// The memory at 0x0000 up, writes take effect immediately. A recorded history misses them, unlike write_memory.
+    [[nodiscard]] std::span<Word> memory();
+    [[nodiscard]] std::span<Word const> memory() const;
+
+    /**
+     * Copy memory to the host
+     * @throw std::out_of_range if the range is not in memory
+     */
+    void read_memory(Address address, std::span<Word> destination) const;
+
+    /**
+     * Copy host data to memory
+     * @throw std::out_of_range if the range is not in memory
+     */
+    void write_memory(Address address, std::span<Word const> source);
+
+    /// Stop before executing the instruction at the address.
+    void set_breakpoint(Address address);
+    void clear_breakpoint(Address address);
+
+    /**
+     * Stop after an instruction reads or writes the address, instruction fetches and devices do not hit watchpoints
+     * @param access TrapKind::Read or TrapKind::Write, set both to watch every access
+     */
+    void set_watchpoint(Address address, TrapKind access);
+    void clear_watchpoint(Address address, TrapKind access);
+
+    /// The trap the last run stopped at, if it stopped with StopReason::Trap.
+    [[nodiscard]] std::optional<Trap> trap() const;
+
+    /**
+     * Keep checkpoints from the next instruction boundary on, for running backwards.
+     * Changing registers or memory through the API drops the checkpoints and starts over, changing the memory span
+     * directly breaks the replay. The backing store of the MMU must not be resized afterwards.
+     * @param interval the number of instructions from one checkpoint to the next
+     * @param budget the bytes the checkpoints may take, the oldest ones are dropped beyond it. Besides that the
+     * history keeps a copy of memory and the banks of the MMU.
+     * @throw std::invalid_argument if the interval is 0
+     */
+    void record_history(uint64_t interval, size_t budget);
+
+    /// Stop keeping checkpoints, the machine continues from where it is.
+    void stop_history();
+
+    /// The history, nullptr unless it is recorded.
+    [[nodiscard]] History const* get_history() const;
+
+    /**
+     * Run backwards until the given number of instructions are undone, the traps on the way are passed
+     * @return StopReason::InstructionLimit or StopReason::HistoryStart if the oldest checkpoint came first
+     * @throw std::logic_error if no history is recorded
+     */
+    StopReason reverse_step(uint64_t count = 1);
+
+    /**
+     * Run backwards to the last trap before the current instruction
+     * @return StopReason::Trap or StopReason::HistoryStart if no trap hit since the oldest checkpoint
+     * @throw std::logic_error if no history is recorded
+     */
+    StopReason reverse_continue();
+
+    /// The serial input and output of the guest.
+    [[nodiscard]] SerialBuffers& serial();
+
+    /// The machine itself, for devices the API does not cover.
+    [[nodiscard]] Machine& machine();
+};
+
+#endif //CS8_CS8EMU_HXX
@@ -5,10 +5,23 @@
 #ifndef CS8_DEVICE_HXX
 #define CS8_DEVICE_HXX
 
+#include <cstdint>
 
 struct Device {
+    virtual ~Device() = default;
     virtual void init() {}
     virtual void simulate() = 0;
+    /// Called by the scheduler at the time the device asked for, see EventCalendar::schedule.
+    virtual void on_event(uint64_t time) {}
+    /// Called in every cycle the CPU leaves the bus to a device which requested it, see BusArbiter::request_bus.
+    virtual void on_bus_grant() {}
+    /// A file descriptor the device reads host input from, -1 if it does not expect any more input.
+    virtual int input_descriptor() const { return -1; }
+    /**
+     * Whether reading the address returns the same value until the next event of the device or a write to it.
+     * Reads of a value changing with time alone, like a counter, keep a polling loop from being skipped as idle.
+     */
+    virtual bool stable_read(uint16_t address) const { return true; }
 };
 
 
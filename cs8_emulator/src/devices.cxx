@@ -1,5 +0,0 @@
-//
-// Created by mkr on 7/24/21.
-//
-
-#include "devices.hxx"
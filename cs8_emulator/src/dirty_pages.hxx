@@ -0,0 +1,75 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_DIRTY_PAGES_HXX
+#define CS8_DIRTY_PAGES_HXX
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * One bit for every page of a buffer, set when something writes the page. Finding the changes of the buffer then
+ * takes the marked pages only instead of comparing all of it.
+ *
+ * The devices writing the buffer mark what they wrote while the tracker is attached to them. A page may be marked
+ * without having changed, never the other way round.
+ */
+class DirtyPages {
+public:
+    ///! The unit writes are tracked in, in bytes.
+    static constexpr size_t page_size = 512;
+
+private:
+    std::byte const* base;
+    size_t page_count;
+    std::vector<uint64_t> bits;
+
+public:
+    /**
+     * Track the pages of the buffer, none is marked at first
+     */
+    explicit DirtyPages(std::span<std::byte const> buffer)
+    : base{buffer.data()}, page_count{(buffer.size() + page_size - 1) / page_size}, bits((page_count + 63) / 64) {}
+
+    /// The number of pages of the buffer, the last one may be shorter.
+    [[nodiscard]] size_t pages() const {
+        return page_count;
+    }
+
+    void mark(size_t page) {
+        bits[page >> 6] |= uint64_t{1} << (page & 63);
+    }
+
+    /// Mark the pages holding the values, they have to lie in the buffer.
+    template<typename T>
+    void mark(std::span<T> written) {
+        if (written.empty()) return;
+        auto const begin = static_cast<size_t>(reinterpret_cast<std::byte const*>(written.data()) - base);
+        auto const end = begin + written.size_bytes() - 1;
+        for (size_t page = begin / page_size; page <= end / page_size; ++page) mark(page);
+    }
+
+    [[nodiscard]] bool marked(size_t page) const {
+        return bits[page >> 6] >> (page & 63) & 1;
+    }
+
+    void clear() {
+        std::fill(bits.begin(), bits.end(), 0);
+    }
+
+    /// Call f with the number of every marked page, in ascending order.
+    template<typename F>
+    void for_each(F&& f) const {
+        for (size_t word = 0; word < bits.size(); ++word) {
+            for (auto rest = bits[word]; rest != 0; rest &= rest - 1) f(word * 64 + static_cast<size_t>(std::countr_zero(rest)));
+        }
+    }
+};
+
+
+#endif //CS8_DIRTY_PAGES_HXX
@@ -0,0 +1,5 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "dma_controller.hxx"
@@ -0,0 +1,257 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_DMA_CONTROLLER_HXX
+#define CS8_DMA_CONTROLLER_HXX
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include "bus.hxx"
+#include "device.hxx"
+#include "dirty_pages.hxx"
+#include "interrupt_line.hxx"
+#include "scheduler.hxx"
+
+/**
+ * A DMA engine copying or filling blocks of bus units.
+ *
+ * Registers, relative to Begin:
+ *  - 0 SOURCE       the first address to read, the value to write when filling
+ *  - 1 DESTINATION  the first address to write
+ *  - 2 LENGTH       the number of units to transfer
+ *  - 3 MODE         bit 0 fill, bit 1 fixed source, bit 2 fixed destination, bit 3 interrupt on completion
+ *  - 4 START        writing 1 starts a transfer unless one is running, reads as 0
+ *  - 5 STATUS       bit 0 is set while a transfer runs, read only
+ *  - 6 REMAINING    units left to transfer, read only
+ *
+ * A transfer moves one unit in every cycle the CPU leaves the bus free. The bus is restored afterwards, the CPU
+ * never sees what the DMA put on it. Transfers within plain memory are copied at once and complete after one cycle
+ * per unit.
+ */
+template<size_t Size, typename AllocUnit, typename Address, Address Begin, Address End, size_t ID, BusLike<AllocUnit, Address> Bus>
+class DMAController : public Device, public BusDevice<AllocUnit, Address, ID, Bus> {
+public:
+    using AllocationUnit = AllocUnit;
+    static constexpr Address AddressBegin = Begin;
+    static constexpr Address AddressEnd = End;
+    static constexpr size_t DeviceID = ID;
+
+    enum Register : Address {
+        Source = 0, Destination = 1, Length = 2, Mode = 3, Start = 4, Status = 5, Remaining = 6
+    };
+
+    static constexpr uint16_t mode_fill = 1u << 0;
+    static constexpr uint16_t mode_fixed_source = 1u << 1;
+    static constexpr uint16_t mode_fixed_destination = 1u << 2;
+    static constexpr uint16_t mode_interrupt = 1u << 3;
+
+    static constexpr uint16_t status_busy = 1u << 0;
+
+private:
+    EventCalendar* calendar {nullptr};
+    BusArbiter* arbiter {nullptr};
+    InterruptSink* interrupts {nullptr};
+    size_t interrupt_source {0};
+
+    std::span<AllocUnit> memory;
+    Address memory_begin {0};
+    ///! Marks the pages of memory written, nullptr if nothing tracks them.
+    DirtyPages* dirty {nullptr};
+
+    uint16_t source {0};
+    uint16_t destination {0};
+    uint16_t length {0};
+    uint16_t mode {0};
+
+    bool busy {false};
+    Address next_source {0};
+    Address next_destination {0};
+    uint16_t remaining {0};
+    ///! The completion time of a bulk transfer, EventCalendar::never for a cycle stealing one.
+    uint64_t bulk_end {EventCalendar::never};
+
+    [[nodiscard]] bool in_memory(Address address, size_t count) const {
+        return address >= memory_begin && address - memory_begin + count <= memory.size();
+    }
+
+    [[nodiscard]] bool is_bulk() const {
+        if (mode & (mode_fixed_source | mode_fixed_destination)) return false;
+        return in_memory(destination, length) && ((mode & mode_fill) || in_memory(source, length));
+    }
+
+    void start() {
+        if (busy || length == 0) return;
+        busy = true;
+        next_source = source;
+        next_destination = destination;
+        remaining = length;
+
+        if (is_bulk()) {
+            auto const target = memory.subspan(destination - memory_begin, length);
+            if (mode & mode_fill) {
+                std::fill(target.begin(), target.end(), static_cast<AllocUnit>(source));
+            } else {
+                // Forward unit by unit like the bus transfer, an overlapping destination after the source repeats it.
+                auto const from = memory.subspan(source - memory_begin, length);
+                if (destination <= source || destination >= source + length) {
+                    std::copy(from.begin(), from.end(), target.begin());
+                } else {
+                    for (size_t i = 0; i < length; ++i) target[i] = from[i];
+                }
+            }
+            if (dirty) dirty->mark(target);
+            bulk_end = calendar->now() + length;
+            calendar->schedule(*this, bulk_end);
+        } else {
+            arbiter->request_bus(*this);
+        }
+    }
+
+    void finish() {
+        busy = false;
+        remaining = 0;
+        bulk_end = EventCalendar::never;
+        arbiter->release_bus(*this);
+        if ((mode & mode_interrupt) && interrupts) interrupts->raise(interrupt_source);
+    }
+
+    [[nodiscard]] uint16_t read(Address offset) const {
+        switch (offset) {
+            case Source: return source;
+            case Destination: return destination;
+            case Length: return length;
+            case Mode: return mode;
+            case Status: return busy ? status_busy : 0;
+            case Remaining:
+                if (bulk_end != EventCalendar::never) return static_cast<uint16_t>(std::min<uint64_t>(remaining, bulk_end - calendar->now()));
+                return remaining;
+            default: return 0;
+        }
+    }
+
+    void write(Address offset, uint16_t value) {
+        switch (offset) {
+            case Source: source = value; break;
+            case Destination: destination = value; break;
+            case Length: length = value; break;
+            case Mode: mode = value; break;
+            case Start: if (value & 1) start(); break;
+            default: break;
+        }
+    }
+
+public:
+    /**
+     * Connect the controller, completion interrupts are raised as the given source if interrupts is set
+     */
+    void attach(EventCalendar& event_calendar, BusArbiter& bus_arbiter, InterruptSink* interrupt_sink, size_t source_number) {
+        calendar = &event_calendar;
+        arbiter = &bus_arbiter;
+        interrupts = interrupt_sink;
+        interrupt_source = source_number;
+    }
+
+    /**
+     * Allow bulk transfers within plain memory mapped at the given address
+     */
+    void attach_memory(std::span<AllocUnit> buffer, Address begin) {
+        memory = buffer;
+        memory_begin = begin;
+    }
+
+    /// Mark the pages of memory written from now on in the tracker, nullptr stops marking.
+    void set_dirty_pages(DirtyPages* pages) {
+        dirty = pages;
+    }
+
+    /// Whether a transfer is in progress, a bulk transfer copied everything when it started.
+    [[nodiscard]] bool is_busy() const {
+        return busy;
+    }
+
+    /// The registers and the transfer in progress, the calendar and the arbiter keep its event and bus requests.
+    struct State {
+        uint16_t source;
+        uint16_t destination;
+        uint16_t length;
+        uint16_t mode;
+        bool busy;
+        Address next_source;
+        Address next_destination;
+        uint16_t remaining;
+        uint64_t bulk_end;
+    };
+
+    [[nodiscard]] State save_state() const {
+        return {source, destination, length, mode, busy, next_source, next_destination, remaining, bulk_end};
+    }
+
+    void restore_state(State const& state) {
+        source = state.source;
+        destination = state.destination;
+        length = state.length;
+        mode = state.mode;
+        busy = state.busy;
+        next_source = state.next_source;
+        next_destination = state.next_destination;
+        remaining = state.remaining;
+        bulk_end = state.bulk_end;
+    }
+
+    void simulate() override {
+        if (this->get_bus_mode() == RW::Read ||
+            this->get_bus_mode() == RW::Write) {
+            if (this->get_bus_address() >= Begin &&
+                this->get_bus_address() <= End) {
+                auto const offset = static_cast<Address>(this->get_bus_address() - Begin);
+
+                if (this->get_bus_mode() == RW::Read) {
+                    this->set_bus_data(read(offset));
+                } else {
+                    write(offset, this->get_bus_data());
+                }
+            }
+        }
+    }
+
+    void on_bus_grant() override {
+        auto const saved_address = this->get_bus_address();
+        auto const saved_data = this->get_bus_data();
+
+        this->own_bus();
+        AllocUnit value = static_cast<AllocUnit>(source);
+        if (!(mode & mode_fill)) {
+            this->set_bus_mode(RW::Read);
+            this->set_bus_address(next_source);
+            arbiter->complete_transaction();
+            value = this->get_bus_data();
+            if (!(mode & mode_fixed_source)) ++next_source;
+        }
+        this->set_bus_mode(RW::Write);
+        this->set_bus_address(next_destination);
+        this->set_bus_data(value);
+        arbiter->complete_transaction();
+        if (!(mode & mode_fixed_destination)) ++next_destination;
+
+        this->set_bus_mode(RW::Off);
+        this->set_bus_address(saved_address);
+        this->set_bus_data(saved_data);
+        this->disown_bus();
+
+        if (--remaining == 0) finish();
+    }
+
+    /// REMAINING of a bulk transfer runs down with time, the transfer only has an event when it ends.
+    bool stable_read(uint16_t address) const override {
+        return address != Begin + Remaining;
+    }
+
+    void on_event(uint64_t time) override {
+        finish();
+    }
+};
+
+
+#endif //CS8_DMA_CONTROLLER_HXX
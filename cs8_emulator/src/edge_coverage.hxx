@@ -0,0 +1,38 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_EDGE_COVERAGE_HXX
+#define CS8_EDGE_COVERAGE_HXX
+
+#include "cpu_observer.hxx"
+#include <bit>
+#include <cstdint>
+#include <span>
+
+/**
+ * Counts the control flow edges the guest takes, for coverage guided fuzzing.
+ *
+ * Every taken jle or jmp is an edge from the branch instruction to its target, the edge is hashed into a counter.
+ * The counters saturate instead of wrapping, so an edge taken often never looks like one not taken at all.
+ */
+class EdgeCoverage : public CPUObserver {
+    std::span<uint8_t> counters;
+    uint16_t mask;
+
+public:
+    /**
+     * @param counters the counters to increment, their number has to be a power of two of at most 65536
+     */
+    explicit EdgeCoverage(std::span<uint8_t> counters)
+    : counters{counters}, mask{static_cast<uint16_t>(counters.size() - 1)} {}
+
+    [[nodiscard]] bool wants_registers() const override { return false; }
+
+    void on_branch(uint16_t address, uint16_t target, uint16_t link) override {
+        auto& counter = counters[(address ^ std::rotl(target, 5)) & mask];
+        if (counter != UINT8_MAX) ++counter;
+    }
+};
+
+#endif //CS8_EDGE_COVERAGE_HXX
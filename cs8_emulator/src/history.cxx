@@ -0,0 +1,148 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "history.hxx"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+History::History(Machine& machine, uint64_t interval, size_t budget)
+: machine{machine}, interval{interval}, budget{budget},
+  regions{Region{std::as_writable_bytes(machine.memory->contents())},
+          Region{std::as_writable_bytes(machine.mmu->backing_store())}} {
+    if (interval == 0) throw std::invalid_argument("The checkpoint interval has to be at least one instruction");
+    size_t first_page = 0;
+    for (auto& region : regions) {
+        region.first_page = first_page;
+        first_page += region.dirty.pages();
+    }
+    machine.serial_port->set_input_log(&input_log);
+    attach_dirty_pages(true);
+}
+
+History::~History() {
+    machine.serial_port->set_input_log(nullptr);
+    attach_dirty_pages(false);
+}
+
+void History::attach_dirty_pages(bool attach) {
+    auto* const memory = attach ? &regions[0].dirty : nullptr;
+    machine.memory->set_dirty_pages(memory);
+    machine.dma_controller->set_dirty_pages(memory);
+    machine.host_call->set_dirty_pages(memory);
+    machine.block_device->set_dirty_pages(memory);
+    machine.mmu->set_dirty_pages(attach ? &regions[1].dirty : nullptr);
+}
+
+std::span<std::byte> History::page(std::span<std::byte> bytes, size_t index) {
+    auto const begin = index * page_size;
+    return bytes.subspan(begin, std::min(page_size, bytes.size() - begin));
+}
+
+History::Region& History::region_of(size_t page_number) {
+    auto region = regions.rbegin();
+    while (region->first_page > page_number) ++region;
+    return *region;
+}
+
+uint64_t History::next_checkpoint() const {
+    return checkpoints.empty() ? 0 : checkpoints.back().instructions + interval;
+}
+
+void History::save_changes(Checkpoint& newest) {
+    for (auto& region : regions) {
+        region.dirty.for_each([&](size_t i) {
+            auto const live = page(region.live, i);
+            auto const saved = page(region.newest_contents(), i);
+            // A page written back to its old contents is marked without having changed.
+            if (std::memcmp(live.data(), saved.data(), live.size()) == 0) return;
+            newest.pages.push_back(region.first_page + i);
+            newest.contents.insert(newest.contents.end(), saved.begin(), saved.end());
+            newest.contents.resize(newest.pages.size() * page_size);
+            std::copy(live.begin(), live.end(), saved.begin());
+        });
+        region.dirty.clear();
+    }
+    bytes += newest.pages.size() * (sizeof(size_t) + page_size);
+}
+
+void History::take_checkpoint() {
+    Checkpoint checkpoint {machine.cpu->get_retired_instructions(), machine.save_state(), dropped_wakes + wakes.size()};
+    if (checkpoints.empty()) {
+        for (auto& region : regions) {
+            region.newest = PageMapping(region.live.size());
+            region.newest.share(PageImage::capture(region.live));
+            region.dirty.clear();
+        }
+    } else {
+        save_changes(checkpoints.back());
+    }
+    checkpoints.push_back(std::move(checkpoint));
+    bytes += sizeof(Checkpoint);
+    trim();
+}
+
+void History::trim() {
+    while (checkpoints.size() > 1 && bytes > budget) {
+        auto const& oldest = checkpoints.front();
+        bytes -= sizeof(Checkpoint) + oldest.pages.size() * (sizeof(size_t) + page_size);
+        checkpoints.pop_front();
+    }
+    // Wakes before the oldest checkpoint are never replayed again.
+    while (dropped_wakes < checkpoints.front().wakes && dropped_wakes < wake_position) {
+        wakes.pop_front();
+        ++dropped_wakes;
+    }
+}
+
+size_t History::find(uint64_t instructions) const {
+    auto const after = std::upper_bound(checkpoints.begin(), checkpoints.end(), instructions,
+                                        [](uint64_t count, Checkpoint const& checkpoint) {
+                                            return count < checkpoint.instructions;
+                                        });
+    return after == checkpoints.begin() ? 0 : static_cast<size_t>(after - checkpoints.begin() - 1);
+}
+
+void History::restore(size_t index) {
+    if (index >= checkpoints.size()) throw std::out_of_range("No such checkpoint");
+
+    // Back to the newest checkpoint, then undo the changes of the newer checkpoints one by one.
+    for (auto& region : regions) {
+        region.dirty.for_each([&](size_t i) {
+            auto const live = page(region.live, i);
+            auto const saved = page(region.newest_contents(), i);
+            if (std::memcmp(live.data(), saved.data(), live.size()) != 0) std::copy(saved.begin(), saved.end(), live.begin());
+        });
+        region.dirty.clear();
+    }
+    // The pages undone now differ from the newest contents, the next checkpoint has to compare them.
+    for (auto checkpoint = checkpoints.size() - 1; checkpoint-- > index;) {
+        auto const& changes = checkpoints[checkpoint];
+        for (size_t i = 0; i < changes.pages.size(); ++i) {
+            auto& region = region_of(changes.pages[i]);
+            auto const number = changes.pages[i] - region.first_page;
+            auto const live = page(region.live, number);
+            std::copy_n(changes.contents.begin() + static_cast<std::ptrdiff_t>(i * page_size), live.size(), live.begin());
+            region.dirty.mark(number);
+        }
+    }
+
+    machine.restore_state(checkpoints[index].state);
+    wake_position = checkpoints[index].wakes;
+}
+
+void History::log_wake(uint64_t time) {
+    wakes.push_back(time);
+    wake_position = dropped_wakes + wakes.size();
+}
+
+uint64_t History::next_wake() const {
+    return replaying() ? wakes[wake_position - dropped_wakes] : EventCalendar::never;
+}
+
+size_t History::memory_usage() const {
+    size_t newest = 0;
+    for (auto const& region : regions) newest += region.newest.get_size();
+    return bytes + newest;
+}
@@ -0,0 +1,145 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_HISTORY_HXX
+#define CS8_HISTORY_HXX
+
+#include "dirty_pages.hxx"
+#include "machine.hxx"
+#include "page_mapping.hxx"
+#include "serial_port.hxx"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+/**
+ * Checkpoints of a machine every few instructions, restoring one and running forward reaches every later instruction
+ * again.
+ *
+ * A checkpoint keeps the state of the CPU and the devices and the pages of memory and of the MMU banks which changed
+ * until the next checkpoint, with their contents at the checkpoint. Only the contents at the newest checkpoint are kept
+ * in full, restoring an older one goes back from there. They share the host pages of an image of the contents until
+ * the pages change. The devices writing memory and the banks mark the pages they write, only the marked pages are
+ * compared with the newest contents. The host changes memory with Emulator::write_memory, which restarts the history.
+ *
+ * Running from a checkpoint repeats the run as long as the machine sees the same input. The serial port takes its
+ * input from the input log up to its end, the host wakes the CPU only at the logged times up to the end of the wake
+ * log. What the guest writes to the medium of the block device is not undone.
+ */
+class History {
+public:
+    ///! The unit changes are saved in, in bytes.
+    static constexpr size_t page_size = DirtyPages::page_size;
+
+    struct Checkpoint {
+        uint64_t instructions;
+        Machine::State state;
+        ///! The number of wakes logged before the checkpoint.
+        size_t wakes;
+        ///! The pages which changed until the next checkpoint, numbered across the regions.
+        std::vector<size_t> pages;
+        ///! The contents of the pages at this checkpoint, page_size bytes each.
+        std::vector<std::byte> contents;
+    };
+
+private:
+    struct Region {
+        std::span<std::byte> live;
+        ///! The pages written since the newest checkpoint or differing from it after a restore.
+        DirtyPages dirty;
+        ///! The contents at the newest checkpoint.
+        PageMapping newest;
+        ///! The number of the first page of the region.
+        size_t first_page {0};
+
+        explicit Region(std::span<std::byte> live) : live{live}, dirty{live} {}
+
+        [[nodiscard]] std::span<std::byte> newest_contents() const {
+            return {newest.as<std::byte>(), live.size()};
+        }
+    };
+
+    Machine& machine;
+    uint64_t interval;
+    size_t budget;
+
+    ///! Memory and the banks of the MMU.
+    std::array<Region, 2> regions;
+    std::deque<Checkpoint> checkpoints;
+    size_t bytes {0};
+
+    SerialInputLog input_log;
+    ///! The times the host woke the CPU, wakes[i] is the wake number dropped_wakes + i.
+    std::deque<uint64_t> wakes;
+    size_t dropped_wakes {0};
+    size_t wake_position {0};
+
+    /// The bytes of a page, the last page of a region may be shorter.
+    [[nodiscard]] static std::span<std::byte> page(std::span<std::byte> bytes, size_t index);
+    /// The region of a page numbered across the regions.
+    [[nodiscard]] Region& region_of(size_t page_number);
+    /// Save the pages changed since the newest checkpoint into it and make the current contents the newest.
+    void save_changes(Checkpoint& newest);
+    /// Drop the oldest checkpoints until the rest fit into the budget.
+    void trim();
+    /// Let the devices writing memory and the banks mark the pages they write, or stop them.
+    void attach_dirty_pages(bool attach);
+
+public:
+    /**
+     * Keep checkpoints of the machine, the first one is taken with take_checkpoint
+     * @param interval the number of instructions from one checkpoint to the next
+     * @param budget the bytes the checkpoints may take, the oldest ones are dropped beyond it, the newest one never
+     * @throw std::invalid_argument if the interval is 0
+     */
+    History(Machine& machine, uint64_t interval, size_t budget);
+    ~History();
+
+    History(History const&) = delete;
+    History& operator=(History const&) = delete;
+
+    /// The number of retired instructions the next checkpoint is due at.
+    [[nodiscard]] uint64_t next_checkpoint() const;
+
+    /**
+     * Save the current state as the newest checkpoint
+     * @throw std::logic_error if the CPU is in the middle of an instruction
+     */
+    void take_checkpoint();
+
+    /// The checkpoints, the oldest first.
+    [[nodiscard]] std::deque<Checkpoint> const& get_checkpoints() const {
+        return checkpoints;
+    }
+
+    /// The index of the newest checkpoint at or before the instruction count, 0 if there is none.
+    [[nodiscard]] size_t find(uint64_t instructions) const;
+
+    /// Return the machine to a checkpoint, the newer ones stay.
+    void restore(size_t index);
+
+    /// Log that the host woke the CPU now.
+    void log_wake(uint64_t time);
+
+    /// Whether wakes from the log are still ahead, the host must not wake the CPU itself then.
+    [[nodiscard]] bool replaying() const {
+        return wake_position < dropped_wakes + wakes.size();
+    }
+
+    /// The time of the next logged wake ahead, EventCalendar::never if there is none.
+    [[nodiscard]] uint64_t next_wake() const;
+
+    /// Pass the next logged wake.
+    void consume_wake() {
+        ++wake_position;
+    }
+
+    /// The bytes taken by the checkpoints and the newest contents, counting the shared pages of the newest contents.
+    [[nodiscard]] size_t memory_usage() const;
+};
+
+#endif //CS8_HISTORY_HXX
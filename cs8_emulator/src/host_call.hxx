@@ -0,0 +1,204 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_HOST_CALL_HXX
+#define CS8_HOST_CALL_HXX
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include "bus.hxx"
+#include "device.hxx"
+#include "dirty_pages.hxx"
+
+/**
+ * Lets the host perform common runtime operations for the guest.
+ *
+ * Registers, relative to Begin:
+ *  - 0 OPERATION    writing an operation performs it, reads as 0
+ *  - 1..4           ARG0..ARG3
+ *  - 5..8           RESULT0..RESULT3, read only
+ *  - 9 STATUS       0 on success, see Status, read only
+ *  - 10 EXIT        writing stops the machine with the value as exit code, reads as -1 and writing -1 is ignored
+ *
+ * Operations, addresses are bus addresses within memory:
+ *  - 1 MEMCPY  copy ARG2 units from ARG1 to ARG0, the ranges may overlap
+ *  - 2 MEMSET  set ARG2 units at ARG0 to ARG1
+ *  - 3 MEMCMP  compare ARG2 units at ARG0 and ARG1, RESULT0 is -1, 0 or 1
+ *  - 4 PRINT   print the zero terminated string at ARG0, at most ARG1 characters unless ARG1 is 0
+ *  - 5 MUL32   RESULT0:RESULT1 = ARG0:ARG1 * ARG2:ARG3, the high word comes first
+ *  - 6 DIV32   RESULT0:RESULT1 = ARG0:ARG1 / ARG2:ARG3, RESULT2:RESULT3 = the remainder, unsigned
+ *
+ * The operations complete within the write, the guest can read the results with the next instruction.
+ */
+template<size_t Size, typename AllocUnit, typename Address, Address Begin, Address End, size_t ID, BusLike<AllocUnit, Address> Bus>
+class HostCall : public Device, public BusDevice<AllocUnit, Address, ID, Bus> {
+public:
+    using AllocationUnit = AllocUnit;
+    static constexpr Address AddressBegin = Begin;
+    static constexpr Address AddressEnd = End;
+    static constexpr size_t DeviceID = ID;
+
+    enum Register : Address {
+        Operation = 0, Argument0 = 1, Result0 = 5, StatusRegister = 9, Exit = 10
+    };
+
+    enum class Op : uint16_t {
+        None = 0, MemCpy = 1, MemSet = 2, MemCmp = 3, Print = 4, Mul32 = 5, Div32 = 6
+    };
+
+    enum class Status : uint16_t {
+        Ok = 0, InvalidOperation = 1, DivisionByZero = 2, InvalidAddress = 3
+    };
+
+    /// Receives the strings printed by the guest.
+    std::function<void(std::string const&)> print;
+    /// Receives the exit code when the guest writes EXIT.
+    std::function<void(uint16_t)> exit;
+
+private:
+    std::span<AllocUnit> memory;
+    Address memory_begin {0};
+    ///! Marks the pages of memory written, nullptr if nothing tracks them.
+    DirtyPages* dirty {nullptr};
+
+    std::array<uint16_t, 4> arguments {};
+    std::array<uint16_t, 4> results {};
+    Status status {Status::Ok};
+
+    /// The memory at [address, address + count), an empty span with status set if it is not within memory.
+    std::span<AllocUnit> range(uint16_t address, size_t count) {
+        if (address < memory_begin || address - memory_begin + count > memory.size()) {
+            status = Status::InvalidAddress;
+            return {};
+        }
+        return memory.subspan(address - memory_begin, count);
+    }
+
+    [[nodiscard]] uint32_t argument32(size_t index) const {
+        return (uint32_t{arguments[index]} << 16) | arguments[index + 1];
+    }
+
+    void set_result32(size_t index, uint32_t value) {
+        results[index] = value >> 16;
+        results[index + 1] = value & 0xFFFF;
+    }
+
+    void perform(Op operation) {
+        // Reading OPERATION writes 0 back, which must not reset the status.
+        if (operation == Op::None) return;
+        status = Status::Ok;
+        switch (operation) {
+            case Op::MemCpy: {
+                auto const destination = range(arguments[0], arguments[2]);
+                auto const source = range(arguments[1], arguments[2]);
+                if (status != Status::Ok) break;
+                if (destination.data() < source.data()) std::copy(source.begin(), source.end(), destination.begin());
+                else std::copy_backward(source.begin(), source.end(), destination.end());
+                if (dirty) dirty->mark(destination);
+            } break;
+            case Op::MemSet: {
+                auto const destination = range(arguments[0], arguments[2]);
+                if (status != Status::Ok) break;
+                std::fill(destination.begin(), destination.end(), static_cast<AllocUnit>(arguments[1]));
+                if (dirty) dirty->mark(destination);
+            } break;
+            case Op::MemCmp: {
+                auto const a = range(arguments[0], arguments[2]);
+                auto const b = range(arguments[1], arguments[2]);
+                if (status != Status::Ok) break;
+                auto const [left, right] = std::mismatch(a.begin(), a.end(), b.begin());
+                results[0] = left == a.end() ? 0 : (*left < *right ? static_cast<uint16_t>(-1) : 1);
+            } break;
+            case Op::Print: {
+                if (arguments[0] < memory_begin || arguments[0] - memory_begin >= memory.size()) {
+                    status = Status::InvalidAddress;
+                    break;
+                }
+                auto const available = memory.size() - (arguments[0] - memory_begin);
+                auto const limit = arguments[1] == 0 ? available : std::min<size_t>(available, arguments[1]);
+                auto const text = memory.subspan(arguments[0] - memory_begin, limit);
+                std::string string;
+                for (auto const unit : text) {
+                    if (unit == 0) break;
+                    string.push_back(static_cast<char>(unit));
+                }
+                if (print) print(string);
+            } break;
+            case Op::Mul32:
+                set_result32(0, argument32(0) * argument32(2));
+                break;
+            case Op::Div32: {
+                auto const divisor = argument32(2);
+                if (divisor == 0) {
+                    status = Status::DivisionByZero;
+                    break;
+                }
+                set_result32(0, argument32(0) / divisor);
+                set_result32(2, argument32(0) % divisor);
+            } break;
+            default:
+                status = Status::InvalidOperation;
+                break;
+        }
+    }
+
+public:
+    /**
+     * Let the operations access plain memory mapped at the given address
+     */
+    void attach_memory(std::span<AllocUnit> buffer, Address begin) {
+        memory = buffer;
+        memory_begin = begin;
+    }
+
+    /// Mark the pages of memory written from now on in the tracker, nullptr stops marking.
+    void set_dirty_pages(DirtyPages* pages) {
+        dirty = pages;
+    }
+
+    struct State {
+        std::array<uint16_t, 4> arguments;
+        std::array<uint16_t, 4> results;
+        Status status;
+    };
+
+    [[nodiscard]] State save_state() const {
+        return {arguments, results, status};
+    }
+
+    void restore_state(State const& state) {
+        arguments = state.arguments;
+        results = state.results;
+        status = state.status;
+    }
+
+    void simulate() override {
+        if (this->get_bus_mode() == RW::Read ||
+            this->get_bus_mode() == RW::Write) {
+            if (this->get_bus_address() >= Begin &&
+                this->get_bus_address() <= End) {
+                auto const offset = static_cast<Address>(this->get_bus_address() - Begin);
+
+                if (this->get_bus_mode() == RW::Read) {
+                    if (offset >= Argument0 && offset < Result0) this->set_bus_data(arguments[offset - Argument0]);
+                    else if (offset >= Result0 && offset < StatusRegister) this->set_bus_data(results[offset - Result0]);
+                    else if (offset == StatusRegister) this->set_bus_data(static_cast<uint16_t>(status));
+                    else if (offset == Exit) this->set_bus_data(static_cast<uint16_t>(-1));
+                    else this->set_bus_data(0);
+                } else {
+                    if (offset == Operation) perform(static_cast<Op>(this->get_bus_data()));
+                    else if (offset >= Argument0 && offset < Result0) arguments[offset - Argument0] = this->get_bus_data();
+                    else if (offset == Exit && this->get_bus_data() != static_cast<uint16_t>(-1) && exit) exit(this->get_bus_data());
+                }
+            }
+        }
+    }
+};
+
+
+#endif //CS8_HOST_CALL_HXX
@@ -0,0 +1,213 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_INTERRUPT_CONTROLLER_HXX
+#define CS8_INTERRUPT_CONTROLLER_HXX
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "bus.hxx"
+#include "device.hxx"
+#include "interrupt_line.hxx"
+#include "scheduler.hxx"
+
+/**
+ * A timer and an interrupt controller for up to eight sources.
+ *
+ * Registers, relative to Begin:
+ *  - 0 CONTROL   bit 0 enables the timer, bit 1 reloads it after it fired, bit 15 enables interrupts
+ *  - 1 PERIOD    timer ticks between two interrupts, read when the timer is (re)loaded
+ *  - 2 PRESCALE  a timer tick lasts 2^PRESCALE cycles
+ *  - 3 COUNT     ticks until the timer fires, 0 once a one-shot timer fired or while it is stopped, read only
+ *  - 4 PENDING   one bit per source, read only
+ *  - 5 ACK       writing a one clears the pending bit, reads as 0
+ *  - 6 ENABLE    one bit per source
+ *  - 7 RAISE     writing a one sets the pending bit, reads as 0
+ *  - 8..15       the handler address of every source
+ *
+ * The CPU writes the value back after every read, so every register tolerates writing the value it just returned.
+ * That is why only the guest changes CONTROL: a one-shot timer which fired keeps bit 0 set, COUNT reads 0 and the
+ * pending bit of the timer tells it fired. Clearing and setting bit 0 again starts it anew.
+ * The timer is source 0 and the DMA controller source 1, the lowest pending and enabled source is requested first.
+ */
+template<size_t Size, typename AllocUnit, typename Address, Address Begin, Address End, size_t ID, BusLike<AllocUnit, Address> Bus>
+class InterruptController : public Device, public BusDevice<AllocUnit, Address, ID, Bus>, public InterruptSink {
+public:
+    using AllocationUnit = AllocUnit;
+    static constexpr Address AddressBegin = Begin;
+    static constexpr Address AddressEnd = End;
+    static constexpr size_t DeviceID = ID;
+
+    static constexpr size_t sources = 8;
+    static constexpr size_t timer_source = 0;
+
+    enum Register : Address {
+        Control = 0, Period = 1, Prescale = 2, Count = 3, Pending = 4, Ack = 5, Enable = 6, Raise = 7, Vector0 = 8
+    };
+
+    static constexpr uint16_t control_timer_enable = 1u << 0;
+    static constexpr uint16_t control_periodic = 1u << 1;
+    static constexpr uint16_t control_interrupt_enable = 1u << 15;
+
+private:
+    EventCalendar* calendar {nullptr};
+    InterruptLine* line {nullptr};
+
+    uint16_t control {0};
+    uint16_t period {0};
+    uint16_t prescale {0};
+    uint16_t pending {0};
+    uint16_t enable {0};
+    std::array<uint16_t, sources> vectors {};
+
+    ///! The time the timer fires, EventCalendar::never if it is stopped or a one-shot timer fired.
+    uint64_t deadline {EventCalendar::never};
+
+    void arm(uint64_t from) {
+        if (period == 0) {
+            stop();
+            return;
+        }
+        deadline = from + (uint64_t{period} << prescale);
+        calendar->schedule(*this, deadline);
+    }
+
+    void stop() {
+        deadline = EventCalendar::never;
+        calendar->cancel(*this);
+    }
+
+    void update() {
+        if (!line) return;
+        uint16_t const active = pending & enable;
+        if ((control & control_interrupt_enable) && active) {
+            line->set_interrupt_request(vectors[std::countr_zero(active)]);
+        } else {
+            line->set_interrupt_request(std::nullopt);
+        }
+    }
+
+    [[nodiscard]] uint16_t read(Address offset) const {
+        switch (offset) {
+            case Control: return control;
+            case Period: return period;
+            case Prescale: return prescale;
+            case Count:
+                return deadline == EventCalendar::never ? 0 : static_cast<uint16_t>((deadline - calendar->now()) >> prescale);
+            case Pending: return pending;
+            case Enable: return enable;
+            case Ack:
+            case Raise: return 0;
+            default: return vectors[offset - Vector0];
+        }
+    }
+
+    void write(Address offset, uint16_t value) {
+        switch (offset) {
+            case Control: {
+                bool const was_enabled = control & control_timer_enable;
+                control = value;
+                if (!was_enabled && (control & control_timer_enable)) arm(calendar->now());
+                else if (was_enabled && !(control & control_timer_enable)) stop();
+            } break;
+            case Period: period = value; break;
+            case Prescale: prescale = value & 0x0F; break;
+            case Pending:
+            case Count: break;
+            case Ack: pending &= ~value; break;
+            case Enable: enable = value; break;
+            case Raise: pending |= value; break;
+            default: vectors[offset - Vector0] = value; break;
+        }
+        update();
+    }
+
+public:
+    /**
+     * Connect the controller, the timer uses the calendar and requests go to the line
+     */
+    void attach(EventCalendar& event_calendar, InterruptLine& interrupt_line) {
+        calendar = &event_calendar;
+        line = &interrupt_line;
+    }
+
+    /// The registers and the timer, the calendar keeps the timer event.
+    struct State {
+        uint16_t control;
+        uint16_t period;
+        uint16_t prescale;
+        uint16_t pending;
+        uint16_t enable;
+        std::array<uint16_t, sources> vectors;
+        uint64_t deadline;
+    };
+
+    [[nodiscard]] State save_state() const {
+        return {control, period, prescale, pending, enable, vectors, deadline};
+    }
+
+    void restore_state(State const& state) {
+        control = state.control;
+        period = state.period;
+        prescale = state.prescale;
+        pending = state.pending;
+        enable = state.enable;
+        vectors = state.vectors;
+        deadline = state.deadline;
+        update();
+    }
+
+    /**
+     * Set the handler address of a source, used by the loader
+     */
+    void set_vector(size_t source, uint16_t handler) {
+        if (source >= sources) throw std::out_of_range("Invalid interrupt source: " + std::to_string(source));
+        vectors[source] = handler;
+    }
+
+    /**
+     * Mark a source as pending, used by other devices
+     */
+    void raise(size_t source) override {
+        pending |= 1u << source;
+        update();
+    }
+
+    void simulate() override {
+        if (this->get_bus_mode() == RW::Read ||
+            this->get_bus_mode() == RW::Write) {
+            if (this->get_bus_address() >= Begin &&
+                this->get_bus_address() <= End) {
+                auto const offset = static_cast<Address>(this->get_bus_address() - Begin);
+
+                if (this->get_bus_mode() == RW::Read) {
+                    this->set_bus_data(read(offset));
+                } else {
+                    write(offset, this->get_bus_data());
+                }
+            }
+        }
+    }
+
+    /// COUNT runs down with time, the timer only has an event when it fires.
+    bool stable_read(uint16_t address) const override {
+        return address != Begin + Count;
+    }
+
+    void on_event(uint64_t time) override {
+        pending |= 1u << timer_source;
+        if (control & control_periodic) {
+            arm(deadline);
+        } else {
+            deadline = EventCalendar::never;
+        }
+        update();
+    }
+};
+
+
+#endif //CS8_INTERRUPT_CONTROLLER_HXX
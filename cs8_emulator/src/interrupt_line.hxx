@@ -0,0 +1,37 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_INTERRUPT_LINE_HXX
+#define CS8_INTERRUPT_LINE_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/**
+ * The CPU side of the connection to an interrupt controller.
+ */
+struct InterruptLine {
+    virtual ~InterruptLine() = default;
+
+    /**
+     * Request an interrupt
+     * @param vector the address of the handler, std::nullopt withdraws the request
+     */
+    virtual void set_interrupt_request(std::optional<uint16_t> vector) = 0;
+};
+
+/**
+ * The device side of the connection to an interrupt controller.
+ */
+struct InterruptSink {
+    virtual ~InterruptSink() = default;
+
+    /**
+     * Mark a source as pending
+     */
+    virtual void raise(size_t source) = 0;
+};
+
+#endif //CS8_INTERRUPT_LINE_HXX
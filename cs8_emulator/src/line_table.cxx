@@ -0,0 +1,43 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "line_table.hxx"
+#include <elfio/elfio.hpp>
+#include <cstring>
+#include <stdexcept>
+
+LineTable::LineTable(std::filesystem::path const& file) {
+    ELFIO::elfio reader;
+    if (!reader.load(file)) throw std::runtime_error("Cannot load " + file.string());
+
+    for (auto const section : reader.sections) {
+        if (section->get_name() != "cs8.lines") continue;
+
+        auto const* const data = reinterpret_cast<uint8_t const*>(section->get_data());
+        size_t const size = data ? section->get_size() : 0;
+        size_t offset = 0;
+        auto const read = [&](size_t bytes) {
+            if (size - offset < bytes) throw std::runtime_error("Truncated line table in " + file.string());
+            uint32_t value = 0;
+            for (size_t i = 0; i < bytes; ++i) value = value << 8 | data[offset++];
+            return value;
+        };
+
+        auto const file_count = read(2);
+        for (uint32_t i = 0; i < file_count; ++i) {
+            auto const* const name = reinterpret_cast<char const*>(data + offset);
+            auto const length = strnlen(name, size - offset);
+            if (length == size - offset) throw std::runtime_error("Truncated line table in " + file.string());
+            files.emplace_back(name, length);
+            offset += length + 1;
+        }
+        while (offset < size) {
+            auto const address = static_cast<uint16_t>(read(2));
+            auto const index = static_cast<uint16_t>(read(2));
+            auto const line = read(4);
+            if (index >= files.size()) throw std::runtime_error("Bad file index in the line table of " + file.string());
+            lines.push_back({address, index, line});
+        }
+    }
+}
@@ -0,0 +1,50 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_LINE_TABLE_HXX
+#define CS8_LINE_TABLE_HXX
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * The source line of every instruction of a program, read from the cs8.lines section of its elf file.
+ *
+ * The assembler writes the section big endian: the file count (u16) and the zero terminated absolute file names,
+ * then per instruction its address (u16), file index (u16) and line (u32). Instructions expanded from a macro
+ * have the line of the outermost macro invocation.
+ */
+class LineTable {
+public:
+    struct Line {
+        uint16_t address;
+        uint16_t file;
+        uint32_t line;
+    };
+
+private:
+    std::vector<std::string> files;
+    ///! In the order the assembler emitted the instructions.
+    std::vector<Line> lines;
+
+public:
+    /**
+     * Read the line table of the given elf file, a file without one has an empty table
+     * @throws std::runtime_error when the file cannot be loaded or the table is truncated
+     */
+    explicit LineTable(std::filesystem::path const& file);
+
+    [[nodiscard]] std::vector<std::string> const& get_files() const {
+        return files;
+    }
+
+    [[nodiscard]] std::vector<Line> const& get_lines() const {
+        return lines;
+    }
+};
+
+
+#endif //CS8_LINE_TABLE_HXX
@@ -0,0 +1,210 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "lockstep.hxx"
+#include "trace_format.hxx"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+namespace lockstep {
+    namespace {
+        constexpr std::string_view magic {"CS8LOCK\0", 8};
+        constexpr uint32_t version = 1;
+        constexpr char step_kind = 'S';
+        constexpr char end_kind = 'E';
+        constexpr uint8_t interrupt_flag = 1;
+        constexpr uint8_t store_flag = 2;
+        ///! Memory is compared in chunks of this many words, only differing chunks word by word.
+        constexpr size_t chunk_words = 64;
+
+        void put_bytes(std::ostream& output, std::vector<uint8_t> const& bytes) {
+            output.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        void get_bytes(std::istream& input, std::vector<uint8_t>& bytes, size_t size) {
+            bytes.resize(size);
+            if (!input.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(size))) {
+                throw std::runtime_error("Truncated lockstep stream");
+            }
+        }
+
+        bool is_store(uint8_t opcode) {
+            switch (opcode & 0x0F) {
+                case 0x2: case 0x4: case 0x6: case 0x7: return true;
+                default: return false;
+            }
+        }
+    }
+
+    const char* to_string(End end) {
+        switch (end) {
+            case End::Halted: return "halted";
+            case End::Idle: return "idle";
+            case End::InstructionLimit: return "instruction limit";
+        }
+        return "";
+    }
+
+    uint64_t digest(std::span<uint16_t const> words) {
+        uint64_t hash = 0xCBF29CE484222325;
+        for (auto word : words) {
+            for (auto byte : {word & 0xFF, word >> 8}) {
+                hash ^= static_cast<uint64_t>(byte);
+                hash *= 0x100000001B3;
+            }
+        }
+        return hash;
+    }
+
+    Recorder::Recorder(Emulator& emulator)
+    : emulator{emulator}, previous(emulator.memory().begin(), emulator.memory().end()) {
+        emulator.machine().cpu->set_observer(this);
+    }
+
+    Recorder::~Recorder() {
+        emulator.machine().cpu->set_observer(nullptr);
+    }
+
+    std::variant<Step, End> Recorder::step() {
+        reads.clear();
+        interrupt.reset();
+        last_write.reset();
+        retired.reset();
+
+        auto const reason = emulator.run_instructions(1);
+        if (!retired) {
+            if (reason == Emulator::StopReason::Halted) return End::Halted;
+            if (reason == Emulator::StopReason::Idle) return End::Idle;
+            throw std::logic_error("The emulator stopped without retiring an instruction");
+        }
+
+        auto step = std::move(*retired);
+        step.cycles = emulator.cycles();
+        step.interrupt = interrupt;
+        auto const memory = emulator.memory();
+        for (size_t chunk = 0; chunk < memory.size(); chunk += chunk_words) {
+            auto const words = std::min(chunk_words, memory.size() - chunk);
+            if (std::memcmp(&memory[chunk], &previous[chunk], words * sizeof(uint16_t)) == 0) continue;
+            for (auto address = chunk; address < chunk + words; ++address) {
+                if (memory[address] == previous[address]) continue;
+                step.memory.push_back({static_cast<uint16_t>(address), memory[address]});
+                previous[address] = memory[address];
+            }
+        }
+        return step;
+    }
+
+    void Recorder::on_retire(uint16_t address, uint8_t opcode, uint64_t, CPURegisters const& registers) {
+        retired.emplace();
+        retired->instruction = emulator.instructions();
+        retired->address = address;
+        retired->registers = registers;
+        if (is_store(opcode)) retired->store = last_write;
+    }
+
+    void Recorder::on_bus(RW mode, uint16_t address, uint16_t data) {
+        if (mode == RW::Read) reads.push_back({address, data});
+        else last_write = Word{address, data};
+    }
+
+    void Recorder::on_interrupt(uint16_t handler) {
+        interrupt = handler;
+    }
+
+    StreamWriter::StreamWriter(std::ostream& output, std::span<uint16_t const> memory) : output{output} {
+        buffer.assign(magic.begin(), magic.end());
+        trace_format::put_le(buffer, version);
+        trace_format::put_le(buffer, static_cast<uint32_t>(memory.size()));
+        for (auto word : memory) trace_format::put_le(buffer, word);
+        put_bytes(output, buffer);
+    }
+
+    void StreamWriter::put_record(char kind) {
+        std::vector<uint8_t> header {static_cast<uint8_t>(kind)};
+        trace_format::put_le(header, static_cast<uint32_t>(buffer.size()));
+        put_bytes(output, header);
+        put_bytes(output, buffer);
+        if (!output) throw std::runtime_error("Cannot write the lockstep stream");
+    }
+
+    void StreamWriter::write(Step const& step) {
+        buffer.clear();
+        trace_format::put_varint(buffer, step.instruction);
+        trace_format::put_varint(buffer, step.cycles);
+        trace_format::put_le(buffer, step.address);
+        trace_format::put_le(buffer, static_cast<uint8_t>((step.interrupt ? interrupt_flag : 0) |
+                                                          (step.store ? store_flag : 0)));
+        if (step.interrupt) trace_format::put_le(buffer, *step.interrupt);
+        if (step.store) {
+            trace_format::put_le(buffer, step.store->address);
+            trace_format::put_le(buffer, step.store->data);
+        }
+        for (auto value : step.registers.values) trace_format::put_le(buffer, static_cast<uint16_t>(value));
+        trace_format::put_varint(buffer, step.memory.size());
+        for (auto const& word : step.memory) {
+            trace_format::put_le(buffer, word.address);
+            trace_format::put_le(buffer, word.data);
+        }
+        put_record(step_kind);
+    }
+
+    void StreamWriter::finish(End end, uint64_t banks_digest) {
+        buffer.clear();
+        trace_format::put_le(buffer, static_cast<uint8_t>(end));
+        trace_format::put_le(buffer, banks_digest);
+        put_record(end_kind);
+        output.flush();
+    }
+
+    StreamReader::StreamReader(std::istream& input) : input{input} {
+        get_bytes(input, buffer, magic.size() + 8);
+        if (!std::equal(magic.begin(), magic.end(), buffer.begin())) throw std::runtime_error("Not a lockstep stream");
+        trace_format::Cursor header(buffer.data() + magic.size(), buffer.data() + buffer.size());
+        if (header.le<uint32_t>() != version) throw std::runtime_error("Unsupported lockstep stream version");
+        auto const words = header.le<uint32_t>();
+        if (words > 0x10000) throw std::runtime_error("Invalid lockstep memory size");
+
+        get_bytes(input, buffer, size_t{words} * sizeof(uint16_t));
+        trace_format::Cursor contents(buffer.data(), buffer.data() + buffer.size());
+        initial_memory.resize(words);
+        for (auto& word : initial_memory) word = contents.le<uint16_t>();
+    }
+
+    std::variant<Step, std::pair<End, uint64_t>> StreamReader::read() {
+        get_bytes(input, buffer, 5);
+        auto const kind = static_cast<char>(buffer[0]);
+        trace_format::Cursor header(buffer.data() + 1, buffer.data() + buffer.size());
+        get_bytes(input, buffer, header.le<uint32_t>());
+        trace_format::Cursor payload(buffer.data(), buffer.data() + buffer.size());
+
+        if (kind == end_kind) {
+            auto const end = payload.le<uint8_t>();
+            if (end > static_cast<uint8_t>(End::InstructionLimit)) throw std::runtime_error("Invalid lockstep end");
+            return std::pair{static_cast<End>(end), payload.le<uint64_t>()};
+        }
+        if (kind != step_kind) throw std::runtime_error("Invalid lockstep record");
+
+        Step step;
+        step.instruction = payload.varint();
+        step.cycles = payload.varint();
+        step.address = payload.le<uint16_t>();
+        auto const flags = payload.le<uint8_t>();
+        if (flags & interrupt_flag) step.interrupt = payload.le<uint16_t>();
+        if (flags & store_flag) {
+            auto const address = payload.le<uint16_t>();
+            step.store = Word{address, payload.le<uint16_t>()};
+        }
+        for (auto& value : step.registers.values) value = static_cast<int16_t>(payload.le<uint16_t>());
+        auto const changed = payload.varint();
+        if (changed > initial_memory.size()) throw std::runtime_error("Invalid lockstep step");
+        step.memory.resize(changed);
+        for (auto& word : step.memory) {
+            word.address = payload.le<uint16_t>();
+            word.data = payload.le<uint16_t>();
+        }
+        return step;
+    }
+}
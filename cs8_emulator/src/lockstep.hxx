@@ -0,0 +1,160 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_LOCKSTEP_HXX
+#define CS8_LOCKSTEP_HXX
+
+#include "cpu_observer.hxx"
+#include "cs8emu.hxx"
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/**
+ * The architectural state after every retired instruction, to run two execution paths side by side and find the first
+ * instruction they disagree at.
+ *
+ * A step holds what an instruction did: the registers after it, the handler the CPU entered before it, the word
+ * it stored and the words of memory which changed while it ran. Memory changed by devices in the meantime counts for
+ * the instruction as well. The banks of the MMU are too large to compare per instruction, they only change through
+ * stores to the windows or DMA and are compared by a digest at the end.
+ *
+ * Steps travel between two builds as a stream, so a pipe runs them in lockstep:
+ *
+ *     header:  magic "CS8LOCK\0", u32 version, u32 memory words, the memory at the start as u16 words
+ *     record:  u8 kind, u32 payload size, payload
+ *     step:    kind 'S', varint instruction count, varint cycles, u16 address, u8 flags (1 interrupt, 2 store),
+ *              [u16 handler], [u16 store address, u16 store data], the registers as u16, varint changed words,
+ *              per word u16 address and u16 data
+ *     end:     kind 'E', u8 end reason, u64 digest of the MMU banks
+ *
+ * Integers are little endian, varints as in the trace format.
+ */
+namespace lockstep {
+    struct Word {
+        uint16_t address {0};
+        uint16_t data {0};
+
+        bool operator==(Word const&) const = default;
+    };
+
+    struct Step {
+        ///! The number of instructions retired with this one.
+        uint64_t instruction {0};
+        ///! The cycles since the start, 0 for execution paths without timing.
+        uint64_t cycles {0};
+        uint16_t address {0};
+        ///! The handler entered before the instruction.
+        std::optional<uint16_t> interrupt;
+        ///! The word stored by sdir, sidx, psh0 or psh1.
+        std::optional<Word> store;
+        CPURegisters registers;
+        ///! The words of memory which changed, by address.
+        std::vector<Word> memory;
+    };
+
+    enum class End : uint8_t {
+        Halted, Idle, InstructionLimit
+    };
+
+    [[nodiscard]] const char* to_string(End end);
+
+    /// The FNV-1a digest of the words.
+    [[nodiscard]] uint64_t digest(std::span<uint16_t const> words);
+
+    /**
+     * Steps an emulator one instruction at a time and tells what each instruction did.
+     * It is the observer of the CPU while it exists.
+     */
+    class Recorder : public CPUObserver {
+        Emulator& emulator;
+        ///! Memory after the last step.
+        std::vector<uint16_t> previous;
+        std::optional<uint16_t> interrupt;
+        ///! The last bus write of the CPU, every instruction ends with one.
+        std::optional<Word> last_write;
+        std::vector<Word> reads;
+        std::optional<Step> retired;
+
+    public:
+        explicit Recorder(Emulator& emulator);
+        ~Recorder() override;
+
+        Recorder(Recorder const&) = delete;
+        Recorder& operator=(Recorder const&) = delete;
+
+        /**
+         * Retire the next instruction
+         * @return the step, or why the emulator ended without retiring one
+         */
+        [[nodiscard]] std::variant<Step, End> step();
+
+        /// The bus reads of the CPU during the last step, instruction fetches included, in order.
+        [[nodiscard]] std::vector<Word> const& get_reads() const {
+            return reads;
+        }
+
+        /// The memory after the last step.
+        [[nodiscard]] std::span<uint16_t const> memory() const {
+            return previous;
+        }
+
+        void on_retire(uint16_t address, uint8_t opcode, uint64_t cycles, CPURegisters const& registers) override;
+        void on_bus(RW mode, uint16_t address, uint16_t data) override;
+        void on_interrupt(uint16_t handler) override;
+    };
+
+    /**
+     * Writes steps to a stream.
+     */
+    class StreamWriter {
+        std::ostream& output;
+        std::vector<uint8_t> buffer;
+
+        void put_record(char kind);
+
+    public:
+        /// Write the header with the memory at the start.
+        StreamWriter(std::ostream& output, std::span<uint16_t const> memory);
+
+        void write(Step const& step);
+        /// Write the end record and flush.
+        void finish(End end, uint64_t banks_digest);
+    };
+
+    /**
+     * Reads the steps written by a StreamWriter, one record at a time.
+     */
+    class StreamReader {
+        std::istream& input;
+        std::vector<uint16_t> initial_memory;
+        std::vector<uint8_t> buffer;
+
+    public:
+        /**
+         * Read the header
+         * @throw std::runtime_error if the stream is no lockstep stream
+         */
+        explicit StreamReader(std::istream& input);
+
+        /// The memory at the start.
+        [[nodiscard]] std::span<uint16_t const> memory() const {
+            return initial_memory;
+        }
+
+        /**
+         * Read the next record
+         * @return the next step, or the end with the digest of the MMU banks
+         * @throw std::runtime_error if the stream is truncated or damaged
+         */
+        [[nodiscard]] std::variant<Step, std::pair<End, uint64_t>> read();
+    };
+}
+
+#endif //CS8_LOCKSTEP_HXX
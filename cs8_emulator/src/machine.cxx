@@ -0,0 +1,90 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "machine.hxx"
+#include <algorithm>
+#include <functional>
+
+void initialize_memory(ProgramImage const& program, EmulatedMemory::BufferType& buffer) {
+    program.load(std::span<EmulatedMemory::AllocationUnit>(buffer), EmulatedMemory::AddressBegin);
+}
+
+void initialize_interrupt_vectors(ProgramImage const& program, EmulatedInterruptController& controller) {
+    for (auto const& vector : program.get_vectors()) {
+        controller.set_vector(vector.source, vector.handler);
+    }
+}
+
+std::shared_ptr<PageImage const> load_memory_image(ProgramImage const& program) {
+    EmulatedMemory memory;
+    memory.modify(std::bind_front(initialize_memory, std::cref(program)));
+    return memory.snapshot();
+}
+
+Machine::Machine(std::filesystem::path const& program_file) : Machine(ProgramImage(program_file)) {}
+
+Machine::Machine(ProgramImage const& program) {
+    memory->modify(std::bind_front(initialize_memory, std::cref(program)));
+    connect(program);
+}
+
+Machine::Machine(ProgramImage const& program, std::shared_ptr<PageImage const> memory_image) {
+    memory->load(std::move(memory_image));
+    connect(program);
+}
+
+void Machine::connect(ProgramImage const& program) {
+    initialize_interrupt_vectors(program, *interrupt_controller);
+    interrupt_controller->attach(scheduler, *cpu);
+    dma_controller->attach(scheduler, scheduler, interrupt_controller.get(), DMA_INTERRUPT_SOURCE);
+    mmu->attach(interrupt_controller.get(), MMU_INTERRUPT_SOURCE);
+    memory->modify([this](EmulatedMemory::BufferType& buffer) {
+        dma_controller->attach_memory(buffer, EmulatedMemory::AddressBegin);
+        host_call->attach_memory(buffer, EmulatedMemory::AddressBegin);
+        block_device->attach_memory(buffer, EmulatedMemory::AddressBegin);
+    });
+    host_call->print = [this](std::string const& string) { serial_port->write_string(string); };
+    host_call->exit = [this](uint16_t code) {
+        exit_code = code;
+        cpu->halt();
+    };
+
+    scheduler.map(memory, EmulatedMemory::AddressBegin, EmulatedMemory::AddressEnd);
+    scheduler.map(serial_port, EmulatedSerialPort::AddressBegin, EmulatedSerialPort::AddressEnd);
+    scheduler.map(interrupt_controller, EmulatedInterruptController::AddressBegin, EmulatedInterruptController::AddressEnd);
+    scheduler.map(dma_controller, EmulatedDMAController::AddressBegin, EmulatedDMAController::AddressEnd);
+    scheduler.map(host_call, EmulatedHostCall::AddressBegin, EmulatedHostCall::AddressEnd);
+    scheduler.map(block_device, EmulatedBlockDevice::AddressBegin, EmulatedBlockDevice::AddressEnd);
+    scheduler.map(mmu, EmulatedMMU::AddressBegin, EmulatedMMU::AddressEnd);
+    scheduler.map(mmu, EmulatedMMU::window_begin, EmulatedMMU::window_end);
+    scheduler.init();
+
+    connect_bus(bus, *cpu);
+    connect_bus(bus, *memory);
+    connect_bus(bus, *serial_port);
+    connect_bus(bus, *interrupt_controller);
+    connect_bus(bus, *dma_controller);
+    connect_bus(bus, *host_call);
+    connect_bus(bus, *block_device);
+    connect_bus(bus, *mmu);
+}
+
+Machine::State Machine::save_state() const {
+    return {cpu->save_state(), scheduler.save_state(), serial_port->save_state(), interrupt_controller->save_state(),
+            dma_controller->save_state(), host_call->save_state(), block_device->save_state(), mmu->save_state(),
+            exit_code};
+}
+
+void Machine::restore_state(State const& state) {
+    scheduler.restore_state(state.scheduler);
+    serial_port->restore_state(state.serial_port);
+    dma_controller->restore_state(state.dma_controller);
+    host_call->restore_state(state.host_call);
+    block_device->restore_state(state.block_device);
+    mmu->restore_state(state.mmu);
+    interrupt_controller->restore_state(state.interrupt_controller);
+    // The controller passes its request to the CPU while restoring, the saved CPU state already has it.
+    cpu->restore_state(state.cpu);
+    exit_code = state.exit_code;
+}
@@ -0,0 +1,156 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_MACHINE_HXX
+#define CS8_MACHINE_HXX
+
+#include "block_device.hxx"
+#include "bus.hxx"
+#include "cpu.hxx"
+#include "dma_controller.hxx"
+#include "host_call.hxx"
+#include "interrupt_controller.hxx"
+#include "memory.hxx"
+#include "mmu.hxx"
+#include "program_image.hxx"
+#include "scheduler.hxx"
+#include "serial_port.hxx"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+using BusType = Bus<bus_size_16, bus_size_16>;
+using CPUType = CPU<BusType::DataType, BusType::AddressType, BusType>;
+using EmulatedMemory = Memory<0x1FFF, BusType::DataType, BusType::AddressType, 0x0000, 0x1FFF, 0xA0, BusType>;
+using EmulatedSerialPort = SerialPort<0x1FFF, BusType::DataType, BusType::AddressType, 0x2000, 0x2001, 0xA1, BusType>;
+using EmulatedInterruptController = InterruptController<0x10, BusType::DataType, BusType::AddressType, 0x2010, 0x201F, 0xA2, BusType>;
+using EmulatedDMAController = DMAController<0x10, BusType::DataType, BusType::AddressType, 0x2020, 0x202F, 0xA3, BusType>;
+using EmulatedHostCall = HostCall<0x10, BusType::DataType, BusType::AddressType, 0x2030, 0x203F, 0xA4, BusType>;
+using EmulatedBlockDevice = BlockDevice<0x10, BusType::DataType, BusType::AddressType, 0x2040, 0x204F, 0xA6, BusType>;
+using EmulatedMMU = MemoryManagementUnit<0x10, BusType::DataType, BusType::AddressType, 0x2050, 0x205F, 0xA7, BusType>;
+
+///! The interrupt source of DMA completions.
+constexpr size_t DMA_INTERRUPT_SOURCE = 1;
+///! The interrupt source of MMU faults.
+constexpr size_t MMU_INTERRUPT_SOURCE = 2;
+
+/**
+ * Load the program into memory
+ * @param program a mapped elf file or flat image
+ * @param buffer the targeted memory
+ */
+void initialize_memory(ProgramImage const& program, EmulatedMemory::BufferType& buffer);
+
+/**
+ * Load the program into a memory image, machines built from the same image share its pages
+ * @param program a mapped elf file or flat image
+ */
+std::shared_ptr<PageImage const> load_memory_image(ProgramImage const& program);
+
+/**
+ * Set the handler addresses written for .vector directives
+ * @param program a mapped elf file or flat image
+ * @param controller the interrupt controller receiving the vectors
+ */
+void initialize_interrupt_vectors(ProgramImage const& program, EmulatedInterruptController& controller);
+
+/**
+ * The CS8 machine: a CPU, memory, a serial port, an interrupt controller, a DMA controller, the host call device, a
+ * block device and an MMU with banked memory connected to one bus.
+ */
+struct Machine {
+    std::shared_ptr<BusType> bus = std::make_shared<BusType>();
+    std::shared_ptr<CPUType> cpu = std::make_shared<CPUType>();
+    std::shared_ptr<EmulatedMemory> memory = std::make_shared<EmulatedMemory>();
+    std::shared_ptr<EmulatedSerialPort> serial_port = std::make_shared<EmulatedSerialPort>();
+    std::shared_ptr<EmulatedInterruptController> interrupt_controller = std::make_shared<EmulatedInterruptController>();
+    std::shared_ptr<EmulatedDMAController> dma_controller = std::make_shared<EmulatedDMAController>();
+    std::shared_ptr<EmulatedHostCall> host_call = std::make_shared<EmulatedHostCall>();
+    std::shared_ptr<EmulatedBlockDevice> block_device = std::make_shared<EmulatedBlockDevice>();
+    std::shared_ptr<EmulatedMMU> mmu = std::make_shared<EmulatedMMU>();
+
+    Scheduler<BusType, CPUType> scheduler {bus, cpu};
+
+    ///! The value the guest wrote to the EXIT register of the host call device, the CPU halts then.
+    std::optional<uint16_t> exit_code;
+
+    /**
+     * Build the machine and load the program into memory
+     * @param program_file a path to an elf file or flat image
+     */
+    explicit Machine(std::filesystem::path const& program_file);
+
+    /**
+     * Build the machine and load the program into memory
+     * @param program a mapped elf file or flat image
+     */
+    explicit Machine(ProgramImage const& program);
+
+    /**
+     * Build the machine with memory sharing the pages of an image of the program
+     * @param program the program, for the parts of it not in memory
+     * @param memory_image the memory of the program, see load_memory_image
+     */
+    Machine(ProgramImage const& program, std::shared_ptr<PageImage const> memory_image);
+
+    /**
+     * Simulate until the CPU halts
+     */
+    void run() {
+        scheduler.run();
+        halted();
+    }
+
+    /**
+     * Simulate until the CPU halts, calling f after every period cycles and once at the end
+     */
+    template<typename F>
+    void run(uint64_t period, F&& f) {
+        while (cpu->is_running()) {
+            scheduler.run_until(scheduler.now() + period);
+            f();
+        }
+        halted();
+    }
+
+    /**
+     * The state of the CPU and the devices between two instructions, without the contents of memory and the banks of
+     * the MMU, without the medium of the block device
+     */
+    struct State {
+        CPUType::State cpu;
+        Scheduler<BusType, CPUType>::State scheduler;
+        EmulatedSerialPort::State serial_port;
+        EmulatedInterruptController::State interrupt_controller;
+        EmulatedDMAController::State dma_controller;
+        EmulatedHostCall::State host_call;
+        EmulatedBlockDevice::State block_device;
+        EmulatedMMU::State mmu;
+        std::optional<uint16_t> exit_code;
+    };
+
+    /**
+     * Save the state between two instructions
+     * @throw std::logic_error if the CPU is in the middle of an instruction
+     */
+    [[nodiscard]] State save_state() const;
+
+    /// Continue from a saved state.
+    void restore_state(State const& state);
+
+    /**
+     * Finish the work devices batched up while the CPU was running
+     */
+    void halted() {
+        block_device->flush();
+    }
+
+private:
+    /// Set up the devices and connect them to the bus.
+    void connect(ProgramImage const& program);
+};
+
+
+#endif //CS8_MACHINE_HXX
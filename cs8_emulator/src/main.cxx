@@ -2,67 +2,211 @@
 // Created by mkr on 7/24/21.
 //
 
-#include "devices.hxx"
-#include "bus.hxx"
-#include "cpu.hxx"
-#include "memory.hxx"
-#include "serial_port.hxx"
-#include <elfio/elfio.hpp>
+#include "coverage_map.hxx"
+#include "machine.hxx"
+#include "multi_core_machine.hxx"
+#include "profiler.hxx"
+#include "symbol_table.hxx"
+#include "telemetry.hxx"
+#include "trace_writer.hxx"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
 
-using BusType = Bus<bus_size_16, bus_size_16>;
-using CPUType = CPU<BusType::DataType, BusType::AddressType, BusType>;
-using EmulatedMemory = Memory<0x1FFF, BusType::DataType, BusType::AddressType, 0x0000, 0x1FFF, 0xA0, BusType>;
-using EmulatedSerialPort = SerialPort<0x1FFF, BusType::DataType, BusType::AddressType, 0x2000, 0x2001, 0xA1, BusType>;
-
-/**
- * Load the specified file into memory
- * @param file a path to an elf file
- * @param buffer the targeted memory
- */
-void initialize_memory(std::filesystem::path const& file, EmulatedMemory::BufferType& buffer) {
-    ELFIO::elfio reader;
-    reader.load(file);
-
-    for(auto const segment : reader.segments) {
-        if(segment->get_type() == PT_LOAD) {
-            auto const *data = segment->get_data();
-            auto const size = segment->get_memory_size();
-            auto const address = segment->get_virtual_address();
-            std::copy(data, data + size, buffer.begin() + address);
-        }
+namespace {
+    ///! The exit status of a run stopped by --max-instructions, --max-cycles or --timeout, like timeout(1).
+    constexpr int exit_out_of_budget = 124;
+
+    /**
+     * The exit status for the code the guest wrote to EXIT. A status holds 8 bits and 124 means the budget ran out,
+     * so codes above 123 become 123 and a guest failing stays distinguishable from both success and the budget.
+     */
+    int exit_status(uint16_t code) {
+        return std::min<int>(code, exit_out_of_budget - 1);
+    }
+
+    using File = std::unique_ptr<FILE, decltype(&std::fclose)>;
+
+    File open_file(std::filesystem::path const& path, const char* mode) {
+        FILE* file = std::fopen(path.c_str(), mode);
+        if (!file) throw std::runtime_error("Cannot open " + path.string());
+        return {file, &std::fclose};
     }
 }
 
 int main(int argc, const char* argv[]) {
-    if(argc < 2) return -1;
-    std::filesystem::path program_file(argv[1]);
-    std::shared_ptr<BusType> bus = std::make_shared<BusType>();
-    std::shared_ptr<CPUType> cpu =
-            std::make_shared<CPUType>();
-    std::shared_ptr<EmulatedMemory> memory =
-            std::make_shared<EmulatedMemory>();
-    std::shared_ptr<EmulatedSerialPort> serialPort = std::make_shared<EmulatedSerialPort>();
+    std::optional<std::filesystem::path> program_file;
+    std::optional<std::filesystem::path> profile_file;
+    std::optional<std::filesystem::path> trace_file;
+    std::optional<std::filesystem::path> coverage_file;
+    std::optional<std::string> telemetry_name;
+    std::optional<std::filesystem::path> disk_file;
+    MappedFile::Mode disk_mode = MappedFile::Mode::ReadOnly;
+    std::optional<size_t> bank_count;
+    size_t core_count = 1;
+    bool parallel = false;
+    std::optional<uint64_t> instruction_budget;
+    std::optional<uint64_t> cycle_budget;
+    std::optional<std::chrono::duration<double>> timeout;
+    std::optional<std::filesystem::path> input_file;
+    std::optional<std::filesystem::path> record_file;
+    std::optional<std::filesystem::path> output_file;
 
-    auto f = std::bind_front(initialize_memory, program_file);
-    memory->modify(f);
+    for (int i = 1; i < argc; ++i) {
+        std::string_view argument = argv[i];
+        if (argument == "--profile" && i + 1 < argc) {
+            profile_file = argv[++i];
+        } else if (argument == "--trace" && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (argument == "--coverage" && i + 1 < argc) {
+            coverage_file = argv[++i];
+        } else if (argument == "--telemetry" && i + 1 < argc) {
+            telemetry_name = argv[++i];
+        } else if (argument == "--cores" && i + 1 < argc) {
+            core_count = std::stoul(argv[++i]);
+        } else if (argument == "--disk" && i + 1 < argc) {
+            disk_file = argv[++i];
+        } else if (argument == "--disk-mode" && i + 1 < argc) {
+            std::string_view mode = argv[++i];
+            if (mode == "ro") disk_mode = MappedFile::Mode::ReadOnly;
+            else if (mode == "cow") disk_mode = MappedFile::Mode::CopyOnWrite;
+            else if (mode == "rw") disk_mode = MappedFile::Mode::WriteBack;
+            else return -1;
+        } else if (argument == "--banks" && i + 1 < argc) {
+            bank_count = std::stoul(argv[++i]);
+        } else if (argument == "--max-instructions" && i + 1 < argc) {
+            instruction_budget = std::stoull(argv[++i]);
+        } else if (argument == "--max-cycles" && i + 1 < argc) {
+            cycle_budget = std::stoull(argv[++i]);
+        } else if (argument == "--timeout" && i + 1 < argc) {
+            timeout = std::chrono::duration<double>(std::stod(argv[++i]));
+        } else if (argument == "--input" && i + 1 < argc) {
+            input_file = argv[++i];
+        } else if (argument == "--record-input" && i + 1 < argc) {
+            record_file = argv[++i];
+        } else if (argument == "--output" && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if (argument == "--parallel") {
+            parallel = true;
+        } else {
+            program_file = argument;
+        }
+    }
+    if(!program_file.has_value()) return -1;
 
+    MultiCoreMachine machine(*program_file, core_count, parallel);
+    if (bank_count.has_value()) {
+        for (auto& core : machine.cores) core->mmu->resize(*bank_count);
+    }
+    if (disk_file.has_value()) {
+        for (auto& core : machine.cores) core->block_device->open(*disk_file, disk_mode);
+    }
+    for (auto& core : machine.cores) {
+        if (instruction_budget.has_value()) core->cpu->instruction_budget = *instruction_budget;
+        if (cycle_budget.has_value()) core->scheduler.cycle_budget = *cycle_budget;
+    }
 
-    Devices devices;
-    devices.devices.push_front(serialPort);
-    devices.devices.push_front(memory);
-    devices.devices.push_front(cpu);
+    // Input replayed from a file is available at once, so a run reads it the same way every time.
+    File input(nullptr, &std::fclose);
+    File record(nullptr, &std::fclose);
+    File output(nullptr, &std::fclose);
+    if (input_file.has_value()) {
+        input = open_file(*input_file, "rb");
+        machine.cores.front()->serial_port->input = input.get();
+    }
+    if (record_file.has_value()) {
+        record = open_file(*record_file, "wb");
+        machine.cores.front()->serial_port->input_record = record.get();
+    }
+    if (output_file.has_value()) {
+        output = open_file(*output_file, "wb");
+        for (auto& core : machine.cores) core->serial_port->output = output.get();
+    }
 
-    for(auto& device : devices.devices) {
-        device->init();
+    // A guest blocked on host input never returns to the run loop, so the timeout ends the process instead.
+    std::jthread watchdog;
+    if (timeout.has_value()) {
+        watchdog = std::jthread([limit = *timeout](std::stop_token stop) {
+            std::mutex mutex;
+            std::condition_variable_any stopped;
+            std::unique_lock lock(mutex);
+            stopped.wait_for(lock, stop, limit, [] { return false; });
+            if (stop.stop_requested()) return;
+            std::fputs("Timeout\n", stderr);
+            std::fflush(nullptr);
+            std::_Exit(exit_out_of_budget);
+        });
     }
 
+    // Observers follow the first core.
+    auto& first_core = *machine.cores.front();
+    CPUObserverGroup observers;
+
+    std::unique_ptr<Profiler> profiler;
+    if (profile_file.has_value()) {
+        profiler = std::make_unique<Profiler>(SymbolTable(*program_file), program_file->filename().string());
+        observers.observers.push_back(profiler.get());
+    }
 
-    connect_bus(bus, *cpu);
-    connect_bus(bus, *memory);
-    connect_bus(bus, *serialPort);
+    std::unique_ptr<TraceWriter> trace;
+    if (trace_file.has_value()) {
+        trace = std::make_unique<TraceWriter>(*trace_file);
+        observers.observers.push_back(trace.get());
+    }
 
-    while (cpu->is_running()) {
-        devices.simulate();
+    std::unique_ptr<TelemetryPublisher> telemetry;
+    if (telemetry_name.has_value()) {
+        telemetry = std::make_unique<TelemetryPublisher>(*telemetry_name);
+        observers.observers.push_back(telemetry.get());
     }
-}
\ No newline at end of file
+
+    std::unique_ptr<CoverageMap> coverage;
+    if (coverage_file.has_value()) {
+        coverage = std::make_unique<CoverageMap>();
+        observers.observers.push_back(coverage.get());
+    }
+
+    if (observers.observers.size() == 1) {
+        first_core.cpu->set_observer(observers.observers.front());
+    } else if (!observers.observers.empty()) {
+        first_core.cpu->set_observer(&observers);
+    }
+
+    if (telemetry) {
+        machine.run(4096, [&] { telemetry->publish(first_core); });
+    } else {
+        machine.run();
+    }
+
+    if (trace) {
+        trace->close();
+    }
+    if (profiler) {
+        std::ofstream profile(*profile_file);
+        profiler->write_callgrind(profile);
+    }
+    if (coverage) {
+        coverage->write(*coverage_file);
+    }
+
+    for (auto const& core : machine.cores) {
+        if (core->exit_code.has_value()) return exit_status(*core->exit_code);
+    }
+    for (auto const& core : machine.cores) {
+        if (core->cpu->is_out_of_budget()) {
+            std::fputs("Budget exhausted\n", stderr);
+            return exit_out_of_budget;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "mapped_file.hxx"
+#include <algorithm>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(std::filesystem::path const& path, Mode mode) : mode{mode} {
+    descriptor = ::open(path.c_str(), (mode == Mode::WriteBack ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (descriptor < 0) throw std::runtime_error("Cannot open file: " + path.string());
+
+    struct stat status {};
+    if (fstat(descriptor, &status) < 0) {
+        close(descriptor);
+        throw std::runtime_error("Cannot stat file: " + path.string());
+    }
+    size = static_cast<size_t>(status.st_size);
+    if (size == 0) return;
+
+    auto const protection = mode == Mode::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+    auto const flags = mode == Mode::CopyOnWrite ? MAP_PRIVATE : MAP_SHARED;
+    auto* const mapping = mmap(nullptr, size, protection, flags, descriptor, 0);
+    if (mapping == MAP_FAILED) {
+        close(descriptor);
+        throw std::runtime_error("Cannot map file: " + path.string());
+    }
+    data = static_cast<uint8_t*>(mapping);
+    // Files are mostly read front to back.
+    madvise(data, size, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile() {
+    try {
+        flush();
+    } catch (std::runtime_error const&) {
+        // Nothing left to report the failure to, the data written before is still in the page cache.
+    }
+    if (data) munmap(data, size);
+    close(descriptor);
+}
+
+std::span<uint8_t> MappedFile::writable(size_t offset, size_t count) {
+    if (mode == Mode::ReadOnly) throw std::logic_error("The file is read only");
+    if (offset + count > size) throw std::out_of_range("Write past the end of the file");
+
+    if (dirty_begin >= dirty_end) {
+        dirty_begin = offset;
+        dirty_end = offset + count;
+    } else {
+        dirty_begin = std::min(dirty_begin, offset);
+        dirty_end = std::max(dirty_end, offset + count);
+    }
+    return {data + offset, count};
+}
+
+void MappedFile::flush() {
+    if (dirty_begin >= dirty_end) return;
+    if (mode == Mode::WriteBack) {
+        // msync needs a page aligned start.
+        auto const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        auto const begin = dirty_begin / page * page;
+        if (msync(data + begin, dirty_end - begin, MS_SYNC) < 0) throw std::runtime_error("Cannot sync file");
+    }
+    dirty_begin = dirty_end = 0;
+}
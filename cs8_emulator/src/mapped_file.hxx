@@ -0,0 +1,66 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_MAPPED_FILE_HXX
+#define CS8_MAPPED_FILE_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+/**
+ * A host file mapped into the address space of the emulator.
+ * Guest reads come straight from the mapping, writes are collected and only synced to the file on flush.
+ */
+class MappedFile {
+public:
+    enum class Mode {
+        ///! Writes are refused.
+        ReadOnly,
+        ///! Writes stay in the emulator, the file is never changed.
+        CopyOnWrite,
+        ///! Writes reach the file when it is flushed.
+        WriteBack
+    };
+
+private:
+    int descriptor {-1};
+    uint8_t* data {nullptr};
+    size_t size {0};
+    Mode mode;
+
+    ///! The range written since the last flush, empty if dirty_begin >= dirty_end.
+    size_t dirty_begin {0};
+    size_t dirty_end {0};
+
+public:
+    MappedFile(std::filesystem::path const& path, Mode mode);
+    ~MappedFile();
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    [[nodiscard]] Mode get_mode() const {
+        return mode;
+    }
+
+    [[nodiscard]] std::span<uint8_t const> bytes() const {
+        return {data, size};
+    }
+
+    /**
+     * The bytes at [offset, offset + count) for writing, marked dirty
+     * @throws std::logic_error if the file is read only
+     */
+    std::span<uint8_t> writable(size_t offset, size_t count);
+
+    /**
+     * Sync the bytes written since the last flush to the file
+     */
+    void flush();
+};
+
+
+#endif //CS8_MAPPED_FILE_HXX
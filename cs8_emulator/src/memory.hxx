@@ -8,15 +8,31 @@
 #include <iostream>
 #include <ios>
 #include <functional>
+#include <span>
+#include <stdexcept>
 #include "bus.hxx"
 #include "device.hxx"
+#include "dirty_pages.hxx"
+#include "page_mapping.hxx"
 
+/**
+ * Plain memory. The buffer lives in a PageMapping, host pages are only allocated when the guest writes to them and
+ * memories loaded from the same image share the pages they did not write.
+ */
 template<size_t Size, typename AllocUnit, typename Address, Address Begin, Address End, size_t ID, BusLike<AllocUnit, Address> Bus>
 class Memory : public Device, public BusDevice<AllocUnit, Address, ID, Bus> {
 public:
-    using BufferType = std::array<AllocUnit, Size>;
+    using BufferType = std::span<AllocUnit, Size>;
 private:
-    BufferType memory_buffer;
+    PageMapping pages {Size * sizeof(AllocUnit)};
+    BufferType memory_buffer {pages.as<AllocUnit>(), Size};
+    ///! Marks the pages written, nullptr if nothing tracks them.
+    DirtyPages* dirty {nullptr};
+
+    AllocUnit& at(size_t address) {
+        if (address >= Size) throw std::out_of_range("Memory address out of range");
+        return memory_buffer[address];
+    }
 
 public:
     using AllocationUnit = AllocUnit;
@@ -27,23 +43,60 @@ public:
     void modify(std::function<void (BufferType&)> const& f) {
         f(memory_buffer);
     }
+
+    /**
+     * The buffer itself, for bulk access from the host
+     */
+    [[nodiscard]] BufferType contents() const {
+        return memory_buffer;
+    }
+
+    /**
+     * Capture the contents, memories loading the image share its pages
+     */
+    [[nodiscard]] std::shared_ptr<PageImage const> snapshot() const {
+        return pages.snapshot();
+    }
+
+    /**
+     * Replace the contents by the image, the buffer stays at the same address
+     */
+    void load(std::shared_ptr<PageImage const> image) {
+        pages.share(std::move(image));
+    }
+
+    /**
+     * Copy values from the host into the buffer, they are marked like writes from the bus
+     * @param address the first unit written, the values have to fit into the buffer from there
+     */
+    void write(size_t address, std::span<AllocUnit const> values) {
+        auto const target = memory_buffer.subspan(address, values.size());
+        std::copy(values.begin(), values.end(), target.begin());
+        if (dirty) dirty->mark(target);
+    }
+
+    /// Mark the pages written from now on in the tracker, nullptr stops marking.
+    void set_dirty_pages(DirtyPages* pages) {
+        dirty = pages;
+    }
+
     void simulate() override {
         if (this->get_bus_mode() == RW::Read ||
             this->get_bus_mode() == RW::Write) {
             if (this->get_bus_address() >= Begin &&
                 this->get_bus_address() <= End) {
-              /*  std::cerr << "Activated by "
-                          << ((this->get_bus_mode() == RW::Write) ? "Write"
-                                                                  : "Read")
-                          << " from "
-                          << std::hex << this->get_bus_address() << std::dec
-                          << '\n';*/
                 auto const addr = this->get_bus_address() - Begin;
 
                 if (this->get_bus_mode() == RW::Read) {
-                    this->set_bus_data(memory_buffer.at(addr));
+                    this->set_bus_data(at(addr));
                 } else if (this->get_bus_mode() == RW::Write) {
-                    memory_buffer.at(addr) = this->get_bus_data();
+                    // The CPU writes back every value it read, storing an equal value would copy a shared page.
+                    auto const value = this->get_bus_data();
+                    auto& unit = at(addr);
+                    if (unit != value) {
+                        unit = value;
+                        if (dirty) dirty->mark(std::span{&unit, 1});
+                    }
                 }
             }
         }
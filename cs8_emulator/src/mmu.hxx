@@ -0,0 +1,204 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_MMU_HXX
+#define CS8_MMU_HXX
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include "bus.hxx"
+#include "device.hxx"
+#include "dirty_pages.hxx"
+#include "interrupt_line.hxx"
+#include "page_mapping.hxx"
+
+/**
+ * A memory management unit mapping banks of a large backing store into the upper guest address space.
+ *
+ * The address space from window_begin up is split into windows of bank_size units, every window shows one bank or
+ * nothing. Switching a bank only replaces the pointer of the window, accesses index the bank directly.
+ *
+ * Registers, relative to Begin:
+ *  - 0..11 BANK4..BANK15  the bank shown in the window at 0x4000..0xF000, bit 15 makes the window read only,
+ *                         banks past BANKS leave the window unmapped
+ *  - 12 FAULT_ADDRESS     the address of the last faulting access, read only
+ *  - 13 FAULTS            the number of faulting accesses, read only
+ *  - 14 CONTROL           bit 0 raises an interrupt on every fault
+ *  - 15 BANKS             the number of banks in the backing store, read only
+ *
+ * Reading an unmapped window and changing a read only or unmapped window fault, the read returns 0 and the write is
+ * dropped. A write which would not change the value never faults, so the CPU writing back a value it just read is
+ * harmless. Initially the windows show the banks 0 to 11.
+ */
+template<size_t Size, typename AllocUnit, typename Address, Address Begin, Address End, size_t ID, BusLike<AllocUnit, Address> Bus>
+class MemoryManagementUnit : public Device, public BusDevice<AllocUnit, Address, ID, Bus> {
+public:
+    using AllocationUnit = AllocUnit;
+    static constexpr Address AddressBegin = Begin;
+    static constexpr Address AddressEnd = End;
+    static constexpr size_t DeviceID = ID;
+
+    static constexpr size_t bank_bits = 12;
+    static constexpr size_t bank_size = size_t{1} << bank_bits;
+    static constexpr size_t windows = (size_t{1} << 8 * sizeof(Address)) >> bank_bits;
+    static constexpr size_t first_window = 4;
+    static constexpr Address window_begin = first_window << bank_bits;
+    static constexpr Address window_end = static_cast<Address>(-1);
+
+    static constexpr uint16_t bank_read_only = 1u << 15;
+    static constexpr uint16_t bank_mask = bank_read_only - 1;
+    static constexpr uint16_t control_fault_interrupt = 1u << 0;
+
+    enum Register : Address {
+        Bank4 = 0, FaultAddress = 12, Faults = 13, Control = 14, Banks = 15
+    };
+
+private:
+    ///! Banks the guest never wrote to take no host memory.
+    PageMapping backing;
+    size_t banks {0};
+    ///! Marks the pages of the backing store written, nullptr if nothing tracks them.
+    DirtyPages* dirty {nullptr};
+
+    ///! The bank every window shows, nullptr if it is unmapped.
+    std::array<AllocUnit*, windows> window {};
+    std::array<bool, windows> writable {};
+    std::array<uint16_t, windows> bank_registers {};
+
+    Address fault_address {0};
+    uint16_t faults {0};
+    uint16_t control {0};
+
+    InterruptSink* interrupts {nullptr};
+    size_t interrupt_source {0};
+
+    void select(size_t index, uint16_t value) {
+        bank_registers[index] = value;
+        auto const bank = value & bank_mask;
+        window[index] = bank < bank_count() ? backing.as<AllocUnit>() + bank * bank_size : nullptr;
+        writable[index] = !(value & bank_read_only);
+    }
+
+    void fault(Address address) {
+        fault_address = address;
+        ++faults;
+        if ((control & control_fault_interrupt) && interrupts) interrupts->raise(interrupt_source);
+    }
+
+    void access_window(Address address) {
+        auto const index = address >> bank_bits;
+        auto* const bank = window[index];
+        auto const offset = address & (bank_size - 1);
+
+        if (this->get_bus_mode() == RW::Read) {
+            if (bank) {
+                this->set_bus_data(bank[offset]);
+            } else {
+                fault(address);
+                this->set_bus_data(0);
+            }
+        } else {
+            auto const value = this->get_bus_data();
+            // Like memory, storing the value the CPU writes back after a read would copy a shared page.
+            if (bank && writable[index]) {
+                if (bank[offset] != value) {
+                    bank[offset] = value;
+                    if (dirty) dirty->mark(std::span{bank + offset, 1});
+                }
+            } else if (value != (bank ? bank[offset] : 0)) fault(address);
+        }
+    }
+
+    void access_register(Address offset) {
+        if (this->get_bus_mode() == RW::Read) {
+            if (offset < FaultAddress) this->set_bus_data(bank_registers[offset + first_window]);
+            else if (offset == FaultAddress) this->set_bus_data(fault_address);
+            else if (offset == Faults) this->set_bus_data(faults);
+            else if (offset == Control) this->set_bus_data(control);
+            else if (offset == Banks) this->set_bus_data(static_cast<uint16_t>(bank_count()));
+            else this->set_bus_data(0);
+        } else {
+            if (offset < FaultAddress) select(offset + first_window, this->get_bus_data());
+            else if (offset == Control) control = this->get_bus_data();
+        }
+    }
+
+public:
+    /**
+     * @param bank_number the number of banks in the backing store
+     */
+    explicit MemoryManagementUnit(size_t bank_number = 256) {
+        resize(bank_number);
+    }
+
+    /// The number of banks in the backing store.
+    [[nodiscard]] size_t bank_count() const {
+        return banks;
+    }
+
+    /**
+     * Replace the backing store by an empty one with the given number of banks and show the first banks again
+     */
+    void resize(size_t bank_number) {
+        if (bank_number > bank_mask) throw std::out_of_range("Too many banks: " + std::to_string(bank_number));
+        backing = PageMapping(bank_number * bank_size * sizeof(AllocUnit));
+        banks = bank_number;
+        for (size_t i = first_window; i < windows; ++i) select(i, static_cast<uint16_t>(i - first_window));
+    }
+
+    /**
+     * Connect the unit to an interrupt controller, faults are raised as the given source
+     */
+    void attach(InterruptSink* interrupt_sink, size_t source_number) {
+        interrupts = interrupt_sink;
+        interrupt_source = source_number;
+    }
+
+    /// The registers, the contents of the banks are in backing_store.
+    struct State {
+        std::array<uint16_t, windows> bank_registers;
+        Address fault_address;
+        uint16_t faults;
+        uint16_t control;
+    };
+
+    [[nodiscard]] State save_state() const {
+        return {bank_registers, fault_address, faults, control};
+    }
+
+    void restore_state(State const& state) {
+        for (size_t i = first_window; i < windows; ++i) select(i, state.bank_registers[i]);
+        fault_address = state.fault_address;
+        faults = state.faults;
+        control = state.control;
+    }
+
+    /// The contents of every bank, one after the other.
+    [[nodiscard]] std::span<AllocUnit> backing_store() const {
+        return {backing.as<AllocUnit>(), banks * bank_size};
+    }
+
+    /// Mark the pages of the backing store written through the windows from now on in the tracker, nullptr stops marking.
+    void set_dirty_pages(DirtyPages* pages) {
+        dirty = pages;
+    }
+
+    void simulate() override {
+        if (this->get_bus_mode() == RW::Read ||
+            this->get_bus_mode() == RW::Write) {
+            auto const address = this->get_bus_address();
+            if (address >= window_begin) {
+                access_window(address);
+            } else if (address >= Begin && address <= End) {
+                access_register(static_cast<Address>(address - Begin));
+            }
+        }
+    }
+};
+
+
+#endif //CS8_MMU_HXX
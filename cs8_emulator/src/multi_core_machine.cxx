@@ -0,0 +1,91 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "multi_core_machine.hxx"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+MultiCoreMachine::MultiCoreMachine(std::filesystem::path const& program_file, size_t core_count, bool parallel_mode)
+: shared{std::make_shared<SharedBus>(core_count, EmulatedSharedBusPort::AddressEnd - EmulatedSharedBusPort::AddressBegin + 1, parallel_mode)},
+  parallel{parallel_mode}, halted(core_count, false) {
+    if (core_count == 0) throw std::out_of_range("A machine needs at least one core");
+
+    // The cores share the pages of the program they do not write to.
+    ProgramImage const program(program_file);
+    auto const image = load_memory_image(program);
+    for (size_t i = 0; i < core_count; ++i) {
+        auto& core = *cores.emplace_back(std::make_unique<Machine>(program, image));
+        auto& port = ports.emplace_back(std::make_shared<EmulatedSharedBusPort>(shared, i, core.scheduler));
+
+        core.scheduler.map(port, EmulatedSharedBusPort::AddressBegin, EmulatedSharedBusPort::AddressEnd);
+        connect_bus(core.bus, *port);
+        // Sequentially an idle core must not block the others, the turns handle waiting for input.
+        core.scheduler.block_when_idle = parallel || core_count == 1;
+        if (i != 0) core.serial_port->input = nullptr;
+    }
+}
+
+bool MultiCoreMachine::is_running() const {
+    return std::any_of(cores.begin(), cores.end(), [](auto const& core) { return core->cpu->is_running(); });
+}
+
+void MultiCoreMachine::collect_halted() {
+    for (size_t i = 0; i < cores.size(); ++i) {
+        if (!halted[i] && !cores[i]->cpu->is_running()) {
+            halted[i] = true;
+            cores[i]->halted();
+            shared->halted(i);
+        }
+    }
+}
+
+void MultiCoreMachine::run() {
+    if (cores.size() == 1) {
+        cores.front()->run();
+    } else if (parallel) {
+        run_parallel();
+    } else {
+        run_sequential(EventCalendar::never);
+    }
+}
+
+void MultiCoreMachine::run_sequential(uint64_t time) {
+    auto& first = *cores.front();
+    while (is_running() && (!first.cpu->is_running() || first.scheduler.now() < time)) {
+        auto const changes = shared->changes();
+        bool idle = true;
+
+        for (auto& core : cores) {
+            if (!core->cpu->is_running()) continue;
+            // Other cores may have changed the shared window since this core found itself idle.
+            core->cpu->wake();
+            core->scheduler.run_until(core->scheduler.now() + quantum);
+            idle = idle && (!core->cpu->is_running() || (core->cpu->is_idle() && !core->scheduler.has_pending_events()));
+        }
+        collect_halted();
+
+        if (idle && changes == shared->changes() && is_running()) {
+            // Every core waits for another one, only host input can end this.
+            std::vector<std::shared_ptr<Device>> devices {cores.front()->serial_port};
+            if (!cores.front()->cpu->is_running() || !wait_for_input(devices)) {
+                for (auto& core : cores) core->cpu->halt();
+                collect_halted();
+            }
+        }
+    }
+}
+
+void MultiCoreMachine::run_parallel() {
+    std::vector<std::jthread> threads;
+    for (size_t i = 0; i < cores.size(); ++i) {
+        threads.emplace_back([this, i] {
+            cores[i]->scheduler.run();
+            cores[i]->halted();
+            shared->halted(i);
+        });
+    }
+    threads.clear();
+    std::fill(halted.begin(), halted.end(), true);
+}
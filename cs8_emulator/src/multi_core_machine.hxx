@@ -0,0 +1,80 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_MULTI_CORE_MACHINE_HXX
+#define CS8_MULTI_CORE_MACHINE_HXX
+
+#include "machine.hxx"
+#include "shared_bus.hxx"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+using EmulatedSharedBusPort = SharedBusPort<0x1000, BusType::DataType, BusType::AddressType, 0x3000, 0x3FFF, 0xA5, BusType>;
+
+/**
+ * Several CS8 machines running the same program, each core has its own private memory and devices.
+ * The cores share the window of the SharedBus, a core finds out which one it is by reading CORE_ID.
+ *
+ * Sequentially the cores run in turns of a fixed number of cycles, which is deterministic. In parallel every core runs
+ * on its own host thread and the cores only synchronize on accesses to the shared window. A single core runs like a
+ * Machine.
+ */
+struct MultiCoreMachine {
+    ///! The cycles a core runs before the next core gets its turn in sequential mode.
+    static constexpr uint64_t quantum = 256;
+
+    std::shared_ptr<SharedBus> shared;
+    std::vector<std::unique_ptr<Machine>> cores;
+    std::vector<std::shared_ptr<EmulatedSharedBusPort>> ports;
+    bool parallel;
+
+    /**
+     * Build the cores and load the program into every one of them, only the first core reads host input
+     * @param program_file a path to an elf file
+     * @param core_count the number of cores
+     * @param parallel_mode whether the cores run on their own host threads
+     */
+    MultiCoreMachine(std::filesystem::path const& program_file, size_t core_count, bool parallel_mode);
+
+    [[nodiscard]] bool is_running() const;
+
+    /**
+     * Simulate until every core halts
+     */
+    void run();
+
+    /**
+     * Simulate until every core halts, calling f after every period cycles of the first core and once at the end.
+     * In parallel mode f is only called at the end.
+     */
+    template<typename F>
+    void run(uint64_t period, F&& f) {
+        if (cores.size() == 1) {
+            cores.front()->run(period, std::forward<F>(f));
+        } else if (parallel) {
+            run();
+            f();
+        } else {
+            while (is_running()) {
+                run_sequential(cores.front()->scheduler.now() + period);
+                f();
+            }
+        }
+    }
+
+private:
+    std::vector<bool> halted;
+
+    /// Report cores which halted since the last call to the shared bus.
+    void collect_halted();
+
+    /// Run the cores in turns until they halt or the first core reaches the time.
+    void run_sequential(uint64_t time);
+    void run_parallel();
+};
+
+
+#endif //CS8_MULTI_CORE_MACHINE_HXX
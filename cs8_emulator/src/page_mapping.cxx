@@ -0,0 +1,84 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "page_mapping.hxx"
+#include <algorithm>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+PageImage::~PageImage() {
+    if (descriptor >= 0) close(descriptor);
+}
+
+std::shared_ptr<PageImage const> PageImage::capture(std::span<std::byte const> bytes) {
+    std::shared_ptr<PageImage> image(new PageImage());
+    image->descriptor = memfd_create("cs8-image", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (image->descriptor < 0) throw std::runtime_error("Cannot create memory image");
+    image->size = bytes.size();
+
+    if (ftruncate(image->descriptor, static_cast<off_t>(bytes.size())) < 0) {
+        throw std::runtime_error("Cannot size memory image");
+    }
+    // Leave the zero pages out, the file stays sparse there.
+    auto const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < bytes.size(); offset += page) {
+        auto const chunk = bytes.subspan(offset, std::min(page, bytes.size() - offset));
+        bool const zero = std::all_of(chunk.begin(), chunk.end(), [](std::byte b) { return b == std::byte{0}; });
+        if (!zero && pwrite(image->descriptor, chunk.data(), chunk.size(), static_cast<off_t>(offset)) != static_cast<ssize_t>(chunk.size())) {
+            throw std::runtime_error("Cannot write memory image");
+        }
+    }
+    // Sealed images cannot change below the mappings sharing them.
+    fcntl(image->descriptor, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    return image;
+}
+
+PageMapping::PageMapping(size_t size) {
+    // Whole pages, so snapshots of the mapping can be shared completely.
+    auto const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    this->size = (size + page - 1) / page * page;
+    auto* const mapping = mmap(nullptr, this->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) throw std::runtime_error("Cannot map guest memory");
+    data = static_cast<std::byte*>(mapping);
+}
+
+PageMapping::~PageMapping() {
+    if (data) munmap(data, size);
+}
+
+PageMapping::PageMapping(PageMapping&& other) noexcept
+: data{std::exchange(other.data, nullptr)}, size{std::exchange(other.size, 0)}, image{std::move(other.image)} {}
+
+PageMapping& PageMapping::operator=(PageMapping&& other) noexcept {
+    if (this != &other) {
+        if (data) munmap(data, size);
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+        image = std::move(other.image);
+    }
+    return *this;
+}
+
+void PageMapping::share(std::shared_ptr<PageImage const> source) {
+    if (source->get_size() > size) throw std::out_of_range("The memory image is larger than the mapping");
+
+    // Map over the old pages in place, devices keep pointers into the mapping.
+    auto const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto const shared = source->get_size() / page * page;
+    if (shared > 0 && mmap(data, shared, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, source->get_descriptor(), 0) == MAP_FAILED) {
+        throw std::runtime_error("Cannot map memory image");
+    }
+    // The partial last page and everything after the image are copied and zeroed respectively.
+    if (size > shared && mmap(data + shared, size - shared, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0) == MAP_FAILED) {
+        throw std::runtime_error("Cannot map guest memory");
+    }
+    if (source->get_size() > shared) {
+        auto const tail = pread(source->get_descriptor(), data + shared, source->get_size() - shared, static_cast<off_t>(shared));
+        if (tail != static_cast<ssize_t>(source->get_size() - shared)) throw std::runtime_error("Cannot read memory image");
+    }
+    image = std::move(source);
+}
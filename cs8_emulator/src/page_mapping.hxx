@@ -0,0 +1,91 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_PAGE_MAPPING_HXX
+#define CS8_PAGE_MAPPING_HXX
+
+#include <cstddef>
+#include <memory>
+#include <span>
+
+/**
+ * An immutable snapshot of guest memory kept in a sealed memory file.
+ * Mappings of the image share its host pages until they write to them.
+ */
+class PageImage {
+    int descriptor {-1};
+    size_t size {0};
+
+    PageImage() = default;
+
+public:
+    ~PageImage();
+
+    PageImage(PageImage const&) = delete;
+    PageImage& operator=(PageImage const&) = delete;
+
+    /**
+     * Copy the bytes into a new image
+     */
+    static std::shared_ptr<PageImage const> capture(std::span<std::byte const> bytes);
+
+    [[nodiscard]] int get_descriptor() const {
+        return descriptor;
+    }
+
+    [[nodiscard]] size_t get_size() const {
+        return size;
+    }
+};
+
+/**
+ * Host memory for guest memory, allocated by the kernel page by page on the first write.
+ * Pages never written share the zero page, pages of a mapped image are shared until they are written.
+ */
+class PageMapping {
+    std::byte* data {nullptr};
+    size_t size {0};
+    ///! Keeps the image alive, the kernel needs it to read pages in.
+    std::shared_ptr<PageImage const> image;
+
+public:
+    PageMapping() = default;
+
+    /**
+     * Reserve at least size bytes of zeroes, rounded up to whole pages
+     */
+    explicit PageMapping(size_t size);
+    ~PageMapping();
+
+    PageMapping(PageMapping&& other) noexcept;
+    PageMapping& operator=(PageMapping&& other) noexcept;
+
+    PageMapping(PageMapping const&) = delete;
+    PageMapping& operator=(PageMapping const&) = delete;
+
+    /**
+     * Replace the contents by a copy-on-write view of the image, the address of the mapping stays the same
+     * @throws std::out_of_range if the image is larger than the mapping
+     */
+    void share(std::shared_ptr<PageImage const> source);
+
+    /**
+     * Capture the current contents as an image
+     */
+    [[nodiscard]] std::shared_ptr<PageImage const> snapshot() const {
+        return PageImage::capture({data, size});
+    }
+
+    template<typename T>
+    [[nodiscard]] T* as() const {
+        return reinterpret_cast<T*>(data);
+    }
+
+    [[nodiscard]] size_t get_size() const {
+        return size;
+    }
+};
+
+
+#endif //CS8_PAGE_MAPPING_HXX
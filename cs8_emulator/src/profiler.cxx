@@ -0,0 +1,101 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "profiler.hxx"
+#include <ios>
+#include <utility>
+
+Profiler::Profiler(SymbolTable symbols, std::string program)
+        : symbols{std::move(symbols)}, program{std::move(program)} {}
+
+std::string const* Profiler::function_name(uint16_t address) const {
+    if (auto const* function = symbols.function_at(address)) return &function->name;
+    return &unknown_function;
+}
+
+void Profiler::on_retire(uint16_t address, uint8_t opcode, uint64_t cycles, CPURegisters const& registers) {
+    Cost const cost {1, cycles};
+    self_costs[function_name(address)][address] += cost;
+    total += cost;
+
+    if (pending_branch) {
+        handle_branch(*pending_branch);
+        pending_branch.reset();
+    }
+}
+
+void Profiler::on_branch(uint16_t address, uint16_t target, uint16_t link) {
+    pending_branch = Branch{address, target, link};
+}
+
+void Profiler::handle_branch(Branch const& branch) {
+    // Returns unwind to the matching call, calls skipped on the way did not return normally.
+    for (auto it = shadow_stack.rbegin(); it != shadow_stack.rend(); ++it) {
+        if (it->return_address == branch.target) {
+            auto const depth = std::distance(it, shadow_stack.rend()) - 1;
+            while (shadow_stack.size() > static_cast<size_t>(depth)) {
+                finish_call(shadow_stack.back());
+                shadow_stack.pop_back();
+            }
+            return;
+        }
+    }
+
+    if (auto const* function = symbols.function_starting_at(branch.target)) {
+        shadow_stack.push_back({branch.address, branch.link, function_name(branch.address), &function->name,
+                                branch.target, total});
+    }
+}
+
+void Profiler::finish_call(Call const& call) {
+    auto& edge = call_edges[{call.caller, call.call_site, call.callee}];
+    ++edge.count;
+    edge.callee_address = call.callee_address;
+    edge.inclusive += Cost{total.instructions - call.at_call.instructions, total.cycles - call.at_call.cycles};
+}
+
+void Profiler::write_callgrind(std::ostream& os) {
+    while (!shadow_stack.empty()) {
+        finish_call(shadow_stack.back());
+        shadow_stack.pop_back();
+    }
+
+    os << "# callgrind format\n"
+       << "version: 1\n"
+       << "creator: cs8_emulator\n"
+       << "positions: instr\n"
+       << "events: Instructions Cycles\n"
+       << "summary: " << total.instructions << ' ' << total.cycles << "\n\n"
+       << "ob=" << program << '\n'
+       << "fl=" << program << '\n';
+
+    auto const flags = os.flags();
+    os << std::hex << std::showbase;
+
+    std::map<std::string const*, bool> written;
+    auto write_function = [&](std::string const* function) {
+        written[function] = true;
+        os << "\nfn=" << *function << '\n';
+        if (self_costs.contains(function)) {
+            for (auto const& [address, cost] : self_costs.at(function)) {
+                os << address << std::dec << ' ' << cost.instructions << ' ' << cost.cycles << std::hex << '\n';
+            }
+        }
+        for (auto const& [key, edge] : call_edges) {
+            auto const& [caller, call_site, callee] = key;
+            if (caller != function) continue;
+            os << "cfn=" << *callee << '\n'
+               << "calls=" << std::dec << edge.count << ' ' << std::hex << edge.callee_address << '\n'
+               << call_site << std::dec << ' ' << edge.inclusive.instructions << ' ' << edge.inclusive.cycles
+               << std::hex << '\n';
+        }
+    };
+
+    for (auto const& [function, costs] : self_costs) write_function(function);
+    for (auto const& [key, edge] : call_edges) {
+        if (!written.contains(std::get<0>(key))) write_function(std::get<0>(key));
+    }
+
+    os.flags(flags);
+}
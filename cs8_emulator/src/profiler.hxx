@@ -0,0 +1,100 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_PROFILER_HXX
+#define CS8_PROFILER_HXX
+
+#include "cpu_observer.hxx"
+#include "symbol_table.hxx"
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * Attributes retired instructions and cycles to the functions of a program and
+ * reconstructs the call graph from the branches of the CPU.
+ *
+ * A branch to the start of a function is a call, rln holds its return address.
+ * A branch to the return address of an active call is a return from it and every call above it.
+ * The result is written in the callgrind format.
+ */
+class Profiler : public CPUObserver {
+    struct Cost {
+        uint64_t instructions {0};
+        uint64_t cycles {0};
+
+        Cost& operator+=(Cost const& other) {
+            instructions += other.instructions;
+            cycles += other.cycles;
+            return *this;
+        }
+    };
+
+    struct Call {
+        uint16_t call_site;
+        uint16_t return_address;
+        std::string const* caller;
+        std::string const* callee;
+        uint16_t callee_address;
+        Cost at_call;
+    };
+
+    struct CallEdge {
+        uint64_t count {0};
+        uint16_t callee_address {0};
+        Cost inclusive;
+    };
+
+    SymbolTable symbols;
+    std::string program;
+
+    ///! The name used for code outside of every function.
+    std::string const unknown_function = "(unknown)";
+
+    Cost total;
+    std::vector<Call> shadow_stack;
+
+    struct Branch {
+        uint16_t address;
+        uint16_t target;
+        uint16_t link;
+    };
+
+    ///! The branch of the current instruction, handled once the instruction retired and its cost is known.
+    std::optional<Branch> pending_branch;
+
+    ///! function -> instruction address -> self cost
+    std::map<std::string const*, std::map<uint16_t, Cost>> self_costs;
+
+    ///! (caller, call site, callee) -> calls and inclusive cost
+    std::map<std::tuple<std::string const*, uint16_t, std::string const*>, CallEdge> call_edges;
+
+    [[nodiscard]] std::string const* function_name(uint16_t address) const;
+
+    void finish_call(Call const& call);
+
+    void handle_branch(Branch const& branch);
+
+public:
+    /**
+     * @param symbols the functions of the program
+     * @param program the name of the profiled program, written as the object of the profile
+     */
+    Profiler(SymbolTable symbols, std::string program);
+
+    void on_retire(uint16_t address, uint8_t opcode, uint64_t cycles, CPURegisters const& registers) override;
+    void on_branch(uint16_t address, uint16_t target, uint16_t link) override;
+
+    /**
+     * Write the profile in the callgrind format, calls which did not return yet are closed first
+     */
+    void write_callgrind(std::ostream& os);
+};
+
+
+#endif //CS8_PROFILER_HXX
@@ -0,0 +1,126 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "program_image.hxx"
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace {
+    /// Reads the fields of headers in the byte order of the file, failing on reads past the end.
+    class FieldReader {
+        std::span<uint8_t const> bytes;
+        bool big_endian;
+
+    public:
+        FieldReader(std::span<uint8_t const> bytes, bool big_endian) : bytes{bytes}, big_endian{big_endian} {}
+
+        [[nodiscard]] uint64_t read(uint64_t offset, size_t size) const {
+            if (offset > bytes.size() || size > bytes.size() - offset) throw std::runtime_error("Truncated program file");
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; ++i) {
+                auto const byte = bytes[offset + (big_endian ? i : size - 1 - i)];
+                value = value << 8 | byte;
+            }
+            return value;
+        }
+
+        [[nodiscard]] std::span<uint8_t const> range(uint64_t offset, uint64_t size) const {
+            if (offset > bytes.size() || size > bytes.size() - offset) throw std::runtime_error("Truncated program file");
+            return bytes.subspan(offset, size);
+        }
+    };
+
+    constexpr std::string_view elf_magic = "\x7f" "ELF";
+    constexpr std::string_view flat_magic = "CS8F";
+    constexpr uint16_t flat_version = 1;
+
+    constexpr uint8_t elf_class_64 = 2;
+    constexpr uint8_t elf_data_msb = 2;
+    constexpr uint32_t elf_load_segment = 1;
+
+    bool starts_with(std::span<uint8_t const> bytes, std::string_view magic) {
+        return bytes.size() >= magic.size() && std::memcmp(bytes.data(), magic.data(), magic.size()) == 0;
+    }
+}
+
+ProgramImage::ProgramImage(std::filesystem::path const& path) : file{path, MappedFile::Mode::ReadOnly} {
+    auto const bytes = file.bytes();
+    if (starts_with(bytes, elf_magic)) parse_elf(bytes);
+    else if (starts_with(bytes, flat_magic)) parse_flat(bytes);
+    else throw std::runtime_error("Unknown program file format: " + path.string());
+}
+
+void ProgramImage::parse_elf(std::span<uint8_t const> bytes) {
+    FieldReader const header(bytes, true);
+    bool const wide = header.read(4, 1) == elf_class_64;
+    FieldReader const reader(bytes, header.read(5, 1) == elf_data_msb);
+    // The offsets of the fields differ between the classes from the entry on.
+    size_t const word = wide ? 8 : 4;
+
+    entry = reader.read(24, word);
+    auto const program_headers = reader.read(24 + word, word);
+    auto const section_headers = reader.read(24 + 2 * word, word);
+    auto const fields = 24 + 3 * word + 4 + 2;
+    auto const program_header_size = reader.read(fields, 2);
+    auto const program_header_count = reader.read(fields + 2, 2);
+    auto const section_header_size = reader.read(fields + 4, 2);
+    auto const section_header_count = reader.read(fields + 6, 2);
+    auto const section_names = reader.read(fields + 8, 2);
+
+    for (uint64_t i = 0; i < program_header_count; ++i) {
+        auto const at = program_headers + i * program_header_size;
+        if (reader.read(at, 4) != elf_load_segment) continue;
+
+        auto const offset = reader.read(at + (wide ? 8 : 4), word);
+        auto const address = reader.read(at + (wide ? 16 : 8), word);
+        auto const file_size = reader.read(at + (wide ? 32 : 16), word);
+        auto const memory_size = reader.read(at + (wide ? 40 : 20), word);
+        segments.push_back({static_cast<uint32_t>(address), reader.range(offset, file_size), static_cast<size_t>(memory_size)});
+    }
+
+    if (section_header_count == 0 || section_names >= section_header_count) return;
+    auto const section_field = [&](uint64_t index, size_t field) {
+        // name and type are 32 bit in both classes, flags, address, offset and size are words.
+        auto const at = section_headers + index * section_header_size;
+        return field < 2 ? reader.read(at + 4 * field, 4) : reader.read(at + 8 + (field - 2) * word, word);
+    };
+    auto const names = reader.range(section_field(section_names, 4), section_field(section_names, 5));
+
+    for (uint64_t i = 0; i < section_header_count; ++i) {
+        auto const name = section_field(i, 0);
+        if (name >= names.size()) continue;
+        auto const* const begin = reinterpret_cast<char const*>(names.data() + name);
+        if (std::string_view(begin, strnlen(begin, names.size() - name)) != "cs8.vectors") continue;
+
+        // Big endian pairs of source and handler address, whatever the byte order of the file.
+        FieldReader const data(reader.range(section_field(i, 4), section_field(i, 5)), true);
+        for (uint64_t pair = 0; pair + 4 <= section_field(i, 5); pair += 4) {
+            vectors.push_back({static_cast<uint16_t>(data.read(pair, 2)), static_cast<uint16_t>(data.read(pair + 2, 2))});
+        }
+    }
+}
+
+void ProgramImage::parse_flat(std::span<uint8_t const> bytes) {
+    FieldReader const reader(bytes, true);
+    if (reader.read(4, 2) != flat_version) throw std::runtime_error("Unsupported flat image version");
+    entry = reader.read(6, 2);
+    auto const segment_count = reader.read(8, 2);
+    auto const vector_count = reader.read(10, 2);
+
+    constexpr uint64_t header_size = 12;
+    constexpr uint64_t segment_size = 16;
+    for (uint64_t i = 0; i < segment_count; ++i) {
+        auto const at = header_size + i * segment_size;
+        auto const file_size = reader.read(at + 4, 4);
+        auto const memory_size = reader.read(at + 8, 4);
+        segments.push_back({static_cast<uint32_t>(reader.read(at, 2)), reader.range(reader.read(at + 12, 4), file_size),
+                            static_cast<size_t>(memory_size)});
+    }
+    auto const vector_table = header_size + segment_count * segment_size;
+    for (uint64_t i = 0; i < vector_count; ++i) {
+        vectors.push_back({static_cast<uint16_t>(reader.read(vector_table + 4 * i, 2)),
+                           static_cast<uint16_t>(reader.read(vector_table + 4 * i + 2, 2))});
+    }
+}
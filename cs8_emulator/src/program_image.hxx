@@ -0,0 +1,90 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_PROGRAM_IMAGE_HXX
+#define CS8_PROGRAM_IMAGE_HXX
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "mapped_file.hxx"
+
+/**
+ * A program file mapped read only: an ELF file of either class and byte order, or a flat image.
+ *
+ * Only the headers are parsed, the segment data is copied straight from the mapping when the program is loaded.
+ *
+ * Flat images are big endian:
+ *  - 0  "CS8F", version (u16), entry (u16), segment count (u16), vector count (u16)
+ *  - 12 per segment: address (u16), flags (u16), file size (u32), memory size (u32), file offset (u32)
+ *  - then per vector: source (u16), handler (u16)
+ */
+class ProgramImage {
+public:
+    struct Segment {
+        uint32_t address;
+        ///! The bytes stored in the file, the rest of the segment is zero.
+        std::span<uint8_t const> data;
+        size_t memory_size;
+    };
+
+    struct Vector {
+        uint16_t source;
+        uint16_t handler;
+    };
+
+private:
+    MappedFile file;
+    std::vector<Segment> segments;
+    std::vector<Vector> vectors;
+    uint64_t entry {0};
+
+    void parse_elf(std::span<uint8_t const> bytes);
+    void parse_flat(std::span<uint8_t const> bytes);
+
+public:
+    /**
+     * Map the file and read its headers
+     * @throws std::runtime_error if the file is neither an ELF file nor a flat image or is truncated
+     */
+    explicit ProgramImage(std::filesystem::path const& path);
+
+    [[nodiscard]] std::vector<Segment> const& get_segments() const {
+        return segments;
+    }
+
+    ///! The interrupt vectors of the .vector directives.
+    [[nodiscard]] std::vector<Vector> const& get_vectors() const {
+        return vectors;
+    }
+
+    [[nodiscard]] uint64_t get_entry() const {
+        return entry;
+    }
+
+    /**
+     * Copy the segments into memory starting at the given address, zero filling what the file does not store
+     * @throws std::out_of_range if a segment does not fit
+     */
+    template<typename AllocUnit>
+    void load(std::span<AllocUnit> memory, size_t begin) const {
+        for (auto const& segment : segments) {
+            if (segment.address < begin || segment.address - begin + segment.memory_size > memory.size()) {
+                throw std::out_of_range("Segment at " + std::to_string(segment.address) + " does not fit into memory");
+            }
+            auto const target = memory.subspan(segment.address - begin, segment.memory_size);
+            auto const stored = std::min(segment.data.size(), segment.memory_size);
+            std::copy_n(segment.data.begin(), stored, target.begin());
+            std::fill(target.begin() + stored, target.end(), AllocUnit{0});
+        }
+    }
+};
+
+
+#endif //CS8_PROGRAM_IMAGE_HXX
@@ -0,0 +1,102 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "reference_cpu.hxx"
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    enum Register : size_t {
+        dst = 0, sc0 = 1, sc1 = 2, idx = 3, tmp = 4, sp0 = 5, sp1 = 6, ln = 13, cnt = 14, bse = 15,
+        ip = CPURegisters::ip, tmp2 = CPURegisters::tmp2
+    };
+}
+
+void ReferenceCPU::interrupt(uint16_t handler) {
+    if (in_service) throw std::logic_error("Interrupt while a handler is running");
+    interrupted_ln = reg(ln);
+    reg(ln) = reg(ip);
+    reg(ip) = static_cast<int16_t>(handler);
+    in_service = true;
+}
+
+void ReferenceCPU::step(Bus& bus) {
+    if (halted) throw std::logic_error("The CPU halted");
+
+    auto next = static_cast<uint16_t>(reg(ip));
+    auto const fetch = [&] {
+        return static_cast<uint8_t>(bus.read(next++));
+    };
+    auto const instruction = fetch();
+    auto const opcode = instruction & 0x0F;
+    uint8_t high = instruction >> 4;
+    if (opcode <= 2) {
+        high = fetch();
+        operand = fetch();
+    } else if (opcode == 5) {
+        operand = fetch();
+    }
+    auto const address = static_cast<uint16_t>(operand | (high << 8));
+    auto const r0 = static_cast<size_t>(high & 0x0F);
+    auto const r1 = static_cast<size_t>(operand & 0x0F);
+    operand = r1;
+    reg(ip) = static_cast<int16_t>(next);
+
+    auto const load = [&](uint16_t value) {
+        reg(tmp2) = reg(tmp);
+        reg(tmp) = static_cast<int16_t>(value);
+    };
+    switch (opcode) {
+        case 0x0: load(address); break;
+        case 0x1: load(bus.read(address)); break;
+        case 0x2: bus.write(address, reg(tmp)); break;
+        case 0x3: load(bus.read(static_cast<uint16_t>(reg(bse) + reg(idx)))); break;
+        case 0x4: bus.write(static_cast<uint16_t>(address + reg(idx)), reg(r0)); break;
+        case 0x5:
+            if (r1 == tmp) reg(tmp2) = reg(tmp);
+            reg(r1) = reg(r0);
+            break;
+        case 0x6: bus.write(static_cast<uint16_t>(reg(sp0)), reg(tmp)); break;
+        case 0x7: bus.write(static_cast<uint16_t>(reg(sp1)), reg(tmp)); break;
+        case 0x8: load(bus.read(static_cast<uint16_t>(reg(sp0)))); break;
+        case 0x9: load(bus.read(static_cast<uint16_t>(reg(sp1)))); break;
+        case 0xA: reg(dst) = static_cast<int16_t>(reg(sc0) + reg(sc1)); break;
+        case 0xB: reg(dst) = static_cast<int16_t>(reg(sc0) - reg(sc1)); break;
+        case 0xC: reg(dst) = static_cast<int16_t>(reg(sc0) * reg(sc1)); break;
+        case 0xD:
+            if (reg(sc1) == 0) throw std::domain_error("Division by zero");
+            reg(dst) = static_cast<int16_t>(reg(sc0) / reg(sc1));
+            reg(tmp2) = reg(tmp);
+            reg(tmp) = static_cast<int16_t>(reg(sc0) % reg(sc1));
+            break;
+        case 0xE: reg(dst) = static_cast<int16_t>(~(reg(sc0) & reg(sc1))); break;
+        case 0xF:
+            switch (r0) {
+                case 0x0:
+                    if (reg(cnt) <= 0) {
+                        reg(ln) = reg(ip);
+                        reg(ip) = reg(tmp);
+                    }
+                    break;
+                case 0x1:
+                    if (reg(tmp) == -1) {
+                        halted = true;
+                    } else {
+                        reg(ln) = reg(ip);
+                        reg(ip) = reg(tmp);
+                    }
+                    break;
+                case 0x2: std::swap(reg(tmp), reg(tmp2)); break;
+                case 0x4:
+                    reg(ip) = reg(ln);
+                    reg(ln) = interrupted_ln;
+                    in_service = false;
+                    break;
+                default:
+                    // wfi only waits, the other extended opcodes do nothing.
+                    break;
+            }
+            break;
+    }
+}
@@ -0,0 +1,73 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_REFERENCE_CPU_HXX
+#define CS8_REFERENCE_CPU_HXX
+
+#include "cpu_observer.hxx"
+#include <cstdint>
+
+/**
+ * The instruction set as a plain interpreter, one call per instruction, to check faster or changed execution paths
+ * against.
+ *
+ * It executes what the phase-accurate CPU executes, including what the opcode table does not say: operands of 3 byte
+ * instructions take the low byte of their words, pops and pushes leave the stack pointers alone and sidx stores the
+ * register in its high nibble to ((nibble << 8) | low nibble of the last operand byte) + ridx. Timing, the write back
+ * every instruction ends with and the devices are not part of it, every memory access goes through ReferenceCPU::Bus.
+ */
+class ReferenceCPU {
+public:
+    struct Bus {
+        virtual ~Bus() = default;
+        virtual uint16_t read(uint16_t address) = 0;
+        virtual void write(uint16_t address, uint16_t data) = 0;
+    };
+
+private:
+    CPURegisters registers;
+    ///! The low nibble of the last operand byte, sidx addresses with it.
+    uint8_t operand {0};
+    bool in_service {false};
+    int16_t interrupted_ln {0};
+    bool halted {false};
+
+    [[nodiscard]] int16_t& reg(size_t index) {
+        return registers.values[index];
+    }
+
+public:
+    /**
+     * Start where a CPU stands between two instructions
+     * @param registers the registers of the CPU
+     */
+    explicit ReferenceCPU(CPURegisters const& registers) : registers{registers} {}
+
+    [[nodiscard]] CPURegisters const& get_registers() const {
+        return registers;
+    }
+
+    [[nodiscard]] bool is_halted() const {
+        return halted;
+    }
+
+    [[nodiscard]] bool is_in_service() const {
+        return in_service;
+    }
+
+    /**
+     * Enter an interrupt handler the way the CPU does before fetching an instruction
+     * @throw std::logic_error if a handler is already running, interrupts do not nest
+     */
+    void interrupt(uint16_t handler);
+
+    /**
+     * Execute the instruction at rip
+     * @throw std::logic_error if the CPU halted
+     * @throw std::domain_error for a division by zero, which the CPU has no result for
+     */
+    void step(Bus& bus);
+};
+
+#endif //CS8_REFERENCE_CPU_HXX
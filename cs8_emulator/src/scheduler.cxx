@@ -0,0 +1,62 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "scheduler.hxx"
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+
+uint64_t EventCalendar::next_event_time() {
+    while (!events.empty()) {
+        auto const& event = events.top();
+        auto const it = pending.find(event.device);
+        if (it != pending.end() && it->second == event.sequence) return event.time;
+        events.pop();
+    }
+    return never;
+}
+
+bool EventCalendar::dispatch_due_events() {
+    bool dispatched = false;
+    while (next_event_time() <= current_time) {
+        auto const event = events.top();
+        events.pop();
+        pending.erase(event.device);
+        event.device->on_event(current_time);
+        dispatched = true;
+    }
+    return dispatched;
+}
+
+void EventCalendar::schedule(Device& device, uint64_t time) {
+    auto const sequence = next_sequence++;
+    pending[&device] = sequence;
+    events.push({time, sequence, &device});
+    burst_end = std::min(burst_end, time);
+}
+
+void EventCalendar::cancel(Device& device) {
+    pending.erase(&device);
+}
+
+void BusArbiter::request_bus(Device& device) {
+    if (std::find(bus_masters.begin(), bus_masters.end(), &device) == bus_masters.end()) bus_masters.push_back(&device);
+}
+
+void BusArbiter::release_bus(Device& device) {
+    std::erase(bus_masters, &device);
+}
+
+bool wait_for_input(std::vector<std::shared_ptr<Device>> const& devices) {
+    std::vector<pollfd> descriptors;
+    for (auto const& device : devices) {
+        if (auto const fd = device->input_descriptor(); fd >= 0) descriptors.push_back({fd, POLLIN, 0});
+    }
+    if (descriptors.empty()) return false;
+
+    while (poll(descriptors.data(), descriptors.size(), -1) < 0) {
+        if (errno != EINTR) return false;
+    }
+    return true;
+}
@@ -0,0 +1,293 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_SCHEDULER_HXX
+#define CS8_SCHEDULER_HXX
+
+#include "bus.hxx"
+#include "device.hxx"
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A calendar of device events, ordered by time in cycles.
+ * Every device has at most one pending event, scheduling again replaces it.
+ */
+class EventCalendar {
+    struct Event {
+        uint64_t time;
+        uint64_t sequence;
+        Device* device;
+
+        bool operator>(Event const& other) const {
+            return time != other.time ? time > other.time : sequence > other.sequence;
+        }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, std::greater<>> events;
+    ///! The sequence of the valid event of every device, other events of the device are stale.
+    std::unordered_map<Device*, uint64_t> pending;
+    uint64_t next_sequence {0};
+
+protected:
+    uint64_t current_time {0};
+    ///! The end of the current burst, an event scheduled during the burst ends it early enough to be on time.
+    uint64_t burst_end {never};
+
+    /// The pending events and the time.
+    struct Events {
+        std::priority_queue<Event, std::vector<Event>, std::greater<>> events;
+        std::unordered_map<Device*, uint64_t> pending;
+        uint64_t next_sequence;
+        uint64_t current_time;
+    };
+
+    [[nodiscard]] Events save_events() const {
+        return {events, pending, next_sequence, current_time};
+    }
+
+    void restore_events(Events const& saved) {
+        events = saved.events;
+        pending = saved.pending;
+        next_sequence = saved.next_sequence;
+        current_time = saved.current_time;
+    }
+
+    /**
+     * The time of the next valid event, the maximum time if there is none
+     */
+    uint64_t next_event_time();
+
+    /**
+     * Notify every device whose event is due
+     * @return whether any event was due
+     */
+    bool dispatch_due_events();
+
+public:
+    static constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+
+    virtual ~EventCalendar() = default;
+
+    /// The current time in cycles.
+    [[nodiscard]] uint64_t now() const {
+        return current_time;
+    }
+
+    /// Whether any device still waits for an event.
+    [[nodiscard]] bool has_pending_events() {
+        return next_event_time() != never;
+    }
+
+    /**
+     * Call Device::on_event of the device at the given time, replacing its pending event
+     */
+    void schedule(Device& device, uint64_t time);
+
+    /**
+     * Drop the pending event of the device
+     */
+    void cancel(Device& device);
+};
+
+/**
+ * Hands the bus to devices other than the CPU.
+ * A device masters the bus only in cycles the CPU neither uses nor owns it, it steals cycles instead of halting the CPU.
+ */
+class BusArbiter {
+protected:
+    std::vector<Device*> bus_masters;
+
+public:
+    virtual ~BusArbiter() = default;
+
+    /// Whether any device masters the bus, the CPU works on even if idle then.
+    [[nodiscard]] bool has_bus_masters() const {
+        return !bus_masters.empty();
+    }
+
+    /**
+     * Call Device::on_bus_grant of the device in every free bus cycle until the bus is released
+     */
+    void request_bus(Device& device);
+
+    /**
+     * Stop granting the bus to the device
+     */
+    void release_bus(Device& device);
+
+    /**
+     * Let the devices mapped at the bus address respond to the transaction the master put on the bus
+     */
+    virtual void complete_transaction() = 0;
+};
+
+/**
+ * Block until one of the devices can read host input
+ * @return false if no device expects any more input
+ */
+bool wait_for_input(std::vector<std::shared_ptr<Device>> const& devices);
+
+/**
+ * Runs the CPU in bursts and lets the other devices work only when needed.
+ *
+ * Bus devices are mapped to address ranges, a page table finds the devices for an address.
+ * After every CPU cycle with an active bus only the devices mapped at the bus address are simulated.
+ * Between bus accesses devices are only called for their events, so the host cost grows with the
+ * activity of the devices, not with their number. Cycles an idle CPU spends waiting for an interrupt or spinning in a
+ * polling loop are skipped up to the next event, without events the host sleeps until a device receives input.
+ */
+template<typename Bus, typename CPU>
+class Scheduler : public EventCalendar, public BusArbiter {
+    static constexpr size_t page_bits = 8;
+    static constexpr size_t pages = (1u << (8 * sizeof(typename Bus::AddressType))) >> page_bits;
+
+    std::shared_ptr<Bus> bus;
+    std::shared_ptr<CPU> cpu;
+    std::vector<std::shared_ptr<Device>> devices;
+    std::array<std::vector<Device*>, pages> page_table;
+    ///! The pages with an address whose reads change without an event, see Device::stable_read.
+    std::bitset<pages> unstable_pages;
+
+    void dispatch(typename Bus::AddressType address) {
+        for (auto* device : page_table[address >> page_bits]) {
+            device->simulate();
+        }
+    }
+
+    /// A loop reading a value which changes with time alone is not idle, it has to be simulated.
+    void check_stable_read(typename Bus::AddressType address) {
+        for (auto* device : page_table[address >> page_bits]) {
+            if (!device->stable_read(address)) cpu->wake();
+        }
+    }
+
+    void grant_bus() {
+        // A master may release the bus while it is granted.
+        for (size_t i = 0; i < bus_masters.size(); ++i) {
+            if (bus->get_mode() != RW::Off || bus->get_bus_owner() != BUS_UNOWNED) return;
+            bus_masters[i]->on_bus_grant();
+        }
+        // The transfers changed devices, an idle loop seen during them has to be checked again.
+        if (bus_masters.empty()) cpu->wake();
+    }
+
+    /// A waiting CPU still leaves free cycles to bus masters, so it may only be skipped without them.
+    bool can_skip() const {
+        return cpu->is_idle() && bus_masters.empty();
+    }
+
+public:
+    ///! Sleep until host input arrives when the CPU idles without events, otherwise the idle CPU skips to the end of run_until.
+    bool block_when_idle = true;
+    ///! The CPU stops once this many cycles passed, idle cycles are skipped instead of waiting for host input then.
+    uint64_t cycle_budget = never;
+
+    Scheduler(std::shared_ptr<Bus> bus, std::shared_ptr<CPU> cpu) : bus{std::move(bus)}, cpu{std::move(cpu)} {
+        devices.push_back(this->cpu);
+    }
+
+    /**
+     * Add a device which reacts to bus accesses in the given address range
+     */
+    void map(std::shared_ptr<Device> device, typename Bus::AddressType begin, typename Bus::AddressType end) {
+        for (size_t page = begin >> page_bits; page <= (end >> page_bits); ++page) {
+            page_table[page].push_back(device.get());
+        }
+        for (size_t address = begin; address <= end; ++address) {
+            if (!device->stable_read(static_cast<typename Bus::AddressType>(address))) unstable_pages.set(address >> page_bits);
+        }
+        if (std::find(devices.begin(), devices.end(), device) == devices.end()) devices.push_back(std::move(device));
+    }
+
+    /**
+     * Add a device which only works on its events
+     */
+    void add(std::shared_ptr<Device> device) {
+        devices.push_back(std::move(device));
+    }
+
+    void complete_transaction() override {
+        dispatch(bus->get_address());
+    }
+
+    /// The time, the pending events, the bus and its masters, the devices save their own state.
+    struct State {
+        Events events;
+        std::vector<Device*> bus_masters;
+        Bus bus;
+    };
+
+    [[nodiscard]] State save_state() const {
+        return {save_events(), bus_masters, *bus};
+    }
+
+    void restore_state(State const& state) {
+        restore_events(state.events);
+        bus_masters = state.bus_masters;
+        *bus = state.bus;
+    }
+
+    void init() {
+        for (auto& device : devices) {
+            device->init();
+        }
+    }
+
+    /**
+     * Simulate until the CPU halts or stops at a trap or the given time or the cycle budget is reached
+     */
+    void run_until(uint64_t time) {
+        time = std::min(time, cycle_budget);
+        while (cpu->is_running() && !cpu->is_trapped() && current_time < time) {
+            auto const next_event = next_event_time();
+            burst_end = std::min(time, next_event);
+            if (can_skip()) {
+                if (next_event == never && block_when_idle && cycle_budget == never) {
+                    // Only host input can change a device now, without any the CPU would stay idle forever.
+                    if (!wait_for_input(devices)) cpu->halt();
+                    cpu->wake();
+                    continue;
+                }
+                if (burst_end == never) return;
+                cpu->skip_cycles(burst_end - current_time);
+                current_time = burst_end;
+                if (dispatch_due_events()) cpu->wake();
+                continue;
+            }
+            while (current_time < burst_end && cpu->is_running() && !can_skip()) {
+                cpu->simulate();
+                // Stopping at a trap takes no cycle.
+                if (cpu->is_trapped()) [[unlikely]] break;
+                ++current_time;
+                if (bus->get_mode() != RW::Off) {
+                    auto const address = bus->get_address();
+                    if (bus->get_mode() == RW::Read && unstable_pages[address >> page_bits]) check_stable_read(address);
+                    dispatch(address);
+                } else if (!bus_masters.empty()) grant_bus();
+            }
+            // A device changed, an idle loop may read something else now.
+            if (dispatch_due_events()) cpu->wake();
+        }
+        if (current_time >= cycle_budget && cpu->is_running()) cpu->exhaust_budget();
+    }
+
+    /**
+     * Simulate until the CPU halts
+     */
+    void run() {
+        run_until(never);
+    }
+};
+
+
+#endif //CS8_SCHEDULER_HXX
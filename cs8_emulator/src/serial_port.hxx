@@ -4,13 +4,143 @@
 
 #ifndef CS8_SERIAL_PORT_HXX
 #define CS8_SERIAL_PORT_HXX
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <cstdio>
 #include <iostream>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
 #include "bus.hxx"
 #include "device.hxx"
 
+/**
+ * Serial data kept in memory instead of host streams, for hosts driving the machine themselves.
+ */
+struct SerialBuffers {
+    ///! The characters for the guest, read from input_position on, the host may append at any time.
+    std::string input;
+    size_t input_position = 0;
+    ///! Set when the host will not append any more input, the guest sees the input closed once it read all of it.
+    bool input_closed = false;
+    ///! The characters written by the guest.
+    std::string output;
+};
+
+/**
+ * The input a serial port took from its buffers, by poll. Replaying it repeats a run without the host appending input.
+ */
+struct SerialInputLog {
+    struct Entry {
+        ///! The number of buffer polls before this one.
+        uint64_t poll;
+        std::string input;
+        bool closed;
+    };
+
+    ///! Only the polls which returned input or closed the input, every other poll found nothing.
+    std::vector<Entry> entries;
+};
+
+/**
+ * A serial port.
+ *
+ * Registers, relative to Begin:
+ *  - 0 DATA    reading returns the next input character or -1 if there is none, writing outputs a character
+ *  - 1 STATUS  bit 0 is set if input is available, bit 1 once the input is closed, read only
+ *
+ * Reading never blocks, guests poll STATUS. The CPU writes -1 back after reading DATA without input, so writing -1
+ * is ignored.
+ */
 template<size_t Size, typename AllocUnit, typename Address, Address Begin, Address End, size_t ID, BusLike<AllocUnit, Address> Bus>
 class SerialPort : public Device, public BusDevice<AllocUnit, Address, ID, Bus> {
+    std::array<char, 256> input_buffer {};
+    size_t input_begin = 0;
+    size_t input_end = 0;
+    bool input_closed = false;
+
+    ///! When set polls of the buffers replay the log up to its end, then log what they read.
+    SerialInputLog* input_log = nullptr;
+    ///! Polls of the buffers so far, they identify the polls in the input log.
+    uint64_t polls = 0;
+    size_t log_position = 0;
+    ///! The most characters ever written, bytes_written only goes back when a state is restored.
+    uint64_t bytes_emitted = 0;
+
+    /// Read what is available without blocking, true if a character is buffered afterwards.
+    bool fill_input() {
+        if (input_begin != input_end) return true;
+        if (buffers) return fill_input_from_buffers();
+        if (input_closed || !input) return false;
+
+        pollfd descriptor {fileno(input), POLLIN, 0};
+        if (poll(&descriptor, 1, 0) <= 0) return false;
+
+        auto const count = read(descriptor.fd, input_buffer.data(), input_buffer.size());
+        if (count <= 0) {
+            input_closed = true;
+            return false;
+        }
+        input_begin = 0;
+        input_end = static_cast<size_t>(count);
+        if (input_record) {
+            fwrite(input_buffer.data(), 1, input_end, input_record);
+            fflush(input_record);
+        }
+        return true;
+    }
+
+    bool fill_input_from_buffers() {
+        auto const poll = polls++;
+        if (input_log && log_position < input_log->entries.size()) {
+            auto const& entry = input_log->entries[log_position];
+            if (entry.poll != poll) return false;
+            ++log_position;
+            input_closed = entry.closed;
+            std::copy(entry.input.begin(), entry.input.end(), input_buffer.begin());
+            input_begin = 0;
+            input_end = entry.input.size();
+            return input_end != 0;
+        }
+
+        auto const was_closed = input_closed;
+        auto const available = buffers->input.size() - std::min(buffers->input_position, buffers->input.size());
+        input_closed = available == 0 && buffers->input_closed;
+        if (available == 0) {
+            if (input_log && input_closed != was_closed) {
+                input_log->entries.push_back({poll, {}, input_closed});
+                ++log_position;
+            }
+            return false;
+        }
+
+        auto const count = std::min(available, input_buffer.size());
+        std::copy_n(buffers->input.begin() + static_cast<std::ptrdiff_t>(buffers->input_position), count, input_buffer.begin());
+        buffers->input_position += count;
+        input_begin = 0;
+        input_end = count;
+        if (input_log) {
+            input_log->entries.push_back({poll, {input_buffer.begin(), input_buffer.begin() + static_cast<std::ptrdiff_t>(count)}, false});
+            ++log_position;
+        }
+        return true;
+    }
+
+    void write_output(char const* data, size_t size) {
+        // Output a replay repeats reached the host before.
+        auto const repeated = static_cast<size_t>(std::min<uint64_t>(bytes_emitted - std::min(bytes_emitted, bytes_written), size));
+        bytes_written += size;
+        bytes_emitted = std::max(bytes_emitted, bytes_written);
+        if (repeated == size) return;
+        if (buffers) {
+            buffers->output.append(data + repeated, size - repeated);
+        } else {
+            fwrite(data + repeated, 1, size - repeated, output);
+            fflush(output);
+        }
+    }
 
 public:
     using AllocationUnit = AllocUnit;
@@ -18,30 +148,96 @@ public:
     static constexpr Address AddressEnd = End;
     static constexpr size_t DeviceID = ID;
 
+    static constexpr uint16_t status_input_available = 1u << 0;
+    static constexpr uint16_t status_input_closed = 1u << 1;
+
+    /// The stream characters written by the guest are sent to.
+    FILE* output = stdout;
+    /// The stream characters read by the guest come from, read with read(2) so it should not be used otherwise.
+    FILE* input = stdin;
+    /// Receives a copy of everything read from input, replaying it as input repeats the run.
+    FILE* input_record = nullptr;
+
+    /// When set the guest reads from and writes to the buffers, input and output are not used.
+    SerialBuffers* buffers = nullptr;
+
+    /// The number of characters written by the guest.
+    uint64_t bytes_written = 0;
+
+    /// The input buffer, the output position and the position in the input log.
+    struct State {
+        std::array<char, 256> input_buffer;
+        size_t input_begin;
+        size_t input_end;
+        bool input_closed;
+        uint64_t bytes_written;
+        uint64_t polls;
+        size_t log_position;
+    };
+
+    [[nodiscard]] State save_state() const {
+        return {input_buffer, input_begin, input_end, input_closed, bytes_written, polls, log_position};
+    }
+
+    /// Continue from a saved state, output written again afterwards is dropped up to where it got before.
+    void restore_state(State const& state) {
+        input_buffer = state.input_buffer;
+        input_begin = state.input_begin;
+        input_end = state.input_end;
+        input_closed = state.input_closed;
+        bytes_written = state.bytes_written;
+        polls = state.polls;
+        log_position = state.log_position;
+    }
+
+    /// Forget the output written after the current state, writing it again reaches the host again.
+    void forget_later_output() {
+        bytes_emitted = bytes_written;
+    }
+
+    /// Log the input from now on to the log, nullptr stops logging.
+    void set_input_log(SerialInputLog* log) {
+        input_log = log;
+        log_position = log ? log->entries.size() : 0;
+    }
+
+    /// Output a string at once, for devices printing on behalf of the guest.
+    void write_string(std::string const& string) {
+        write_output(string.data(), string.size());
+    }
+
+    int input_descriptor() const override {
+        return !buffers && input && !input_closed ? fileno(input) : -1;
+    }
+
     void simulate() override {
         if (this->get_bus_mode() == RW::Read ||
             this->get_bus_mode() == RW::Write) {
             if (this->get_bus_address() >= Begin &&
                 this->get_bus_address() <= End) {
-                auto const address = Begin - this->get_bus_address();
+                auto const address = this->get_bus_address() - Begin;
 
                 if (this->get_bus_mode() == RW::Read) {
                     switch (address) {
                         case 0:
-                            this->set_bus_data((char)std::getchar());
+                            this->set_bus_data(fill_input() ? static_cast<uint8_t>(input_buffer[input_begin++]) : -1);
                             break;
+                        case 1: {
+                            uint16_t status = 0;
+                            if (fill_input()) status |= status_input_available;
+                            if (input_closed) status |= status_input_closed;
+                            this->set_bus_data(status);
+                        } break;
                             default:
                                 break;
                     }
                 } else if (this->get_bus_mode() == RW::Write) {
                     switch (address) {
                         case 0:
-                          //  std::cerr << "Triggered Address: " << address << " Data: " << std::hex << this->get_bus_data() << std::dec << '\n';
-                            {
-                                char data = this->get_bus_data();
-                                printf("%c", data);
-                                fflush(stdout);
-                            }//putchar(this->get_bus_data()>>8);
+                            if (static_cast<int16_t>(this->get_bus_data()) != -1) {
+                                char const data = static_cast<char>(this->get_bus_data());
+                                write_output(&data, 1);
+                            }
                             break;
                             default:
                                 break;
@@ -0,0 +1,111 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "shared_bus.hxx"
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+SharedBus::SharedBus(size_t core_number, size_t size, bool parallel_mode)
+: memory(size > memory_offset ? size - memory_offset : 0), running{core_number}, parallel{parallel_mode} {
+    for (size_t i = 0; i < core_number; ++i) {
+        auto& core = cores.emplace_back(std::make_unique<Core>());
+        if (parallel) {
+            core->event_descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (core->event_descriptor < 0) throw std::runtime_error("Cannot create eventfd");
+        }
+    }
+}
+
+SharedBus::~SharedBus() {
+    for (auto const& core : cores) {
+        if (core->event_descriptor >= 0) close(core->event_descriptor);
+    }
+}
+
+void SharedBus::notify_others(size_t core) {
+    generation.fetch_add(1);
+    if (!parallel) return;
+    for (size_t i = 0; i < cores.size(); ++i) {
+        if (i == core) continue;
+        cores[i]->changes.fetch_add(1);
+        if (cores[i]->sleeping.load()) {
+            uint64_t const one = 1;
+            [[maybe_unused]] auto const written = ::write(cores[i]->event_descriptor, &one, sizeof(one));
+        }
+    }
+}
+
+uint16_t SharedBus::read(size_t core, uint16_t offset) {
+    std::scoped_lock lock(mutex);
+    auto& self = *cores[core];
+
+    if (offset >= memory_offset) {
+        return offset - memory_offset < memory.size() ? memory[offset - memory_offset] : 0;
+    }
+    if (offset >= lock0 && offset < lock0 + locks) {
+        auto const value = lock_values[offset - lock0];
+        lock_values[offset - lock0] = 1;
+        if (value == 0) notify_others(core);
+        return value;
+    }
+    switch (offset) {
+        case core_id: return static_cast<uint16_t>(core);
+        case core_count: return static_cast<uint16_t>(cores.size());
+        case mail_target: return self.mail_target;
+        case mail_receive: {
+            if (self.mailbox.empty()) return static_cast<uint16_t>(-1);
+            auto const value = self.mailbox.front();
+            self.mailbox.pop_front();
+            return value;
+        }
+        case mail_count: return static_cast<uint16_t>(self.mailbox.size());
+        default: return 0;
+    }
+}
+
+void SharedBus::write(size_t core, uint16_t offset, uint16_t value) {
+    std::scoped_lock lock(mutex);
+    auto& self = *cores[core];
+
+    if (offset >= memory_offset) {
+        if (offset - memory_offset < memory.size()) memory[offset - memory_offset] = value;
+    } else if (offset >= lock0 && offset < lock0 + locks) {
+        lock_values[offset - lock0] = value;
+    } else if (offset == mail_target) {
+        self.mail_target = value;
+        return;
+    } else if (offset == mail_send) {
+        if (self.mail_target >= cores.size()) return;
+        cores[self.mail_target]->mailbox.push_back(value);
+    } else {
+        return;
+    }
+    notify_others(core);
+}
+
+void SharedBus::halted(size_t core) {
+    running.fetch_sub(1);
+    std::scoped_lock lock(mutex);
+    notify_others(core);
+}
+
+int SharedBus::wake_descriptor(size_t core) {
+    auto& self = *cores[core];
+    if (!parallel || running.load() <= 1) return -1;
+
+    // Announce the sleep before looking for changes, a core changing the state afterwards signals the eventfd.
+    self.sleeping.store(true);
+    uint64_t drained;
+    while (::read(self.event_descriptor, &drained, sizeof(drained)) > 0) {}
+
+    auto const changes = self.changes.load();
+    if (changes != self.seen_changes) {
+        // Changed since the core last slept, it has to look at the shared state again before sleeping.
+        self.seen_changes = changes;
+        uint64_t const one = 1;
+        [[maybe_unused]] auto const written = ::write(self.event_descriptor, &one, sizeof(one));
+    }
+    return self.event_descriptor;
+}
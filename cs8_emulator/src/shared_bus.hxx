@@ -0,0 +1,158 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_SHARED_BUS_HXX
+#define CS8_SHARED_BUS_HXX
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "bus.hxx"
+#include "device.hxx"
+#include "scheduler.hxx"
+
+/**
+ * Memory and synchronization registers shared by the cores of a multi-core machine.
+ *
+ * Every core reaches the shared window through its own SharedBusPort, a mutex arbitrates between the cores.
+ * Registers, relative to the window:
+ *  - 0 CORE_ID       the number of the accessing core, read only
+ *  - 1 CORE_COUNT    read only
+ *  - 2 MAIL_TARGET   the core MAIL_SEND sends to, one per core
+ *  - 3 MAIL_SEND     writing appends the value to the mailbox of MAIL_TARGET, reads as 0
+ *  - 4 MAIL_RECEIVE  reading takes the oldest value from the own mailbox, -1 if it is empty
+ *  - 5 MAIL_COUNT    the number of values in the own mailbox, read only
+ *  - 8..15           LOCK0..LOCK7, reading sets the lock and returns the value it had, writing 0 releases it
+ *  - 16..            shared memory
+ *
+ * In parallel mode cores run on their own host threads. A core whose CPU idles sleeps on an eventfd
+ * which is signalled when another core changes shared state or halts.
+ */
+class SharedBus {
+public:
+    static constexpr uint16_t core_id = 0;
+    static constexpr uint16_t core_count = 1;
+    static constexpr uint16_t mail_target = 2;
+    static constexpr uint16_t mail_send = 3;
+    static constexpr uint16_t mail_receive = 4;
+    static constexpr uint16_t mail_count = 5;
+    static constexpr uint16_t lock0 = 8;
+    static constexpr uint16_t locks = 8;
+    static constexpr uint16_t memory_offset = 16;
+
+private:
+    struct Core {
+        uint16_t mail_target {0};
+        std::deque<uint16_t> mailbox;
+
+        ///! Shared state changes made by other cores, compared with seen_changes before sleeping.
+        std::atomic<uint64_t> changes {0};
+        uint64_t seen_changes {0};
+        ///! Set while the core may sleep on its eventfd, other cores only signal it then.
+        std::atomic<bool> sleeping {false};
+        int event_descriptor {-1};
+    };
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Core>> cores;
+    std::vector<uint16_t> memory;
+    std::array<uint16_t, locks> lock_values {};
+    std::atomic<size_t> running;
+    ///! Counts every change of the shared state.
+    std::atomic<uint64_t> generation {0};
+    bool parallel;
+
+    void notify_others(size_t core);
+
+public:
+    /**
+     * @param core_number the number of cores
+     * @param size the size of the window including the registers
+     * @param parallel_mode whether the cores run on host threads and may sleep
+     */
+    SharedBus(size_t core_number, size_t size, bool parallel_mode);
+    ~SharedBus();
+
+    SharedBus(SharedBus const&) = delete;
+    SharedBus& operator=(SharedBus const&) = delete;
+
+    uint16_t read(size_t core, uint16_t offset);
+    void write(size_t core, uint16_t offset, uint16_t value);
+
+    /// The number of shared state changes so far, unchanged if no core could have seen anything new.
+    [[nodiscard]] uint64_t changes() const {
+        return generation.load();
+    }
+
+    /**
+     * The core stopped, cores waiting for it are woken
+     */
+    void halted(size_t core);
+
+    /**
+     * The descriptor an idle core sleeps on, -1 if nothing can change the shared state anymore
+     */
+    int wake_descriptor(size_t core);
+
+    /**
+     * The core is running again, other cores do not need to signal it
+     */
+    void awake(size_t core) {
+        if (cores[core]->sleeping.load(std::memory_order_relaxed)) cores[core]->sleeping.store(false);
+    }
+};
+
+/**
+ * Connects a core to the shared window.
+ * The CPU writes every loaded value back in the next cycle, the port drops these writes so they cannot undo a
+ * test-and-set or overwrite what another core wrote in between.
+ */
+template<size_t Size, typename AllocUnit, typename Address, Address Begin, Address End, size_t ID, BusLike<AllocUnit, Address> Bus>
+class SharedBusPort : public Device, public BusDevice<AllocUnit, Address, ID, Bus> {
+    std::shared_ptr<SharedBus> shared;
+    size_t core;
+    EventCalendar* calendar {nullptr};
+
+    Address last_read_address {0};
+    uint64_t last_read_time {EventCalendar::never};
+
+public:
+    using AllocationUnit = AllocUnit;
+    static constexpr Address AddressBegin = Begin;
+    static constexpr Address AddressEnd = End;
+    static constexpr size_t DeviceID = ID;
+
+    SharedBusPort(std::shared_ptr<SharedBus> shared_bus, size_t core_number, EventCalendar& event_calendar)
+    : shared{std::move(shared_bus)}, core{core_number}, calendar{&event_calendar} {}
+
+    void simulate() override {
+        if (this->get_bus_mode() == RW::Read ||
+            this->get_bus_mode() == RW::Write) {
+            if (this->get_bus_address() >= Begin &&
+                this->get_bus_address() <= End) {
+                auto const address = this->get_bus_address();
+                shared->awake(core);
+
+                if (this->get_bus_mode() == RW::Read) {
+                    this->set_bus_data(shared->read(core, address - Begin));
+                    last_read_address = address;
+                    last_read_time = calendar->now();
+                } else if (address != last_read_address || calendar->now() != last_read_time + 1) {
+                    shared->write(core, address - Begin, this->get_bus_data());
+                }
+            }
+        }
+    }
+
+    int input_descriptor() const override {
+        return shared->wake_descriptor(core);
+    }
+};
+
+
+#endif //CS8_SHARED_BUS_HXX
@@ -0,0 +1,57 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "symbol_table.hxx"
+#include <elfio/elfio.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+SymbolTable::SymbolTable(std::filesystem::path const& file) {
+    ELFIO::elfio reader;
+    if (!reader.load(file)) throw std::runtime_error("Cannot load " + file.string());
+
+    for (auto const section : reader.sections) {
+        if (section->get_type() != SHT_SYMTAB) continue;
+
+        ELFIO::symbol_section_accessor symbols(reader, section);
+        for (ELFIO::Elf_Xword i = 0; i < symbols.get_symbols_num(); ++i) {
+            std::string name;
+            ELFIO::Elf64_Addr value;
+            ELFIO::Elf_Xword size;
+            unsigned char bind, type, other;
+            ELFIO::Elf_Half section_index;
+
+            symbols.get_symbol(i, name, value, size, bind, type, section_index, other);
+            if (type != STT_FUNC || name.empty()) continue;
+
+            functions.push_back({name, static_cast<uint16_t>(value), (other & 0x3) == STV_DEFAULT});
+        }
+    }
+
+    if (std::any_of(functions.begin(), functions.end(), [](auto const& f) { return f.global; })) {
+        std::erase_if(functions, [](auto const& f) { return !f.global; });
+    }
+
+    std::stable_sort(functions.begin(), functions.end(), [](auto const& a, auto const& b) {
+        return a.address < b.address;
+    });
+    // Several labels may share an address, keep the first one.
+    functions.erase(std::unique(functions.begin(), functions.end(), [](auto const& a, auto const& b) {
+        return a.address == b.address;
+    }), functions.end());
+}
+
+SymbolTable::Symbol const* SymbolTable::function_at(uint16_t address) const {
+    auto it = std::upper_bound(functions.begin(), functions.end(), address, [](uint16_t a, auto const& f) {
+        return a < f.address;
+    });
+    if (it == functions.begin()) return nullptr;
+    return &*std::prev(it);
+}
+
+SymbolTable::Symbol const* SymbolTable::function_starting_at(uint16_t address) const {
+    auto const* function = function_at(address);
+    if (function && function->address == address) return function;
+    return nullptr;
+}
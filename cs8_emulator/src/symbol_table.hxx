@@ -0,0 +1,57 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_SYMBOL_TABLE_HXX
+#define CS8_SYMBOL_TABLE_HXX
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * The code symbols of a program, read from the .symtab of its elf file.
+ *
+ * Functions are the global code symbols. If a program declares no global code symbol,
+ * every code label is treated as a function.
+ */
+class SymbolTable {
+public:
+    struct Symbol {
+        std::string name;
+        uint16_t address;
+        bool global;
+    };
+
+private:
+    ///! The functions, sorted by address.
+    std::vector<Symbol> functions;
+
+public:
+    SymbolTable() = default;
+
+    /**
+     * Read the symbols of the given elf file
+     * @throws std::runtime_error when the file cannot be loaded
+     */
+    explicit SymbolTable(std::filesystem::path const& file);
+
+    [[nodiscard]] std::vector<Symbol> const& get_functions() const {
+        return functions;
+    }
+
+    /**
+     * Find the function containing the address, the function with the closest start at or before it
+     */
+    [[nodiscard]] Symbol const* function_at(uint16_t address) const;
+
+    /**
+     * Find the function starting exactly at the address
+     */
+    [[nodiscard]] Symbol const* function_starting_at(uint16_t address) const;
+};
+
+
+#endif //CS8_SYMBOL_TABLE_HXX
@@ -0,0 +1,85 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "telemetry.hxx"
+#include "machine.hxx"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+TelemetryPublisher::TelemetryPublisher(std::string name) : name{std::move(name)} {
+    // Exclusive, two emulators publishing under one name would overwrite each other's state.
+    int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        throw std::runtime_error("Shared memory " + this->name + " exists, another emulator uses the name or one which "
+                                 "crashed left it behind");
+    }
+    if (fd < 0) throw std::runtime_error("Cannot create shared memory " + this->name);
+
+    if (ftruncate(fd, sizeof(TelemetryBlock)) != 0) {
+        close(fd);
+        shm_unlink(this->name.c_str());
+        throw std::runtime_error("Cannot resize shared memory " + this->name);
+    }
+
+    void* mapping = mmap(nullptr, sizeof(TelemetryBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(this->name.c_str());
+        throw std::runtime_error("Cannot map shared memory " + this->name);
+    }
+
+    // The segment is zero filled, which is a valid state for every atomic.
+    block = new (mapping) TelemetryBlock;
+    block->version.store(TelemetryBlock::version_value, std::memory_order_relaxed);
+    block->pid.store(getpid(), std::memory_order_relaxed);
+    block->running.store(1, std::memory_order_relaxed);
+    block->magic.store(TelemetryBlock::magic_value, std::memory_order_release);
+}
+
+TelemetryPublisher::~TelemetryPublisher() {
+    if (block) {
+        block->running.store(0, std::memory_order_release);
+        munmap(block, sizeof(TelemetryBlock));
+        shm_unlink(name.c_str());
+    }
+}
+
+void TelemetryPublisher::on_bus(RW mode, uint16_t address, uint16_t data) {
+    auto& entry = block->ring[ring_head % TelemetryBlock::ring_capacity];
+    entry.sequence.store(2 * ring_head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.transaction.store(static_cast<uint64_t>(mode) << 32 | static_cast<uint64_t>(address) << 16 | data,
+                            std::memory_order_relaxed);
+    entry.sequence.store(2 * ring_head + 2, std::memory_order_release);
+    block->ring_head.store(++ring_head, std::memory_order_release);
+}
+
+void TelemetryPublisher::publish(Machine const& machine) {
+    auto const registers = machine.cpu->get_registers();
+    char const* phase = machine.cpu->get_phase_name();
+
+    auto const sequence = block->sequence.load(std::memory_order_relaxed);
+    block->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < TelemetryBlock::register_count; ++i) {
+        block->registers[i].store(registers.values[i], std::memory_order_relaxed);
+    }
+    auto const length = std::min(std::strlen(phase), TelemetryBlock::phase_name_size - 1);
+    for (size_t i = 0; i < TelemetryBlock::phase_name_size; ++i) {
+        block->phase[i].store(i < length ? phase[i] : '\0', std::memory_order_relaxed);
+    }
+    block->cycles.store(machine.cpu->get_cycles(), std::memory_order_relaxed);
+    block->retired_instructions.store(machine.cpu->get_retired_instructions(), std::memory_order_relaxed);
+    block->serial_bytes.store(machine.serial_port->bytes_written, std::memory_order_relaxed);
+    block->running.store(machine.cpu->is_running() ? 1 : 0, std::memory_order_relaxed);
+
+    block->sequence.store(sequence + 2, std::memory_order_release);
+}
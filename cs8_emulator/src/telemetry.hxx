@@ -0,0 +1,51 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_TELEMETRY_HXX
+#define CS8_TELEMETRY_HXX
+
+#include "cpu_observer.hxx"
+#include "telemetry_block.hxx"
+#include <cstdint>
+#include <string>
+
+struct Machine;
+
+/**
+ * Publishes the state of a machine into a POSIX shared memory segment, see TelemetryBlock.
+ * The emulator thread never blocks on it, external monitors poll the segment.
+ */
+class TelemetryPublisher : public CPUObserver {
+    std::string name;
+    TelemetryBlock* block {nullptr};
+    uint64_t ring_head {0};
+
+public:
+    /**
+     * Create the shared memory segment
+     * @param name the name of the segment, e.g. "/cs8", it must not exist yet
+     * @throws std::runtime_error when the segment cannot be created or exists already
+     */
+    explicit TelemetryPublisher(std::string name);
+
+    TelemetryPublisher(TelemetryPublisher const&) = delete;
+    TelemetryPublisher& operator=(TelemetryPublisher const&) = delete;
+
+    /**
+     * Unmap and remove the segment
+     */
+    ~TelemetryPublisher() override;
+
+    [[nodiscard]] bool wants_registers() const override { return false; }
+
+    void on_bus(RW mode, uint16_t address, uint16_t data) override;
+
+    /**
+     * Publish the registers, phase and counters of the machine
+     */
+    void publish(Machine const& machine);
+};
+
+
+#endif //CS8_TELEMETRY_HXX
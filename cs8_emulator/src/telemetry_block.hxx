@@ -0,0 +1,142 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_TELEMETRY_BLOCK_HXX
+#define CS8_TELEMETRY_BLOCK_HXX
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * The fixed layout of the telemetry shared memory segment.
+ *
+ * The emulator is the only writer and uses relaxed atomic stores, which are plain stores on common hosts.
+ * The machine state is guarded by a sequence lock: the sequence is odd while the emulator updates it,
+ * readers retry until they see the same even sequence before and after copying the state. An emulator dying in the
+ * middle of an update leaves the sequence odd forever, so readers yield while it is odd and give up after
+ * snapshot_retries attempts.
+ * Bus transactions go to a ring, every entry carries the position it was written for, so readers can
+ * detect entries overwritten while they were read.
+ */
+struct TelemetryBlock {
+    static constexpr uint64_t magic_value = 0x314D4C4554385343; // "CS8TELM1"
+    static constexpr uint32_t version_value = 1;
+    static constexpr size_t register_count = 0x12;
+    static constexpr size_t ring_capacity = 1024;
+    static constexpr size_t phase_name_size = 16;
+    ///! An update takes well below a microsecond, a reader yielding this often saw a writer which stopped in it.
+    static constexpr size_t snapshot_retries = 1u << 20;
+
+    struct Snapshot {
+        std::array<int16_t, register_count> registers {};
+        std::string phase;
+        uint64_t cycles {0};
+        uint64_t retired_instructions {0};
+        uint64_t serial_bytes {0};
+        bool running {false};
+    };
+
+    struct BusEntry {
+        ///! 2 * position + 1 while the entry is written, 2 * position + 2 once it is complete.
+        std::atomic<uint64_t> sequence;
+        ///! mode << 32 | address << 16 | data
+        std::atomic<uint64_t> transaction;
+    };
+
+    struct BusTransaction {
+        uint64_t position;
+        uint8_t mode;
+        uint16_t address;
+        uint16_t data;
+    };
+
+    std::atomic<uint64_t> magic;
+    std::atomic<uint32_t> version;
+    std::atomic<int32_t> pid;
+
+    std::atomic<uint64_t> sequence;
+    std::array<std::atomic<int16_t>, register_count> registers;
+    std::array<std::atomic<char>, phase_name_size> phase;
+    std::atomic<uint64_t> cycles;
+    std::atomic<uint64_t> retired_instructions;
+    std::atomic<uint64_t> serial_bytes;
+    std::atomic<uint8_t> running;
+
+    ///! The number of bus transactions written so far.
+    std::atomic<uint64_t> ring_head;
+    std::array<BusEntry, ring_capacity> ring;
+
+    [[nodiscard]] bool valid() const {
+        return magic.load(std::memory_order_acquire) == magic_value &&
+               version.load(std::memory_order_relaxed) == version_value;
+    }
+
+    /**
+     * Copy a consistent state, waits while the emulator is updating it
+     * @return the state, std::nullopt if the block is stale because the emulator stopped in the middle of an update
+     */
+    [[nodiscard]] std::optional<Snapshot> read_snapshot() const {
+        Snapshot snapshot;
+        for (size_t attempt = 0; attempt < snapshot_retries; ++attempt) {
+            auto const before = sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (size_t i = 0; i < register_count; ++i) {
+                snapshot.registers[i] = registers[i].load(std::memory_order_relaxed);
+            }
+            snapshot.phase.clear();
+            for (auto const& c : phase) {
+                auto const value = c.load(std::memory_order_relaxed);
+                if (value == '\0') break;
+                snapshot.phase += value;
+            }
+            snapshot.cycles = cycles.load(std::memory_order_relaxed);
+            snapshot.retired_instructions = retired_instructions.load(std::memory_order_relaxed);
+            snapshot.serial_bytes = serial_bytes.load(std::memory_order_relaxed);
+            snapshot.running = running.load(std::memory_order_relaxed) != 0;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) return snapshot;
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * Copy the bus transactions written since the given position
+     * @param position the position of the first wanted transaction, updated to the next unread position
+     * @return the transactions, older ones are skipped if the ring wrapped around since
+     */
+    std::vector<BusTransaction> read_bus(uint64_t& position) const {
+        std::vector<BusTransaction> transactions;
+        auto const head = ring_head.load(std::memory_order_acquire);
+        if (head > ring_capacity && position < head - ring_capacity) position = head - ring_capacity;
+
+        for (; position < head; ++position) {
+            auto const& entry = ring[position % ring_capacity];
+            auto const expected = 2 * position + 2;
+            if (entry.sequence.load(std::memory_order_acquire) != expected) continue;
+            auto const value = entry.transaction.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.sequence.load(std::memory_order_relaxed) != expected) continue;
+
+            transactions.push_back({position, static_cast<uint8_t>(value >> 32),
+                                    static_cast<uint16_t>(value >> 16), static_cast<uint16_t>(value)});
+        }
+        return transactions;
+    }
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<int16_t>::is_always_lock_free,
+              "The telemetry block must be lock free to be shared between processes");
+
+
+#endif //CS8_TELEMETRY_BLOCK_HXX
@@ -0,0 +1,130 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_TRACE_FORMAT_HXX
+#define CS8_TRACE_FORMAT_HXX
+
+#include "cpu_observer.hxx"
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+/**
+ * The binary execution trace format.
+ *
+ * A trace file starts with a header, followed by blocks and ends with a block index:
+ *
+ *     header:  magic "CS8TRACE", u32 version
+ *     block:   u32 magic "BLCK", u64 first instruction, u32 instructions, u32 raw size, u32 compressed size,
+ *              zlib compressed records
+ *     index:   u32 magic "INDX", u32 blocks, per block u64 file offset and u64 first instruction
+ *     footer:  u64 offset of the index, magic "CS8TEND\0"
+ *
+ * Integers in headers are little endian. Records are delta encoded against the previous record of the same
+ * block, every block starts from a zeroed state so it can be decoded on its own:
+ *
+ *     varint  zigzag(address - previous address)
+ *     u8      opcode
+ *     varint  cycles
+ *     varint  mask of the changed registers, then per changed register varint zigzag(new - old)
+ *     u8      bus transactions, then per transaction u8 mode, varint address, varint data
+ */
+namespace trace_format {
+    constexpr std::string_view file_magic = "CS8TRACE";
+    constexpr std::string_view footer_magic {"CS8TEND\0", 8};
+    constexpr uint32_t version = 1;
+    constexpr uint32_t block_magic = 0x4B434C42; // "BLCK"
+    constexpr uint32_t index_magic = 0x58444E49; // "INDX"
+
+    constexpr size_t file_header_size = 12;
+    constexpr size_t block_header_size = 24;
+    constexpr size_t footer_size = 16;
+
+    struct BusTransaction {
+        RW mode;
+        uint16_t address;
+        uint16_t data;
+    };
+
+    struct Record {
+        uint64_t index {0};
+        uint16_t address {0};
+        uint8_t opcode {0};
+        uint64_t cycles {0};
+        ///! The registers changed by the instruction.
+        uint32_t changed {0};
+        CPURegisters registers;
+        std::vector<BusTransaction> bus;
+    };
+
+    struct BlockHeader {
+        uint64_t first_instruction {0};
+        uint32_t instructions {0};
+        uint32_t raw_size {0};
+        uint32_t compressed_size {0};
+    };
+
+    inline uint64_t zigzag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    inline void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    template<typename T>
+    void put_le(std::vector<uint8_t>& out, T value) {
+        for (size_t i = 0; i < sizeof(T); ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    /**
+     * Reads the encoded values of a buffer.
+     */
+    class Cursor {
+        uint8_t const* position;
+        uint8_t const* end;
+
+    public:
+        Cursor(uint8_t const* begin, uint8_t const* end) : position{begin}, end{end} {}
+
+        [[nodiscard]] bool at_end() const {
+            return position == end;
+        }
+
+        uint8_t byte() {
+            if (position == end) throw std::runtime_error("Truncated trace");
+            return *position++;
+        }
+
+        uint64_t varint() {
+            uint64_t value = 0;
+            for (unsigned shift = 0; shift < 64; shift += 7) {
+                auto const b = byte();
+                value |= static_cast<uint64_t>(b & 0x7F) << shift;
+                if (!(b & 0x80)) return value;
+            }
+            throw std::runtime_error("Invalid varint in trace");
+        }
+
+        template<typename T>
+        T le() {
+            T value = 0;
+            for (size_t i = 0; i < sizeof(T); ++i) value |= static_cast<T>(byte()) << (8 * i);
+            return value;
+        }
+    };
+}
+
+
+#endif //CS8_TRACE_FORMAT_HXX
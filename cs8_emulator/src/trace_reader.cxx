@@ -0,0 +1,147 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "trace_reader.hxx"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+
+using namespace trace_format;
+
+TraceReader::TraceReader(std::filesystem::path const& file) : input{file, std::ios::in | std::ios::binary} {
+    if (!input) throw std::runtime_error("Cannot open trace " + file.string());
+
+    std::string magic(file_magic.size(), '\0');
+    input.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+    if (!input || magic != file_magic) throw std::runtime_error("Not a cs8 trace: " + file.string());
+
+    uint8_t version_bytes[4];
+    input.read(reinterpret_cast<char*>(version_bytes), 4);
+    if (Cursor(version_bytes, version_bytes + 4).le<uint32_t>() != version) {
+        throw std::runtime_error("Unsupported trace version: " + file.string());
+    }
+
+    read_index();
+}
+
+void TraceReader::read_index() {
+    input.seekg(0, std::ios::end);
+    auto const file_size = static_cast<uint64_t>(input.tellg());
+    if (file_size < file_header_size + footer_size) return scan_blocks();
+
+    std::vector<uint8_t> footer(footer_size);
+    input.seekg(static_cast<std::streamoff>(file_size - footer_size));
+    input.read(reinterpret_cast<char*>(footer.data()), static_cast<std::streamsize>(footer.size()));
+    if (!std::equal(footer_magic.begin(), footer_magic.end(), footer.begin() + 8)) return scan_blocks();
+
+    auto const index_offset = Cursor(footer.data(), footer.data() + 8).le<uint64_t>();
+    if (index_offset + 8 > file_size - footer_size) throw std::runtime_error("Invalid trace index");
+
+    std::vector<uint8_t> index(file_size - footer_size - index_offset);
+    input.seekg(static_cast<std::streamoff>(index_offset));
+    input.read(reinterpret_cast<char*>(index.data()), static_cast<std::streamsize>(index.size()));
+
+    Cursor cursor(index.data(), index.data() + index.size());
+    if (cursor.le<uint32_t>() != index_magic) throw std::runtime_error("Invalid trace index");
+    auto const count = cursor.le<uint32_t>();
+    for (uint32_t i = 0; i < count; ++i) {
+        auto const offset = cursor.le<uint64_t>();
+        cursor.le<uint64_t>();
+        blocks.push_back({offset, read_block_header(offset)});
+    }
+}
+
+void TraceReader::scan_blocks() {
+    input.clear();
+    input.seekg(0, std::ios::end);
+    auto const file_size = static_cast<uint64_t>(input.tellg());
+
+    uint64_t offset = file_header_size;
+    while (offset + block_header_size <= file_size) {
+        BlockHeader header;
+        try {
+            header = read_block_header(offset);
+        } catch (std::runtime_error const&) {
+            break;
+        }
+        if (offset + block_header_size + header.compressed_size > file_size) break;
+        blocks.push_back({offset, header});
+        offset += block_header_size + header.compressed_size;
+    }
+}
+
+BlockHeader TraceReader::read_block_header(uint64_t offset) {
+    uint8_t bytes[block_header_size];
+    input.clear();
+    input.seekg(static_cast<std::streamoff>(offset));
+    input.read(reinterpret_cast<char*>(bytes), block_header_size);
+    if (!input) throw std::runtime_error("Truncated trace block");
+
+    Cursor cursor(bytes, bytes + block_header_size);
+    if (cursor.le<uint32_t>() != block_magic) throw std::runtime_error("Invalid trace block");
+
+    BlockHeader header;
+    header.first_instruction = cursor.le<uint64_t>();
+    header.instructions = cursor.le<uint32_t>();
+    header.raw_size = cursor.le<uint32_t>();
+    header.compressed_size = cursor.le<uint32_t>();
+    return header;
+}
+
+std::vector<uint8_t> TraceReader::read_block(Block const& block) {
+    std::vector<uint8_t> compressed(block.header.compressed_size);
+    input.clear();
+    input.seekg(static_cast<std::streamoff>(block.offset + block_header_size));
+    input.read(reinterpret_cast<char*>(compressed.data()), static_cast<std::streamsize>(compressed.size()));
+    if (!input) throw std::runtime_error("Truncated trace block");
+
+    std::vector<uint8_t> raw(block.header.raw_size);
+    uLongf raw_size = raw.size();
+    if (uncompress(raw.data(), &raw_size, compressed.data(), compressed.size()) != Z_OK || raw_size != raw.size()) {
+        throw std::runtime_error("Corrupt trace block");
+    }
+    return raw;
+}
+
+uint64_t TraceReader::size() const {
+    if (blocks.empty()) return 0;
+    return blocks.back().header.first_instruction + blocks.back().header.instructions;
+}
+
+void TraceReader::for_each(uint64_t first, std::function<bool(Record const&)> const& f) {
+    // The last block starting at or before the requested instruction.
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), first, [](uint64_t index, Block const& block) {
+        return index < block.header.first_instruction;
+    });
+    if (it != blocks.begin()) --it;
+
+    for (; it != blocks.end(); ++it) {
+        auto const raw = read_block(*it);
+        Cursor cursor(raw.data(), raw.data() + raw.size());
+
+        Record record;
+        record.index = it->header.first_instruction;
+        for (uint32_t i = 0; i < it->header.instructions; ++i, ++record.index) {
+            record.address = static_cast<uint16_t>(record.address + unzigzag(cursor.varint()));
+            record.opcode = cursor.byte();
+            record.cycles = cursor.varint();
+            record.changed = static_cast<uint32_t>(cursor.varint());
+            for (size_t r = 0; r < CPURegisters::count; ++r) {
+                if (record.changed & (1u << r)) {
+                    record.registers.values[r] = static_cast<int16_t>(record.registers.values[r] + unzigzag(cursor.varint()));
+                }
+            }
+            record.bus.resize(cursor.byte());
+            for (auto& transaction : record.bus) {
+                transaction.mode = static_cast<RW>(cursor.byte());
+                transaction.address = static_cast<uint16_t>(cursor.varint());
+                transaction.data = static_cast<uint16_t>(cursor.varint());
+            }
+
+            if (record.index < first) continue;
+            if (!f(record)) return;
+        }
+    }
+}
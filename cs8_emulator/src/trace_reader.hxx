@@ -0,0 +1,53 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_TRACE_READER_HXX
+#define CS8_TRACE_READER_HXX
+
+#include "trace_format.hxx"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+/**
+ * Decodes a trace written by TraceWriter, see trace_format.hxx.
+ */
+class TraceReader {
+    struct Block {
+        uint64_t offset;
+        trace_format::BlockHeader header;
+    };
+
+    std::ifstream input;
+    std::vector<Block> blocks;
+
+    void read_index();
+    void scan_blocks();
+    trace_format::BlockHeader read_block_header(uint64_t offset);
+    std::vector<uint8_t> read_block(Block const& block);
+
+public:
+    /**
+     * Open a trace, traces without index (e.g. of a crashed emulator) are scanned block by block
+     * @throws std::runtime_error when the file is no trace
+     */
+    explicit TraceReader(std::filesystem::path const& file);
+
+    /**
+     * The number of recorded instructions
+     */
+    [[nodiscard]] uint64_t size() const;
+
+    /**
+     * Decode the records starting at the given instruction index
+     * @param first the index of the first record
+     * @param f called for every record until it returns false
+     */
+    void for_each(uint64_t first, std::function<bool(trace_format::Record const&)> const& f);
+};
+
+
+#endif //CS8_TRACE_READER_HXX
@@ -0,0 +1,202 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "trace_writer.hxx"
+#include <stdexcept>
+#include <zlib.h>
+
+using namespace trace_format;
+
+TraceWriter::TraceWriter(std::filesystem::path const& file, size_t block_size)
+        : output{file, std::ios::out | std::ios::binary | std::ios::trunc}, block_size{block_size} {
+    if (!output) throw std::runtime_error("Cannot create trace " + file.string());
+
+    std::vector<uint8_t> header(file_magic.begin(), file_magic.end());
+    put_le<uint32_t>(header, version);
+    output.write(reinterpret_cast<char const*>(header.data()), static_cast<std::streamsize>(header.size()));
+
+    current.reserve(block_size + 256);
+    worker = std::thread(&TraceWriter::work, this);
+}
+
+TraceWriter::~TraceWriter() {
+    // Destructors must not throw, a caller interested in errors closes the trace itself.
+    try {
+        close();
+    } catch (std::exception const&) {
+    }
+}
+
+void TraceWriter::on_bus(RW mode, uint16_t address, uint16_t data) {
+    bus.push_back({mode, address, data});
+}
+
+void TraceWriter::on_retire(uint16_t address, uint8_t opcode, uint64_t cycles, CPURegisters const& registers) {
+    if (closing) return;
+
+    if (current_header.instructions == 0) {
+        current_header.first_instruction = instructions;
+        previous = {};
+        previous_address = 0;
+    }
+
+    put_varint(current, zigzag(static_cast<int64_t>(address) - previous_address));
+    current.push_back(opcode);
+    put_varint(current, cycles);
+
+    uint32_t mask = 0;
+    for (size_t i = 0; i < CPURegisters::count; ++i) {
+        if (registers.values[i] != previous.values[i]) mask |= 1u << i;
+    }
+    put_varint(current, mask);
+    for (size_t i = 0; i < CPURegisters::count; ++i) {
+        if (mask & (1u << i)) {
+            put_varint(current, zigzag(static_cast<int64_t>(registers.values[i]) - previous.values[i]));
+        }
+    }
+
+    current.push_back(static_cast<uint8_t>(bus.size()));
+    for (auto const& transaction : bus) {
+        current.push_back(static_cast<uint8_t>(transaction.mode));
+        put_varint(current, transaction.address);
+        put_varint(current, transaction.data);
+    }
+    bus.clear();
+
+    previous = registers;
+    previous_address = address;
+    ++current_header.instructions;
+    ++instructions;
+
+    if (current.size() >= block_size) {
+        submit();
+        rethrow_error();
+    }
+}
+
+void TraceWriter::rethrow_error() {
+    std::lock_guard lock(mutex);
+    if (error) std::rethrow_exception(error);
+}
+
+void TraceWriter::submit() {
+    if (current_header.instructions == 0) return;
+
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [this] { return pending.size() < max_pending_blocks; });
+
+    current_header.raw_size = static_cast<uint32_t>(current.size());
+    pending.push_back({current_header, std::move(current)});
+    if (!spare_buffers.empty()) {
+        current = std::move(spare_buffers.back());
+        spare_buffers.pop_back();
+    } else {
+        current = {};
+        current.reserve(block_size + 256);
+    }
+    current.clear();
+    current_header = {};
+    changed.notify_all();
+}
+
+void TraceWriter::work() {
+    for (;;) {
+        Block block;
+        {
+            std::unique_lock lock(mutex);
+            changed.wait(lock, [this] { return !pending.empty() || closing; });
+            if (pending.empty()) break;
+            block = std::move(pending.front());
+            pending.pop_front();
+            writing = true;
+            changed.notify_all();
+        }
+
+        // Exceptions must not leave the thread, the emulator thread rethrows them.
+        std::exception_ptr failure;
+        if (!error) {
+            try {
+                write_block(block);
+            } catch (std::exception const&) {
+                failure = std::current_exception();
+            }
+        }
+
+        std::lock_guard lock(mutex);
+        if (failure) error = failure;
+        writing = false;
+        spare_buffers.push_back(std::move(block.data));
+        changed.notify_all();
+    }
+
+    if (error) return;
+    try {
+        write_index();
+    } catch (std::exception const&) {
+        std::lock_guard lock(mutex);
+        error = std::current_exception();
+    }
+}
+
+void TraceWriter::write_index() {
+    std::vector<uint8_t> trailer;
+    auto const index_offset = static_cast<uint64_t>(output.tellp());
+    put_le<uint32_t>(trailer, index_magic);
+    put_le<uint32_t>(trailer, static_cast<uint32_t>(index.size()));
+    for (auto const& [offset, first] : index) {
+        put_le<uint64_t>(trailer, offset);
+        put_le<uint64_t>(trailer, first);
+    }
+    put_le<uint64_t>(trailer, index_offset);
+    trailer.insert(trailer.end(), footer_magic.begin(), footer_magic.end());
+    output.write(reinterpret_cast<char const*>(trailer.data()), static_cast<std::streamsize>(trailer.size()));
+    output.flush();
+    if (!output) throw std::runtime_error("Cannot write trace index");
+}
+
+void TraceWriter::write_block(Block const& block) {
+    uLongf compressed_size = compressBound(block.data.size());
+    std::vector<uint8_t> compressed(compressed_size);
+    if (compress2(compressed.data(), &compressed_size, block.data.data(), block.data.size(), Z_BEST_SPEED) != Z_OK) {
+        throw std::runtime_error("Cannot compress trace block");
+    }
+
+    std::vector<uint8_t> header;
+    put_le<uint32_t>(header, block_magic);
+    put_le<uint64_t>(header, block.header.first_instruction);
+    put_le<uint32_t>(header, block.header.instructions);
+    put_le<uint32_t>(header, block.header.raw_size);
+    put_le<uint32_t>(header, static_cast<uint32_t>(compressed_size));
+
+    index.emplace_back(static_cast<uint64_t>(output.tellp()), block.header.first_instruction);
+    output.write(reinterpret_cast<char const*>(header.data()), static_cast<std::streamsize>(header.size()));
+    output.write(reinterpret_cast<char const*>(compressed.data()), static_cast<std::streamsize>(compressed_size));
+    if (!output) throw std::runtime_error("Cannot write trace block");
+}
+
+void TraceWriter::flush() {
+    if (!worker.joinable()) {
+        rethrow_error();
+        return;
+    }
+
+    submit();
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [this] { return (pending.empty() && !writing) || error; });
+    if (error) std::rethrow_exception(error);
+    output.flush();
+}
+
+void TraceWriter::close() {
+    if (!worker.joinable()) return;
+
+    submit();
+    {
+        std::lock_guard lock(mutex);
+        closing = true;
+    }
+    changed.notify_all();
+    worker.join();
+    rethrow_error();
+}
@@ -0,0 +1,99 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_TRACE_WRITER_HXX
+#define CS8_TRACE_WRITER_HXX
+
+#include "cpu_observer.hxx"
+#include "trace_format.hxx"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Records the execution of the CPU into a binary trace file, see trace_format.hxx.
+ *
+ * The emulator thread only encodes records into a block buffer. Full blocks are handed to a background
+ * thread which compresses and writes them, at most max_pending_blocks wait for it at any time. An error of the
+ * background thread stops the trace and is rethrown on the emulator thread by the next full block, flush or close.
+ */
+class TraceWriter : public CPUObserver {
+    struct Block {
+        trace_format::BlockHeader header;
+        std::vector<uint8_t> data;
+    };
+
+    static constexpr size_t max_pending_blocks = 4;
+
+    std::ofstream output;
+    size_t block_size;
+
+    std::vector<uint8_t> current;
+    trace_format::BlockHeader current_header;
+    uint64_t instructions {0};
+    CPURegisters previous;
+    uint16_t previous_address {0};
+    std::vector<trace_format::BusTransaction> bus;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Block> pending;
+    std::vector<std::vector<uint8_t>> spare_buffers;
+    bool closing {false};
+    ///! Set while the worker writes a block it took from pending.
+    bool writing {false};
+    ///! The first error of the worker, it writes nothing after it.
+    std::exception_ptr error;
+
+    ///! File offset and first instruction of every written block, only used by the worker.
+    std::vector<std::pair<uint64_t, uint64_t>> index;
+    std::thread worker;
+
+    void submit();
+    void work();
+    void write_block(Block const& block);
+    void write_index();
+    void rethrow_error();
+
+public:
+    /**
+     * Create the trace file
+     * @param file the path of the trace
+     * @param block_size the size of the uncompressed blocks in bytes
+     * @throws std::runtime_error when the file cannot be created
+     */
+    explicit TraceWriter(std::filesystem::path const& file, size_t block_size = 256 * 1024);
+
+    TraceWriter(TraceWriter const&) = delete;
+    TraceWriter& operator=(TraceWriter const&) = delete;
+
+    ~TraceWriter() override;
+
+    /**
+     * @throws std::runtime_error when the trace cannot be written
+     */
+    void on_retire(uint16_t address, uint8_t opcode, uint64_t cycles, CPURegisters const& registers) override;
+    void on_bus(RW mode, uint16_t address, uint16_t data) override;
+
+    /**
+     * Write the records so far to the file
+     * @throws std::runtime_error when the trace cannot be written
+     */
+    void flush();
+
+    /**
+     * Write the remaining records and the block index, further records are dropped
+     * @throws std::runtime_error when the trace cannot be written
+     */
+    void close();
+};
+
+
+#endif //CS8_TRACE_WRITER_HXX
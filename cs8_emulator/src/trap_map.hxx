@@ -0,0 +1,87 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#ifndef CS8_TRAP_MAP_HXX
+#define CS8_TRAP_MAP_HXX
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * What stops the CPU at an address: executing the instruction there, or an instruction reading or writing it.
+ */
+enum class TrapKind : uint8_t {
+    Breakpoint = 1,
+    Read = 2,
+    Write = 4
+};
+
+/**
+ * A breakpoint or watchpoint the CPU stopped at.
+ */
+struct Trap {
+    TrapKind kind;
+    ///! The breakpoint or the watched address.
+    uint16_t address;
+    ///! The instruction which hit the trap, it has not executed for a breakpoint and has retired for a watchpoint.
+    uint16_t instruction_address;
+    ///! The value read or written, 0 for a breakpoint.
+    uint16_t data;
+};
+
+/**
+ * The breakpoints and watchpoints of a CPU, as one bit per address and kind.
+ *
+ * Every page of 256 addresses has a flag per kind set while any address of the page has a trap of that kind, so an
+ * access to an unmarked page costs one table lookup. Only accesses to marked pages test the bit of their address.
+ */
+class TrapMap {
+    static constexpr size_t page_bits = 8;
+    static constexpr size_t words_per_page = (size_t{1} << page_bits) / 64;
+
+    std::array<uint8_t, (65536 >> page_bits)> page_flags {};
+    ///! Per kind, indexed by the bit number of the kind.
+    std::array<std::array<uint64_t, 65536 / 64>, 3> bits {};
+
+    static size_t index(TrapKind kind) {
+        return std::countr_zero(static_cast<unsigned>(kind));
+    }
+
+public:
+    /**
+     * Whether the address has a trap of the kind
+     */
+    [[nodiscard]] bool contains(TrapKind kind, uint16_t address) const {
+        if (!(page_flags[address >> page_bits] & static_cast<uint8_t>(kind))) return false;
+        return bits[index(kind)][address >> 6] >> (address & 63) & 1;
+    }
+
+    void set(TrapKind kind, uint16_t address) {
+        bits[index(kind)][address >> 6] |= uint64_t{1} << (address & 63);
+        page_flags[address >> page_bits] |= static_cast<uint8_t>(kind);
+    }
+
+    void clear(TrapKind kind, uint16_t address) {
+        auto& words = bits[index(kind)];
+        words[address >> 6] &= ~(uint64_t{1} << (address & 63));
+
+        auto const page = address >> page_bits;
+        auto const first = words.begin() + page * words_per_page;
+        if (std::all_of(first, first + words_per_page, [](uint64_t word) { return word == 0; })) {
+            page_flags[page] &= ~static_cast<uint8_t>(kind);
+        }
+    }
+
+    /**
+     * Whether no address has any trap
+     */
+    [[nodiscard]] bool empty() const {
+        return std::all_of(page_flags.begin(), page_flags.end(), [](uint8_t flags) { return flags == 0; });
+    }
+};
+
+#endif //CS8_TRAP_MAP_HXX
@@ -0,0 +1,98 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "coverage_map.hxx"
+#include "line_table.hxx"
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+static void usage(std::ostream& os) {
+    os << "usage: cs8_coverage <program> <coverage>... [-o FILE]\n"
+          "  joins the coverage files written by cs8_emulator --coverage with the line table of the program\n"
+          "  -o FILE        write the lcov tracefile to FILE instead of stdout\n";
+}
+
+/**
+ * Write an lcov tracefile, a line is hit once for every coverage file which executed any of its instructions
+ */
+static void write_lcov(std::ostream& os, LineTable const& table, std::vector<CoverageMap> const& runs) {
+    // file -> line -> hits, ordered so the tracefile is the same for the same input.
+    std::map<uint16_t, std::map<uint32_t, uint64_t>> hits;
+    std::set<std::pair<uint16_t, uint32_t>> hit_in_run;
+    for (auto const& line : table.get_lines()) hits[line.file][line.line];
+
+    for (auto const& run : runs) {
+        hit_in_run.clear();
+        for (auto const& line : table.get_lines()) {
+            if (run.executed(line.address) && hit_in_run.insert({line.file, line.line}).second) {
+                ++hits[line.file][line.line];
+            }
+        }
+    }
+
+    os << "TN:\n";
+    for (auto const& [file, lines] : hits) {
+        uint64_t hit_lines = 0;
+        os << "SF:" << table.get_files()[file] << '\n';
+        for (auto const& [line, count] : lines) {
+            os << "DA:" << line << ',' << count << '\n';
+            if (count) ++hit_lines;
+        }
+        os << "LF:" << lines.size() << '\n'
+           << "LH:" << hit_lines << '\n'
+           << "end_of_record\n";
+    }
+}
+
+int main(int argc, const char* argv[]) {
+    std::optional<std::string> program;
+    std::vector<std::string> coverage_files;
+    std::optional<std::string> output_file;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view argument = argv[i];
+        if (argument == "-o" && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if (argument == "--help") {
+            usage(std::cout);
+            return 0;
+        } else if (!program.has_value()) {
+            program = argument;
+        } else {
+            coverage_files.emplace_back(argument);
+        }
+    }
+    if (!program.has_value() || coverage_files.empty()) {
+        usage(std::cerr);
+        return 1;
+    }
+
+    try {
+        LineTable const table(*program);
+        if (table.get_lines().empty()) throw std::runtime_error(*program + " has no line table");
+
+        std::vector<CoverageMap> runs;
+        runs.reserve(coverage_files.size());
+        for (auto const& file : coverage_files) runs.emplace_back(file);
+
+        if (output_file.has_value()) {
+            std::ofstream output(*output_file);
+            write_lcov(output, table, runs);
+            if (!output) throw std::runtime_error("Cannot write " + *output_file);
+        } else {
+            write_lcov(std::cout, table, runs);
+        }
+    } catch (std::exception const& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,219 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+// A command console for debugging a guest with breakpoints and watchpoints, reading commands from stdin. The console
+// records history from the start, so the guest also runs backwards.
+
+#include "cs8emu.hxx"
+#include "symbol_table.hxx"
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    void usage(std::ostream& os) {
+        os << "usage: cs8_debug <program>\n"
+              "commands:\n"
+              "  break ADDR            stop before the instruction at ADDR\n"
+              "  delete ADDR           remove the breakpoint at ADDR\n"
+              "  watch ADDR [r|w|rw]   stop after an instruction reads or writes ADDR, w if not given\n"
+              "  unwatch ADDR [r|w|rw] remove the watchpoint at ADDR\n"
+              "  continue              run until a trap, a halt or the guest waits for input\n"
+              "  step [N]              run N instructions, 1 if not given\n"
+              "  reverse-continue      run backwards to the last trap hit before\n"
+              "  reverse-step [N]      run N instructions backwards, 1 if not given\n"
+              "  record N [BYTES]      take a checkpoint every N instructions within BYTES, starting over\n"
+              "  regs                  print the registers\n"
+              "  mem ADDR [N]          print N memory cells from ADDR on, 8 if not given\n"
+              "  input TEXT            append the line TEXT to the serial input\n"
+              "  eof                   close the serial input\n"
+              "  quit\n"
+              "ADDR is a number or the name of a function\n";
+    }
+
+    ///! The checkpoint interval and budget to start with, a backwards step replays up to this many instructions.
+    constexpr uint64_t default_interval = 10000;
+    constexpr size_t default_budget = size_t{64} << 20;
+
+    class Console {
+        Emulator emulator;
+        std::optional<SymbolTable> symbols;
+
+        [[nodiscard]] uint16_t address_of(std::string const& text) const {
+            if (symbols) {
+                for (auto const& function : symbols->get_functions()) {
+                    if (function.name == text) return function.address;
+                }
+            }
+            std::size_t end = 0;
+            auto const value = std::stoul(text, &end, 0);
+            if (end != text.size() || value > UINT16_MAX) throw std::invalid_argument("Bad address: " + text);
+            return static_cast<uint16_t>(value);
+        }
+
+        static std::string hex(uint16_t value) {
+            std::ostringstream os;
+            os << "0x" << std::hex << std::setw(4) << std::setfill('0') << value;
+            return os.str();
+        }
+
+        /// An instruction address with the function containing it.
+        [[nodiscard]] std::string describe(uint16_t address) const {
+            std::ostringstream os;
+            os << hex(address);
+            if (auto const* function = symbols ? symbols->function_at(address) : nullptr) {
+                os << " <" << function->name;
+                if (function->address != address) os << "+0x" << address - function->address;
+                os << '>';
+            }
+            return os.str();
+        }
+
+        static std::vector<TrapKind> accesses(std::string const& text) {
+            if (text.empty() || text == "w") return {TrapKind::Write};
+            if (text == "r") return {TrapKind::Read};
+            if (text == "rw") return {TrapKind::Read, TrapKind::Write};
+            throw std::invalid_argument("Bad access: " + text);
+        }
+
+        void print_output() {
+            auto& output = emulator.serial().output;
+            if (output.empty()) return;
+            std::cout << output;
+            if (output.back() != '\n') std::cout << '\n';
+            output.clear();
+        }
+
+        void print_stop(Emulator::StopReason reason) {
+            print_output();
+            switch (reason) {
+                case Emulator::StopReason::Halted:
+                    std::cout << "Halted";
+                    if (auto const& code = emulator.machine().exit_code) std::cout << " with exit code " << *code;
+                    std::cout << '\n';
+                    return;
+                case Emulator::StopReason::Idle:
+                    std::cout << "Waiting for input\n";
+                    return;
+                case Emulator::StopReason::Trap: {
+                    auto const trap = *emulator.trap();
+                    if (trap.kind == TrapKind::Breakpoint) {
+                        std::cout << "Breakpoint at " << describe(trap.address) << '\n';
+                    } else {
+                        std::cout << (trap.kind == TrapKind::Read ? "Read " : "Wrote ") << hex(trap.data)
+                                  << (trap.kind == TrapKind::Read ? " from " : " to ") << hex(trap.address)
+                                  << " at " << describe(trap.instruction_address) << '\n';
+                    }
+                    break;
+                }
+                case Emulator::StopReason::HistoryStart:
+                    std::cout << "Reached the oldest checkpoint\n";
+                    break;
+                case Emulator::StopReason::InstructionLimit:
+                case Emulator::StopReason::CycleLimit:
+                    break;
+            }
+            std::cout << "ip " << describe(static_cast<uint16_t>(emulator.registers().values[CPURegisters::ip])) << '\n';
+        }
+
+        void print_registers() const {
+            auto const registers = emulator.registers();
+            for (size_t r = 0; r < CPURegisters::count; ++r) {
+                std::cout << CPURegisters::name(r) << '=' << hex(registers.values[r]) << (r % 6 == 5 ? '\n' : ' ');
+            }
+        }
+
+        void print_memory(uint16_t address, size_t count) const {
+            std::vector<Emulator::Word> cells(count);
+            emulator.read_memory(address, cells);
+            for (size_t i = 0; i < count; ++i) {
+                if (i % 8 == 0) std::cout << (i ? "\n" : "") << hex(address + i) << ':';
+                std::cout << ' ' << hex(cells[i]);
+            }
+            std::cout << '\n';
+        }
+
+    public:
+        explicit Console(std::string const& program) : emulator{program} {
+            emulator.record_history(default_interval, default_budget);
+            try {
+                symbols.emplace(program);
+            } catch (std::runtime_error const&) {
+                // Flat images have no symbols, addresses are numbers then.
+            }
+        }
+
+        /// Execute a command, false to quit.
+        bool execute(std::string const& line) {
+            std::istringstream words(line);
+            std::string command, argument, option;
+            words >> command >> argument >> option;
+
+            if (command.empty()) {
+            } else if (command == "quit" || command == "q") {
+                return false;
+            } else if (command == "break" || command == "b") {
+                emulator.set_breakpoint(address_of(argument));
+            } else if (command == "delete" || command == "d") {
+                emulator.clear_breakpoint(address_of(argument));
+            } else if (command == "watch" || command == "w") {
+                for (auto access : accesses(option)) emulator.set_watchpoint(address_of(argument), access);
+            } else if (command == "unwatch") {
+                for (auto access : accesses(option)) emulator.clear_watchpoint(address_of(argument), access);
+            } else if (command == "continue" || command == "c") {
+                print_stop(emulator.run());
+            } else if (command == "step" || command == "s") {
+                print_stop(emulator.run_instructions(argument.empty() ? 1 : std::stoull(argument, nullptr, 0)));
+            } else if (command == "reverse-continue" || command == "rc") {
+                print_stop(emulator.reverse_continue());
+            } else if (command == "reverse-step" || command == "rs") {
+                print_stop(emulator.reverse_step(argument.empty() ? 1 : std::stoull(argument, nullptr, 0)));
+            } else if (command == "record") {
+                emulator.record_history(std::stoull(argument, nullptr, 0),
+                                        option.empty() ? default_budget : std::stoull(option, nullptr, 0));
+            } else if (command == "regs" || command == "r") {
+                print_registers();
+            } else if (command == "mem" || command == "x") {
+                print_memory(address_of(argument), option.empty() ? 8 : std::stoul(option, nullptr, 0));
+            } else if (command == "input") {
+                auto const start = line.find_first_not_of(' ', line.find("input") + 5);
+                emulator.serial().input += (start == std::string::npos ? "" : line.substr(start)) + '\n';
+            } else if (command == "eof") {
+                emulator.serial().input_closed = true;
+            } else if (command == "help") {
+                usage(std::cout);
+            } else {
+                std::cout << "Unknown command " << command << ", try help\n";
+            }
+            return true;
+        }
+    };
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 2) {
+        usage(std::cerr);
+        return 2;
+    }
+
+    try {
+        Console console(argv[1]);
+        std::string line;
+        while (std::cout << "(cs8) " << std::flush, std::getline(std::cin, line)) {
+            try {
+                if (!console.execute(line)) break;
+            } catch (std::logic_error const& e) {
+                // Bad arguments and addresses out of memory, the session goes on.
+                std::cout << e.what() << '\n';
+            }
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "cs8_debug: " << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,98 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+// Fuzzes a guest program through its serial input. One machine runs every input, before each it is reset to the state
+// after loading the program and its memory to an in-memory snapshot, so only the pages an input wrote are mapped anew.
+//
+// The program comes from CS8_FUZZ_PROGRAM, CS8_FUZZ_MAX_INSTRUCTIONS bounds a run (default 1000000). A guest writing
+// an exit code other than 0 to the host call device is a finding. Built with CS8_LIBFUZZER the edges taken by the guest
+// are libFuzzer's extra counters, otherwise main runs the inputs given on the command line, for reproducing findings.
+
+#include "cs8emu.hxx"
+#include "edge_coverage.hxx"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#ifdef CS8_LIBFUZZER
+__attribute__((used, section("__libfuzzer_extra_counters")))
+#endif
+static std::array<uint8_t, 1u << 16> edge_counters;
+
+namespace {
+    struct Target {
+        ProgramImage program;
+        ///! The memory after loading the program, the machine shares its pages until it writes to them.
+        std::shared_ptr<PageImage const> memory;
+        EdgeCoverage coverage {edge_counters};
+        Emulator emulator {program, memory};
+        ///! The state of the machine before it ran, every input starts from it.
+        Machine::State initial_state {emulator.machine().save_state()};
+
+        Target(char const* program_file, uint64_t instruction_budget)
+        : program{program_file}, memory{load_memory_image(program)} {
+            auto& cpu = *emulator.machine().cpu;
+            cpu.set_observer(&coverage);
+            cpu.instruction_budget = instruction_budget;
+        }
+    };
+
+    std::unique_ptr<Target> target;
+
+    void load_target() {
+        char const* program_file = std::getenv("CS8_FUZZ_PROGRAM");
+        if (!program_file) {
+            std::fputs("CS8_FUZZ_PROGRAM has to name the program to fuzz\n", stderr);
+            std::exit(1);
+        }
+        char const* budget = std::getenv("CS8_FUZZ_MAX_INSTRUCTIONS");
+        target = std::make_unique<Target>(program_file, budget ? std::stoull(budget) : 1000000);
+    }
+}
+
+extern "C" int LLVMFuzzerInitialize(int*, char***) {
+    load_target();
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size) {
+    auto& emulator = target->emulator;
+    emulator.reset(target->initial_state, target->memory);
+
+    emulator.serial().input.assign(reinterpret_cast<char const*>(data), size);
+    emulator.serial().input_closed = true;
+    emulator.run();
+
+    auto const& exit_code = emulator.machine().exit_code;
+    if (exit_code.has_value() && *exit_code != 0) {
+        std::fprintf(stderr, "The guest exited with %u\n", *exit_code);
+        std::abort();
+    }
+    return 0;
+}
+
+#ifndef CS8_LIBFUZZER
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fputs("usage: cs8_fuzz <input>...\n", stderr);
+        return 1;
+    }
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::string const input {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        LLVMFuzzerTestOneInput(reinterpret_cast<uint8_t const*>(input.data()), input.size());
+    }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+    std::fprintf(stderr, "%d inputs in %.3f s, %.0f exec/s\n", argc - 1, elapsed.count(), (argc - 1) / elapsed.count());
+}
+#endif
@@ -0,0 +1,409 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+// Runs programs on the phase-accurate CPU and checks the architectural state after every retired instruction against
+// another execution path: the reference model of the instruction set, or another build of the emulator which recorded
+// its steps to a lockstep stream. Reports the first instruction the two disagree at.
+
+#include "cs8emu.hxx"
+#include "lockstep.hxx"
+#include "reference_cpu.hxx"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+using lockstep::End;
+using lockstep::Step;
+using lockstep::Word;
+
+namespace {
+    void usage(std::ostream& os) {
+        os << "usage: cs8_lockstep [options] <program>...\n"
+              "  checks every instruction of the programs against the reference model of the instruction set\n"
+              "  --against FILE        check one program against the steps another build recorded, - for stdin\n"
+              "  --record FILE         record the steps of one program to FILE, - for stdout, and check nothing\n"
+              "  --input FILE          the serial input of the guest, which is closed at its end, empty if not given\n"
+              "  --max-instructions N  stop checking after N instructions, 10000000 if not given\n"
+              "two builds run in lockstep through a pipe:\n"
+              "  old/cs8_lockstep --record - program | new/cs8_lockstep --against - program\n";
+    }
+
+    ///! Memory words a report lists at most.
+    constexpr size_t reported_words = 16;
+
+    std::string hex(uint16_t value) {
+        std::ostringstream os;
+        os << "0x" << std::hex << std::setw(4) << std::setfill('0') << value;
+        return os.str();
+    }
+
+    std::string describe(std::optional<Word> const& store) {
+        return store ? hex(store->address) + '=' + hex(store->data) : "none";
+    }
+
+    std::string describe(std::optional<uint16_t> const& interrupt) {
+        return interrupt ? hex(*interrupt) : "none";
+    }
+
+    /**
+     * The first part of two steps which differs
+     * @param timing whether the cycles count
+     * @param memory whether the changed words count
+     */
+    std::optional<std::string> compare(Step const& expected, Step const& actual, bool timing, bool memory) {
+        if (expected.address != actual.address) return "instruction address";
+        if (expected.interrupt != actual.interrupt) return "interrupt entry";
+        if (expected.store != actual.store) return "store";
+        if (expected.registers != actual.registers) return "registers";
+        if (timing && expected.cycles != actual.cycles) return "cycles";
+        if (memory && expected.memory != actual.memory) return "memory";
+        return std::nullopt;
+    }
+
+    /**
+     * Serves the reads of the reference model. Memory answers from the memory of the reference, devices and the bank
+     * windows with what the emulator read, so they answer both the same. The addresses have to match, writes go to the
+     * memory of the reference.
+     */
+    class OracleBus : public ReferenceCPU::Bus {
+        std::vector<Word> const& reads;
+        std::vector<uint16_t>& memory;
+        size_t next {0};
+
+    public:
+        std::optional<Word> store;
+        ///! The word of memory the store overwrote, as it was before.
+        std::optional<Word> overwritten;
+        ///! The first read which did not match the emulator.
+        std::optional<std::string> mismatch;
+
+        OracleBus(std::vector<Word> const& reads, std::vector<uint16_t>& memory) : reads{reads}, memory{memory} {}
+
+        uint16_t read(uint16_t address) override {
+            if (next < reads.size() && reads[next].address == address) {
+                auto const data = reads[next++].data;
+                if (address >= memory.size()) return data;
+                if (memory[address] != data && !mismatch) {
+                    mismatch = "read " + hex(address) + " gave " + hex(memory[address]) + " where the emulator read " +
+                               hex(data);
+                }
+                return memory[address];
+            }
+            if (!mismatch) {
+                mismatch = "read " + hex(address) + (next < reads.size() ? " where the emulator read " +
+                                                     hex(reads[next].address) : ", the emulator read nothing more");
+            }
+            return address < memory.size() ? memory[address] : 0;
+        }
+
+        void write(uint16_t address, uint16_t data) override {
+            store = Word{address, data};
+            if (address < memory.size()) {
+                overwritten = Word{address, memory[address]};
+                memory[address] = data;
+            }
+        }
+
+        /// The reads of the emulator the reference model did not make.
+        [[nodiscard]] size_t unread() const {
+            return reads.size() - next;
+        }
+    };
+
+    class Checker {
+        std::string program;
+        uint64_t max_instructions;
+        Emulator emulator;
+        lockstep::Recorder recorder;
+
+        /// Retire the next instruction of the emulator unless the limit is reached.
+        std::variant<Step, End> step() {
+            if (emulator.instructions() >= max_instructions) return End::InstructionLimit;
+            auto result = recorder.step();
+            // Nobody reads the output, it only has to be produced the same way.
+            emulator.serial().output.clear();
+            return result;
+        }
+
+        /// Whether the store starts an operation of the host call device or the block device, which write memory.
+        [[nodiscard]] static bool starts_transfer(std::optional<Word> const& store) {
+            return store && (store->address == EmulatedHostCall::AddressBegin + EmulatedHostCall::Operation ||
+                             store->address == EmulatedBlockDevice::AddressBegin + EmulatedBlockDevice::Command);
+        }
+
+        [[nodiscard]] uint64_t banks_digest() {
+            return lockstep::digest(emulator.machine().mmu->backing_store());
+        }
+
+        /// Print the first divergence with the registers and the words of memory which differ.
+        void report(std::string const& what, std::string const& other, Step const* expected, Step const* actual,
+                    std::span<uint16_t const> expected_memory) const {
+            std::cout << program << ": diverged";
+            if (actual) {
+                std::cout << " at instruction " << actual->instruction << ", " << hex(actual->address) << " after "
+                          << actual->cycles << " cycles";
+            }
+            std::cout << ": " << what << '\n';
+            auto const row = [&](std::string const& name, std::string const& mine, std::string const& theirs) {
+                std::cout << "  " << std::left << std::setw(10) << name << std::setw(16) << mine << theirs << '\n';
+            };
+
+            if (expected && actual) {
+                row("", "emulator", other);
+                if (expected->address != actual->address) row("address", hex(actual->address), hex(expected->address));
+                if (expected->interrupt != actual->interrupt) {
+                    row("interrupt", describe(actual->interrupt), describe(expected->interrupt));
+                }
+                if (expected->store != actual->store) row("store", describe(actual->store), describe(expected->store));
+                for (size_t r = 0; r < CPURegisters::count; ++r) {
+                    auto const mine = static_cast<uint16_t>(actual->registers.values[r]);
+                    auto const theirs = static_cast<uint16_t>(expected->registers.values[r]);
+                    if (mine != theirs) row(CPURegisters::name(r), hex(mine), hex(theirs));
+                }
+                if (what == "cycles") row("cycles", std::to_string(actual->cycles), std::to_string(expected->cycles));
+            }
+
+            auto const memory = recorder.memory();
+            size_t differing = 0;
+            for (size_t address = 0; address < std::min(memory.size(), expected_memory.size()); ++address) {
+                if (memory[address] == expected_memory[address]) continue;
+                if (differing++ == 0) row("memory", "emulator", other);
+                if (differing <= reported_words) row(hex(address), hex(memory[address]), hex(expected_memory[address]));
+            }
+            if (differing > reported_words) std::cout << "  ... " << differing - reported_words << " more words\n";
+        }
+
+        void summary(uint64_t instructions, End end) const {
+            std::cout << program << ": " << instructions << " instructions equal, " << lockstep::to_string(end) << '\n';
+        }
+
+    public:
+        Checker(std::string program, std::string const& input, uint64_t max_instructions)
+        : program{std::move(program)}, max_instructions{max_instructions}, emulator{this->program}, recorder{emulator} {
+            // A closed input makes a guest waiting for more end the same way on every path.
+            emulator.serial().input = input;
+            emulator.serial().input_closed = true;
+        }
+
+        /// Check every instruction against the reference model, false at a divergence.
+        bool against_reference() {
+            ReferenceCPU reference(emulator.registers());
+            std::vector<uint16_t> memory(recorder.memory().begin(), recorder.memory().end());
+            uint64_t checked = 0;
+            for (;;) {
+                auto const& dma = *emulator.machine().dma_controller;
+                bool const dma_busy = dma.is_busy();
+                auto result = step();
+                if (auto const* end = std::get_if<End>(&result)) {
+                    // A write to EXIT of the host call device halts the CPU without the reference knowing.
+                    if (*end == End::Halted && !reference.is_halted() && !emulator.machine().exit_code) {
+                        report("the emulator halted, the reference did not", "reference", nullptr, nullptr, memory);
+                        return false;
+                    }
+                    summary(checked, *end);
+                    return true;
+                }
+
+                auto const& actual = std::get<Step>(result);
+                if (reference.is_halted()) {
+                    report("the reference halted before", "reference", nullptr, &actual, memory);
+                    return false;
+                }
+                Step expected;
+                expected.instruction = actual.instruction;
+                expected.cycles = actual.cycles;
+                expected.interrupt = actual.interrupt;
+                if (actual.interrupt) {
+                    if (reference.is_in_service()) {
+                        report("interrupt entry while a handler is running", "reference", nullptr, &actual, memory);
+                        return false;
+                    }
+                    reference.interrupt(*actual.interrupt);
+                }
+                expected.address = static_cast<uint16_t>(reference.get_registers().values[CPURegisters::ip]);
+
+                OracleBus bus(recorder.get_reads(), memory);
+                try {
+                    reference.step(bus);
+                } catch (std::domain_error const& e) {
+                    report(e.what(), "reference", nullptr, &actual, memory);
+                    return false;
+                }
+                expected.store = bus.store;
+                expected.registers = reference.get_registers();
+
+                // Only transfers of devices write memory without the CPU, the reference takes over what they wrote.
+                std::vector<Word> before;
+                if (bus.overwritten) before.push_back(*bus.overwritten);
+                bool const transfer = dma_busy || dma.is_busy() || starts_transfer(actual.store);
+                for (auto const& word : actual.memory) {
+                    if (!transfer || memory[word.address] == word.data) continue;
+                    if (!bus.overwritten || bus.overwritten->address != word.address) {
+                        before.push_back({word.address, memory[word.address]});
+                    }
+                    memory[word.address] = word.data;
+                }
+                for (auto const& word : before) {
+                    auto const now = memory[word.address];
+                    if (now != word.data) expected.memory.push_back({word.address, now});
+                }
+                std::ranges::sort(expected.memory, {}, &Word::address);
+
+                auto what = bus.mismatch ? bus.mismatch : compare(expected, actual, false, true);
+                if (what == "memory" && !transfer) what = "memory changed without a store or a transfer";
+                if (!what && bus.unread()) what = "the emulator read " + std::to_string(bus.unread()) + " more words";
+                if (what) {
+                    report(*what, "reference", &expected, &actual, memory);
+                    return false;
+                }
+                ++checked;
+            }
+        }
+
+        /// Check every instruction against the steps of another build, false at a divergence.
+        bool against_stream(std::istream& input) {
+            lockstep::StreamReader reader(input);
+            std::vector<uint16_t> memory(reader.memory().begin(), reader.memory().end());
+            if (!std::ranges::equal(memory, recorder.memory())) {
+                report("memory at the start", "recorded", nullptr, nullptr, memory);
+                return false;
+            }
+            uint64_t checked = 0;
+            for (;;) {
+                auto mine = step();
+                auto theirs = reader.read();
+                auto const* actual = std::get_if<Step>(&mine);
+                auto const* expected = std::get_if<Step>(&theirs);
+                if (expected) {
+                    for (auto const& word : expected->memory) {
+                        if (word.address < memory.size()) memory[word.address] = word.data;
+                    }
+                }
+
+                if (actual && expected) {
+                    if (auto const what = compare(*expected, *actual, true, true)) {
+                        report(*what, "recorded", expected, actual, memory);
+                        return false;
+                    }
+                    ++checked;
+                } else if (actual || expected) {
+                    auto const end = actual ? std::get<std::pair<End, uint64_t>>(theirs).first : std::get<End>(mine);
+                    report(std::string(actual ? "the recorded run ended: " : "the emulator ended: ") +
+                           lockstep::to_string(end), "recorded", nullptr, actual, memory);
+                    return false;
+                } else {
+                    auto const end = std::get<End>(mine);
+                    auto const [recorded_end, recorded_digest] = std::get<std::pair<End, uint64_t>>(theirs);
+                    if (end != recorded_end) {
+                        report(std::string("ended ") + lockstep::to_string(end) + ", the recorded run " +
+                               lockstep::to_string(recorded_end), "recorded", nullptr, nullptr, memory);
+                        return false;
+                    }
+                    if (banks_digest() != recorded_digest) {
+                        report("the MMU banks at the end", "recorded", nullptr, nullptr, memory);
+                        return false;
+                    }
+                    summary(checked, end);
+                    return true;
+                }
+            }
+        }
+
+        /// Record the steps for a check by another build.
+        void record(std::ostream& output) {
+            lockstep::StreamWriter writer(output, recorder.memory());
+            for (;;) {
+                auto result = step();
+                if (auto const* end = std::get_if<End>(&result)) {
+                    writer.finish(*end, banks_digest());
+                    return;
+                }
+                writer.write(std::get<Step>(result));
+            }
+        }
+    };
+}
+
+int main(int argc, const char* argv[]) {
+    std::optional<std::string> against;
+    std::optional<std::string> record;
+    std::string input;
+    uint64_t max_instructions = 10'000'000;
+    std::vector<std::string> programs;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view argument = argv[i];
+            if (argument == "--against" && i + 1 < argc) {
+                against = argv[++i];
+            } else if (argument == "--record" && i + 1 < argc) {
+                record = argv[++i];
+            } else if (argument == "--input" && i + 1 < argc) {
+                std::ifstream file(argv[++i], std::ios::binary);
+                if (!file) throw std::runtime_error(std::string("Cannot open ") + argv[i]);
+                input.assign(std::istreambuf_iterator<char>(file), {});
+            } else if (argument == "--max-instructions" && i + 1 < argc) {
+                max_instructions = std::stoull(argv[++i], nullptr, 0);
+            } else if (argument == "--help") {
+                usage(std::cout);
+                return 0;
+            } else {
+                programs.emplace_back(argument);
+            }
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "cs8_lockstep: " << e.what() << '\n';
+        return 2;
+    }
+    if (programs.empty() || (against && record) || ((against || record) && programs.size() != 1)) {
+        usage(std::cerr);
+        return 2;
+    }
+
+    try {
+        if (record) {
+            Checker checker(programs.front(), input, max_instructions);
+            if (*record == "-") {
+                checker.record(std::cout);
+            } else {
+                std::ofstream output(*record, std::ios::binary);
+                if (!output) throw std::runtime_error("Cannot create " + *record);
+                checker.record(output);
+            }
+            return 0;
+        }
+        if (against) {
+            Checker checker(programs.front(), input, max_instructions);
+            if (*against == "-") return checker.against_stream(std::cin) ? 0 : 1;
+            std::ifstream stream(*against, std::ios::binary);
+            if (!stream) throw std::runtime_error("Cannot open " + *against);
+            return checker.against_stream(stream) ? 0 : 1;
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "cs8_lockstep: " << e.what() << '\n';
+        return 1;
+    }
+
+    // The corpus: every program is checked, a failing one does not stop the others.
+    bool equal = true;
+    for (auto const& program : programs) {
+        try {
+            Checker checker(program, input, max_instructions);
+            equal = checker.against_reference() && equal;
+        } catch (std::exception const& e) {
+            std::cerr << "cs8_lockstep: " << program << ": " << e.what() << '\n';
+            equal = false;
+        }
+    }
+    return equal ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "telemetry_block.hxx"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static void usage(std::ostream& os) {
+    os << "usage: cs8_monitor <segment> [--interval ms] [--once] [--bus]\n"
+          "  --interval ms  poll every ms milliseconds, default 500\n"
+          "  --once         print one snapshot and exit\n"
+          "  --bus          print the bus transactions seen since the last poll\n";
+}
+
+static TelemetryBlock const* open_block(std::string const& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+
+    void* mapping = mmap(nullptr, sizeof(TelemetryBlock), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return nullptr;
+    return static_cast<TelemetryBlock const*>(mapping);
+}
+
+static void print_snapshot(std::ostream& os, TelemetryBlock::Snapshot const& snapshot, double instructions_per_second) {
+    constexpr std::array<const char*, TelemetryBlock::register_count> names {
+            "dst", "sc0", "sc1", "idx", "tmp", "sp0", "sp1",
+            "dt0", "dt1", "dt2", "dt3", "dt4", "dt5",
+            "lnk", "cnt", "bse", "ip", "tmp2"
+    };
+
+    os << (snapshot.running ? "running" : "halted") << ' ' << snapshot.phase
+       << " cycles=" << snapshot.cycles
+       << " instructions=" << snapshot.retired_instructions
+       << " serial=" << snapshot.serial_bytes
+       << std::fixed << std::setprecision(0) << " ips=" << instructions_per_second << '\n';
+    os << std::hex << std::setfill('0');
+    for (size_t i = 0; i < names.size(); ++i) {
+        os << "  " << names[i] << "=" << std::setw(4) << static_cast<uint16_t>(snapshot.registers[i]);
+        if (i % 6 == 5) os << '\n';
+    }
+    os << std::dec << std::setfill(' ') << '\n';
+}
+
+int main(int argc, const char* argv[]) {
+    std::optional<std::string> name;
+    std::chrono::milliseconds interval {500};
+    bool once = false;
+    bool bus = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view argument = argv[i];
+        if (argument == "--interval" && i + 1 < argc) {
+            interval = std::chrono::milliseconds(std::stoul(argv[++i]));
+        } else if (argument == "--once") {
+            once = true;
+        } else if (argument == "--bus") {
+            bus = true;
+        } else if (argument == "--help") {
+            usage(std::cout);
+            return 0;
+        } else if (argument.starts_with("--") || name.has_value()) {
+            usage(std::cerr);
+            return 2;
+        } else {
+            name = argument;
+        }
+    }
+    if (!name.has_value()) {
+        usage(std::cerr);
+        return 2;
+    }
+
+    auto const* block = open_block(*name);
+    if (!block || !block->valid()) {
+        std::cerr << "cs8_monitor: no telemetry in " << *name << '\n';
+        return 1;
+    }
+
+    uint64_t bus_position = block->ring_head.load(std::memory_order_acquire);
+    auto const stale = [&] {
+        std::cerr << "cs8_monitor: the telemetry in " << *name << " is stale, the emulator stopped while updating it\n";
+        return 1;
+    };
+    auto first = block->read_snapshot();
+    if (!first) return stale();
+    auto previous = *first;
+    auto previous_time = std::chrono::steady_clock::now();
+
+    for (;;) {
+        if (!once) std::this_thread::sleep_for(interval);
+
+        auto const read = block->read_snapshot();
+        if (!read) return stale();
+        auto const& snapshot = *read;
+        auto const now = std::chrono::steady_clock::now();
+        double const seconds = std::chrono::duration<double>(now - previous_time).count();
+        double const rate = seconds > 0 ? (snapshot.retired_instructions - previous.retired_instructions) / seconds : 0;
+
+        print_snapshot(std::cout, snapshot, rate);
+        if (bus) {
+            for (auto const& transaction : block->read_bus(bus_position)) {
+                std::cout << "  " << transaction.position << (transaction.mode == 1 ? " write" : " read ")
+                          << std::hex << " 0x" << transaction.address << " 0x" << transaction.data << std::dec << '\n';
+            }
+        }
+        std::cout.flush();
+
+        if (once || !snapshot.running) break;
+        previous = snapshot;
+        previous_time = now;
+    }
+}
@@ -0,0 +1,107 @@
+//
+// Created by mkr on 10/18/26.
+//
+
+#include "trace_reader.hxx"
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+static void usage(std::ostream& os) {
+    os << "usage: cs8_trace <trace> [--from N] [--count N] [--address A] [--opcode OP] [--bus] [--summary]\n"
+          "  --from N       start at instruction N\n"
+          "  --count N      print at most N instructions\n"
+          "  --address A    only instructions at address A\n"
+          "  --opcode OP    only instructions with the first byte OP\n"
+          "  --bus          print the bus transactions of every instruction\n"
+          "  --summary      print the number of recorded instructions and exit\n";
+}
+
+static void print_record(std::ostream& os, trace_format::Record const& record, bool bus) {
+    os << std::dec << record.index
+       << std::hex << std::setfill('0')
+       << " 0x" << std::setw(4) << record.address
+       << " op=0x" << std::setw(2) << static_cast<unsigned>(record.opcode)
+       << std::dec << " cycles=" << record.cycles;
+
+    for (size_t r = 0; r < CPURegisters::count; ++r) {
+        if (record.changed & (1u << r)) {
+            os << ' ' << CPURegisters::name(r) << "=0x" << std::hex << std::setw(4)
+               << static_cast<uint16_t>(record.registers.values[r]) << std::dec;
+        }
+    }
+    os << '\n';
+
+    if (bus) {
+        for (auto const& transaction : record.bus) {
+            os << "    " << (transaction.mode == RW::Write ? "write" : "read ")
+               << std::hex << " 0x" << std::setw(4) << transaction.address
+               << " 0x" << std::setw(4) << transaction.data << std::dec << '\n';
+        }
+    }
+    os << std::setfill(' ');
+}
+
+int main(int argc, const char* argv[]) {
+    std::optional<std::string> file;
+    uint64_t from = 0;
+    std::optional<uint64_t> count;
+    std::optional<uint16_t> address;
+    std::optional<uint8_t> opcode;
+    bool bus = false;
+    bool summary = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view argument = argv[i];
+            if (argument == "--from" && i + 1 < argc) {
+                from = std::stoull(argv[++i], nullptr, 0);
+            } else if (argument == "--count" && i + 1 < argc) {
+                count = std::stoull(argv[++i], nullptr, 0);
+            } else if (argument == "--address" && i + 1 < argc) {
+                address = static_cast<uint16_t>(std::stoul(argv[++i], nullptr, 0));
+            } else if (argument == "--opcode" && i + 1 < argc) {
+                opcode = static_cast<uint8_t>(std::stoul(argv[++i], nullptr, 0));
+            } else if (argument == "--bus") {
+                bus = true;
+            } else if (argument == "--summary") {
+                summary = true;
+            } else if (argument == "--help") {
+                usage(std::cout);
+                return 0;
+            } else if (argument.starts_with("--") || file.has_value()) {
+                usage(std::cerr);
+                return 2;
+            } else {
+                file = argument;
+            }
+        }
+        if (!file.has_value()) {
+            usage(std::cerr);
+            return 2;
+        }
+
+        TraceReader reader(*file);
+        if (summary) {
+            std::cout << reader.size() << " instructions\n";
+            return 0;
+        }
+
+        uint64_t printed = 0;
+        reader.for_each(from, [&](trace_format::Record const& record) {
+            if (count && printed >= *count) return false;
+            if (address && record.address != *address) return true;
+            if (opcode && record.opcode != *opcode) return true;
+
+            print_record(std::cout, record, bus);
+            ++printed;
+            return true;
+        });
+    } catch (std::exception const& e) {
+        std::cerr << "cs8_trace: " << e.what() << '\n';
+        return 1;
+    }
+}